@@ -0,0 +1,104 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include <libhal/steady_clock.hpp>
+#include <libhal/units.hpp>
+
+namespace hal::benchmark {
+/**
+ * @brief Steady clock that advances by one tick per read
+ *
+ * Lets code that waits on a steady clock run as fast as the CPU allows, so a
+ * benchmark measures the code rather than the waits.
+ */
+class counting_clock final : public hal::steady_clock
+{
+public:
+  explicit counting_clock(hertz p_frequency = 1.0_GHz)
+    : m_frequency(p_frequency)
+  {
+  }
+
+private:
+  frequency_t driver_frequency() override
+  {
+    return frequency_t{ .operating_frequency = m_frequency };
+  }
+  uptime_t driver_uptime() override
+  {
+    return uptime_t{ .ticks = m_ticks++ };
+  }
+
+  hertz m_frequency;
+  std::uint64_t m_ticks = 0;
+};
+
+/**
+ * @brief Steady clock backed by the host's std::chrono::steady_clock
+ *
+ */
+class host_clock final : public hal::steady_clock
+{
+private:
+  frequency_t driver_frequency() override
+  {
+    return frequency_t{ .operating_frequency = 1.0_GHz };
+  }
+  uptime_t driver_uptime() override
+  {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    const auto ticks = std::chrono::nanoseconds(now).count();
+    return uptime_t{ .ticks = static_cast<std::uint64_t>(ticks) };
+  }
+};
+
+/**
+ * @brief Measure the average host time of one call to p_work
+ *
+ * @param p_iterations - number of times to call p_work
+ * @param p_work - the work to measure
+ * @return double - average nanoseconds per call
+ */
+template<class Work>
+double nanoseconds_per_call(std::size_t p_iterations, Work&& p_work)
+{
+  // Warm up caches and branch predictors before timing
+  p_work();
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < p_iterations; i++) {
+    p_work();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  const std::chrono::duration<double, std::nano> elapsed = end - start;
+  return elapsed.count() / static_cast<double>(p_iterations);
+}
+
+/**
+ * @brief Print one result line
+ *
+ * @param p_name - what was measured
+ * @param p_value - the measurement
+ * @param p_unit - unit of p_value
+ */
+inline void report(const char* p_name, double p_value, const char* p_unit)
+{
+  std::printf("%-48s %12.2f %s\n", p_name, p_value, p_unit);
+}
+}  // namespace hal::benchmark
@@ -0,0 +1,143 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+
+#include <libhal/bit_bang_i2c.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file bit_bang_i2c.cpp
+ * @brief Achievable clock rate of `hal::bit_bang_i2c` with concrete pin types
+ * against the same pins used through `hal::output_pin`.
+ *
+ * The clock rate is set high enough that every half period delay is a single
+ * clock read, so the result is the rate the CPU can toggle the pins at. The
+ * pins model a device that acknowledges every byte.
+ */
+namespace {
+/// Bus lines with a device that pulls SDA LOW for every ninth clock pulse
+struct wire
+{
+  bool scl = true;
+  bool sda = true;
+  int bits = 0;
+};
+
+class scl_pin final : public hal::output_pin
+{
+public:
+  explicit scl_pin(wire& p_wire)
+    : m_wire(&p_wire)
+  {
+  }
+
+private:
+  hal::status driver_configure(const settings&) override
+  {
+    return hal::success();
+  }
+  hal::result<set_level_t> driver_level(bool p_high) override
+  {
+    if (p_high && !m_wire->scl) {
+      m_wire->bits++;
+    }
+    m_wire->scl = p_high;
+    return set_level_t{};
+  }
+  hal::result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_wire->scl };
+  }
+
+  wire* m_wire;
+};
+
+class sda_pin final : public hal::output_pin
+{
+public:
+  explicit sda_pin(wire& p_wire)
+    : m_wire(&p_wire)
+  {
+  }
+
+private:
+  hal::status driver_configure(const settings&) override
+  {
+    return hal::success();
+  }
+  hal::result<set_level_t> driver_level(bool p_high) override
+  {
+    // A falling SDA while SCL is HIGH is a START
+    if (m_wire->scl && m_wire->sda && !p_high) {
+      m_wire->bits = 0;
+    }
+    m_wire->sda = p_high;
+    return set_level_t{};
+  }
+  hal::result<level_t> driver_level() override
+  {
+    const bool acknowledge =
+      m_wire->scl && m_wire->bits > 0 && m_wire->bits % 9 == 0;
+    return level_t{ .state = m_wire->sda && !acknowledge };
+  }
+
+  wire* m_wire;
+};
+
+constexpr hal::byte address = 0x42;
+constexpr std::size_t iterations = 20'000;
+const std::array<hal::byte, 16> data{};
+// START, address byte, data bytes and STOP, counting START and STOP as one
+// clock each
+constexpr double clocks_per_transaction = 2.0 + 9.0 * (1 + data.size());
+
+template<class Controller>
+void run(const char* p_name, Controller& p_controller)
+{
+  const auto nanoseconds =
+    hal::benchmark::nanoseconds_per_call(iterations, [&p_controller]() {
+      (void)p_controller.transaction(
+        address, data, std::span<hal::byte>{}, hal::never_timeout());
+    });
+  const auto kilohertz = clocks_per_transaction / nanoseconds * 1e6;
+  hal::benchmark::report(p_name, kilohertz, "kHz");
+}
+}  // namespace
+
+int main()
+{
+  using namespace hal::literals;
+
+  wire bus;
+  scl_pin scl(bus);
+  sda_pin sda(bus);
+  hal::benchmark::counting_clock clock;
+  const hal::i2c::settings fastest{ .clock_rate = 1.0_GHz };
+
+  using concrete_i2c =
+    hal::bit_bang_i2c<scl_pin, sda_pin, hal::benchmark::counting_clock>;
+  auto concrete = concrete_i2c::create(scl, sda, clock, fastest).value();
+  run("bit_bang_i2c<scl_pin, sda_pin, counting_clock>", concrete);
+
+  hal::output_pin& scl_interface = scl;
+  hal::output_pin& sda_interface = sda;
+  hal::steady_clock& clock_interface = clock;
+  auto dynamic = hal::bit_bang_i2c<>::create(
+                   scl_interface, sda_interface, clock_interface, fastest)
+                   .value();
+  run("bit_bang_i2c<>", dynamic);
+  return 0;
+}
@@ -0,0 +1,170 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+
+#include <libhal/bit_bang_spi.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file bit_bang_spi.cpp
+ * @brief Achievable bit rate of `hal::static_bit_bang_spi` and
+ * `hal::bit_bang_spi` with concrete pin types, against `hal::bit_bang_spi`
+ * used through the pin interfaces.
+ *
+ * The clock rate is set high enough that every half period delay is a single
+ * clock read, so the result is the rate the CPU can shift bits at.
+ */
+namespace {
+/// Bus lines looped back so MISO reads what was last written to MOSI
+struct wire
+{
+  bool sck = false;
+  bool mosi = false;
+  std::uint32_t edges = 0;
+};
+
+class sck_pin final : public hal::output_pin
+{
+public:
+  explicit sck_pin(wire& p_wire)
+    : m_wire(&p_wire)
+  {
+  }
+
+private:
+  hal::status driver_configure(const settings&) override
+  {
+    return hal::success();
+  }
+  hal::result<set_level_t> driver_level(bool p_high) override
+  {
+    m_wire->edges += p_high != m_wire->sck;
+    m_wire->sck = p_high;
+    return set_level_t{};
+  }
+  hal::result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_wire->sck };
+  }
+
+  wire* m_wire;
+};
+
+class mosi_pin final : public hal::output_pin
+{
+public:
+  explicit mosi_pin(wire& p_wire)
+    : m_wire(&p_wire)
+  {
+  }
+
+private:
+  hal::status driver_configure(const settings&) override
+  {
+    return hal::success();
+  }
+  hal::result<set_level_t> driver_level(bool p_high) override
+  {
+    m_wire->mosi = p_high;
+    return set_level_t{};
+  }
+  hal::result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_wire->mosi };
+  }
+
+  wire* m_wire;
+};
+
+class miso_pin final : public hal::input_pin
+{
+public:
+  explicit miso_pin(wire& p_wire)
+    : m_wire(&p_wire)
+  {
+  }
+
+private:
+  hal::status driver_configure(const settings&) override
+  {
+    return hal::success();
+  }
+  hal::result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_wire->mosi };
+  }
+
+  wire* m_wire;
+};
+
+constexpr std::size_t iterations = 20'000;
+constexpr std::array<hal::byte, 16> data_out{ 0xA5, 0x5A, 0xFF, 0x00 };
+std::array<hal::byte, 16> data_in{};
+
+void run(const char* p_name, hal::spi& p_spi)
+{
+  const auto nanoseconds =
+    hal::benchmark::nanoseconds_per_call(iterations, [&p_spi]() {
+      (void)p_spi.transfer(data_out, data_in);
+    });
+  const auto bits = 8.0 * static_cast<double>(data_out.size());
+  hal::benchmark::report(p_name, bits / nanoseconds * 1e3, "Mbit/s");
+}
+}  // namespace
+
+int main()
+{
+  using namespace hal::literals;
+
+  wire bus;
+  sck_pin sck(bus);
+  mosi_pin mosi(bus);
+  miso_pin miso(bus);
+  hal::benchmark::counting_clock clock;
+  const hal::spi::settings fastest{ .clock_rate = 1.0_GHz };
+
+  auto fixed_mode =
+    hal::static_bit_bang_spi<false,
+                             false,
+                             sck_pin,
+                             mosi_pin,
+                             miso_pin,
+                             hal::benchmark::counting_clock>::
+      create(sck, mosi, miso, clock, fastest.clock_rate)
+        .value();
+  run("static_bit_bang_spi<mode 0, concrete pins>", fixed_mode);
+
+  using concrete_spi = hal::
+    bit_bang_spi<sck_pin, mosi_pin, miso_pin, hal::benchmark::counting_clock>;
+  auto runtime_mode =
+    concrete_spi::create(sck, mosi, miso, clock, fastest).value();
+  run("bit_bang_spi<concrete pins>", runtime_mode);
+
+  hal::output_pin& sck_interface = sck;
+  hal::output_pin& mosi_interface = mosi;
+  hal::input_pin& miso_interface = miso;
+  hal::steady_clock& clock_interface = clock;
+  auto dynamic = hal::bit_bang_spi<>::create(sck_interface,
+                                             mosi_interface,
+                                             miso_interface,
+                                             clock_interface,
+                                             fastest)
+                   .value();
+  run("bit_bang_spi<>", dynamic);
+
+  // Loopback check, the last transfer must have read back what it wrote
+  return data_in == data_out && bus.edges > 0 ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cstdint>
+
+#include <libhal/cic_decimator.hpp>
+#include <libhal/filter.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file cic_decimator.cpp
+ * @brief Cost per input sample of decimating 12 bit adc codes by 16 with
+ * `hal::cic_decimator` against float averaging.
+ *
+ * The float variants convert each code to a float sample, as `hal::adc::read`
+ * would return it, and either run `hal::moving_average` keeping every 16th
+ * output or average each group of 16 samples.
+ */
+namespace {
+constexpr std::uint32_t ratio = 16;
+constexpr std::size_t block_size = 4096;
+constexpr std::size_t blocks = 5'000;
+
+std::array<std::uint32_t, block_size> codes{};
+std::array<float, block_size> samples{};
+std::array<std::uint32_t, block_size / ratio + 1> cic_output{};
+std::array<float, block_size / ratio> float_output{};
+
+void report(const char* p_name, double p_ns_per_block)
+{
+  hal::benchmark::report(p_name, p_ns_per_block / block_size, "ns/sample");
+}
+}  // namespace
+
+int main()
+{
+  std::uint32_t noise = 1;
+  for (auto& code : codes) {
+    noise = noise * 1'103'515'245U + 12'345U;
+    code = 2000U + (noise >> 29);
+  }
+
+  auto cic = hal::cic_decimator<3>::create(ratio, 12).value();
+  report("cic_decimator<3> block",
+         hal::benchmark::nanoseconds_per_call(
+           blocks, [&cic]() { (void)cic.process(codes, cic_output); }));
+
+  hal::moving_average<ratio> average;
+  report("moving_average<16> from codes",
+         hal::benchmark::nanoseconds_per_call(blocks, [&average]() {
+           for (std::size_t i = 0; i < block_size; i++) {
+             const auto sample = static_cast<float>(codes[i]) / 4095.0f;
+             const auto output = average.process(sample);
+             if (i % ratio == ratio - 1) {
+               float_output[i / ratio] = output;
+             }
+           }
+         }));
+
+  report("float group average from codes",
+         hal::benchmark::nanoseconds_per_call(blocks, []() {
+           for (std::size_t i = 0; i < block_size; i++) {
+             samples[i] = static_cast<float>(codes[i]) / 4095.0f;
+           }
+           for (std::size_t i = 0; i < float_output.size(); i++) {
+             float sum = 0.0f;
+             for (std::size_t j = 0; j < ratio; j++) {
+               sum += samples[i * ratio + j];
+             }
+             float_output[i] = sum / static_cast<float>(ratio);
+           }
+         }));
+
+  return cic_output[0] != 0 && float_output[0] > 0.0f ? 0 : 1;
+}
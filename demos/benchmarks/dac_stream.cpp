@@ -0,0 +1,193 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+#include <libhal/soft_dac_stream.hpp>
+#include <libhal/waveform.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file dac_stream.cpp
+ * @brief Cost of one sample period of `hal::soft_dac_stream` playing a sine
+ * table into a 12 bit dac, and how far its samples wander from their ideal
+ * times at 44.1 kHz.
+ *
+ * The per sample cost is compared with writing the same table as floats
+ * through `hal::dac::write(float)`. The timing part plays one second of
+ * samples on a 1 MHz clock with 5 us of interrupt latency and reports the
+ * error of the last sample, against a stream that schedules each sample one
+ * period after the previous callback.
+ */
+namespace {
+using namespace hal::literals;
+
+constexpr std::size_t samples_per_call = 1024;
+constexpr std::size_t calls = 20'000;
+constexpr auto sine = hal::sine_table<64>();
+
+/// 12 bit dac register, written from either write path
+class code_dac : public hal::dac
+{
+public:
+  std::uint32_t m_code = 0;
+
+private:
+  hal::result<write_t> driver_write(float p_percentage) override
+  {
+    m_code = static_cast<std::uint32_t>(p_percentage * 4095.0f + 0.5f);
+    return write_t{};
+  }
+  hal::result<write_t> driver_write_fraction(hal::q16 p_proportion) override
+  {
+    m_code = p_proportion.scale(4095);
+    return write_t{};
+  }
+};
+
+/// Timer that runs its callback on demand, in virtual time with latency
+class virtual_timer : public hal::timer
+{
+public:
+  hal::callback<void(void)> m_callback = []() {};
+  std::uint64_t m_now = 0;
+  std::uint64_t m_due = 0;
+  std::uint64_t m_latency = 0;
+
+  void fire()
+  {
+    m_now = m_due + m_latency;
+    m_callback();
+  }
+
+private:
+  hal::result<is_running_t> driver_is_running() override
+  {
+    return is_running_t{ .is_running = true };
+  }
+  hal::result<cancel_t> driver_cancel() override
+  {
+    return cancel_t{};
+  }
+  hal::result<schedule_t> driver_schedule(hal::callback<void(void)> p_callback,
+                                     hal::time_duration p_delay) override
+  {
+    m_callback = p_callback;
+    m_due = m_now + static_cast<std::uint64_t>(p_delay.count());
+    return schedule_t{};
+  }
+};
+
+/// 1 MHz clock reading the virtual timer's nanoseconds
+class virtual_clock : public hal::steady_clock
+{
+public:
+  explicit virtual_clock(virtual_timer& p_timer)
+    : m_timer(&p_timer)
+  {
+  }
+
+private:
+  frequency_t driver_frequency() override
+  {
+    return frequency_t{ .operating_frequency = 1.0_MHz };
+  }
+  uptime_t driver_uptime() override
+  {
+    return uptime_t{ .ticks = m_timer->m_now / 1000U };
+  }
+
+  virtual_timer* m_timer;
+};
+
+void loop_sine(hal::dac_stream& p_stream)
+{
+  p_stream.on_complete([&p_stream](std::span<const hal::q16> p_samples) {
+    (void)p_stream.submit(p_samples);
+  });
+  (void)p_stream.submit(sine);
+}
+}  // namespace
+
+int main()
+{
+  code_dac dac;
+  virtual_timer timer;
+  virtual_clock clock(timer);
+  hal::soft_dac_stream stream(dac, timer, clock);
+  loop_sine(stream);
+  (void)stream.start(44.1_kHz);
+
+  const auto per_call =
+    hal::benchmark::nanoseconds_per_call(calls, [&timer]() {
+      for (std::size_t i = 0; i < samples_per_call; i++) {
+        timer.fire();
+      }
+    });
+  hal::benchmark::report(
+    "soft_dac_stream sample period", per_call / samples_per_call, "ns");
+
+  const auto per_q16_call =
+    hal::benchmark::nanoseconds_per_call(calls, [&dac]() {
+      for (std::size_t i = 0; i < samples_per_call; i++) {
+        (void)dac.write(sine[i % sine.size()]);
+      }
+    });
+  hal::benchmark::report("dac::write(q16) from the q16 table",
+                         per_q16_call / samples_per_call,
+                         "ns");
+
+  std::array<float, sine.size()> float_sine{};
+  for (std::size_t i = 0; i < sine.size(); i++) {
+    float_sine[i] = sine[i].to_float();
+  }
+  const auto per_float_call =
+    hal::benchmark::nanoseconds_per_call(calls, [&dac, &float_sine]() {
+      for (std::size_t i = 0; i < samples_per_call; i++) {
+        (void)dac.write(float_sine[i % float_sine.size()]);
+      }
+    });
+  hal::benchmark::report("dac::write(float) from a float table",
+                         per_float_call / samples_per_call,
+                         "ns");
+
+  // One second of samples with interrupt latency, from a fresh stream
+  virtual_timer late_timer;
+  virtual_clock late_clock(late_timer);
+  hal::soft_dac_stream late_stream(dac, late_timer, late_clock);
+  late_timer.m_latency = 5'000;
+  loop_sine(late_stream);
+  (void)late_stream.start(44.1_kHz);
+  // The first sample is due one period after start, the 44100th at 1 s
+  for (int i = 1; i < 44'100; i++) {
+    late_timer.fire();
+  }
+  const auto ideal = 1'000'000'000.0;
+  const auto due = static_cast<double>(late_timer.m_due);
+  hal::benchmark::report(
+    "deadline error after 1 s", std::abs(due - ideal), "ns");
+
+  // Scheduling each sample relative to the previous callback accumulates the
+  // latency and the 22.675 us period rounded up to the timer's 1 us tick
+  const auto relative_period = 23'000.0;
+  const auto relative_due = 44'100.0 * (relative_period + 5'000.0) - 5'000.0;
+  hal::benchmark::report("relative scheduling error after 1 s",
+                         std::abs(relative_due - ideal),
+                         "ns");
+
+  return dac.m_code <= 4095 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include <libhal/filter.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file filter.cpp
+ * @brief Per sample and block throughput of the filters in filter.hpp
+ * against straightforward scalar implementations.
+ *
+ * The scalar references are written the way filters are commonly written by
+ * hand: a circular buffer indexed with a modulo, summing or sorting the whole
+ * window for every sample.
+ */
+namespace {
+constexpr std::size_t block_size = 256;
+constexpr std::size_t blocks = 20'000;
+
+/// Direct form I biquad with a circular buffer per side
+class reference_biquad
+{
+public:
+  explicit reference_biquad(const hal::biquad::coefficients& p_coefficients)
+    : m_c(p_coefficients)
+  {
+  }
+
+  float process(float p_sample)
+  {
+    const auto output = m_c.b0 * p_sample + m_c.b1 * m_x[0] + m_c.b2 * m_x[1] -
+                        m_c.a1 * m_y[0] - m_c.a2 * m_y[1];
+    m_x = { p_sample, m_x[0] };
+    m_y = { output, m_y[0] };
+    return output;
+  }
+
+private:
+  hal::biquad::coefficients m_c;
+  std::array<float, 2> m_x{};
+  std::array<float, 2> m_y{};
+};
+
+template<std::size_t Taps>
+class reference_fir
+{
+public:
+  explicit reference_fir(const std::array<float, Taps>& p_coefficients)
+    : m_coefficients(p_coefficients)
+  {
+  }
+
+  float process(float p_sample)
+  {
+    m_history[m_next] = p_sample;
+    float output = 0.0f;
+    for (std::size_t i = 0; i < Taps; i++) {
+      output += m_coefficients[i] * m_history[(m_next + Taps - i) % Taps];
+    }
+    m_next = (m_next + 1) % Taps;
+    return output;
+  }
+
+private:
+  std::array<float, Taps> m_coefficients;
+  std::array<float, Taps> m_history{};
+  std::size_t m_next = 0;
+};
+
+template<std::size_t Length>
+class reference_moving_average
+{
+public:
+  float process(float p_sample)
+  {
+    m_window[m_next] = p_sample;
+    m_next = (m_next + 1) % Length;
+    float sum = 0.0f;
+    for (const auto sample : m_window) {
+      sum += sample;
+    }
+    return sum / static_cast<float>(Length);
+  }
+
+private:
+  std::array<float, Length> m_window{};
+  std::size_t m_next = 0;
+};
+
+template<std::size_t Length>
+class reference_median
+{
+public:
+  float process(float p_sample)
+  {
+    m_window[m_next] = p_sample;
+    m_next = (m_next + 1) % Length;
+    auto sorted = m_window;
+    std::nth_element(
+      sorted.begin(), sorted.begin() + Length / 2, sorted.end());
+    return sorted[Length / 2];
+  }
+
+private:
+  std::array<float, Length> m_window{};
+  std::size_t m_next = 0;
+};
+
+std::array<float, block_size> input{};
+std::array<float, block_size> output{};
+
+template<class Filter>
+double per_sample(Filter& p_filter)
+{
+  return hal::benchmark::nanoseconds_per_call(blocks, [&p_filter]() {
+           for (std::size_t i = 0; i < block_size; i++) {
+             output[i] = p_filter.process(input[i]);
+           }
+         }) /
+         block_size;
+}
+
+template<class Filter>
+double per_block(Filter& p_filter)
+{
+  return hal::benchmark::nanoseconds_per_call(
+           blocks, [&p_filter]() { p_filter.process(input, output); }) /
+         block_size;
+}
+
+template<class Reference, class Filter>
+void compare(const char* p_name, Reference p_reference, Filter p_filter)
+{
+  char name[64];
+  std::snprintf(name, sizeof(name), "%s scalar reference", p_name);
+  hal::benchmark::report(name, per_sample(p_reference), "ns/sample");
+  std::snprintf(name, sizeof(name), "%s per sample", p_name);
+  hal::benchmark::report(name, per_sample(p_filter), "ns/sample");
+  std::snprintf(name, sizeof(name), "%s block", p_name);
+  hal::benchmark::report(name, per_block(p_filter), "ns/sample");
+}
+}  // namespace
+
+int main()
+{
+  using namespace hal::literals;
+
+  for (std::size_t i = 0; i < input.size(); i++) {
+    input[i] = std::sin(static_cast<float>(i) * 0.1f) +
+               0.1f * std::sin(static_cast<float>(i) * 2.9f);
+  }
+
+  std::array<float, 32> taps{};
+  for (std::size_t i = 0; i < taps.size(); i++) {
+    taps[i] = 1.0f / static_cast<float>(taps.size());
+  }
+  const auto low_pass = hal::biquad::low_pass(1.0_kHz, 48.0_kHz);
+
+  compare("fir_filter<32>", reference_fir<32>(taps), hal::fir_filter<32>(taps));
+  compare("biquad", reference_biquad(low_pass), hal::biquad(low_pass));
+  compare("moving_average<32>",
+          reference_moving_average<32>(),
+          hal::moving_average<32>());
+  compare("median_filter<9>", reference_median<9>(), hal::median_filter<9>());
+  return output[0] == output[0] ? 0 : 1;
+}
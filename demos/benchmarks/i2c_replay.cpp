@@ -0,0 +1,134 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+
+#include <libhal/i2c_recording.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file i2c_replay.cpp
+ * @brief CPU cost of a device driver's read, measured against a replayed
+ * recording instead of real hardware.
+ *
+ * The harness records a number of reads of the driver under test, then runs
+ * the driver against `hal::i2c_replay` of that recording in a loop. With no
+ * bus time involved, the result is the CPU cost of the driver plus the replay
+ * matching, which is measured separately and subtracted. A change in the
+ * result points to a change in the driver.
+ *
+ * On target, record against the real device and store the recording with
+ * the benchmark. Here a model of the device stands in for it.
+ */
+namespace {
+constexpr hal::byte sensor_address = 0x48;
+
+/// Driver under test: reads a 12 bit temperature in 1/16 degree steps
+class temperature_sensor
+{
+public:
+  explicit temperature_sensor(hal::i2c& p_i2c)
+    : m_i2c(&p_i2c)
+  {
+  }
+
+  hal::result<float> read()
+  {
+    constexpr std::array<hal::byte, 1> temperature_register{ 0x00 };
+    std::array<hal::byte, 2> data{};
+    HAL_CHECK(m_i2c->transaction(
+      sensor_address, temperature_register, data, hal::never_timeout()));
+    const auto raw = static_cast<std::int16_t>((data[0] << 8) | data[1]) >> 4;
+    return static_cast<float>(raw) / 16.0f;
+  }
+
+private:
+  hal::i2c* m_i2c;
+};
+
+/// Stand-in for the real sensor while recording
+class sensor_model : public hal::i2c
+{
+private:
+  hal::status driver_configure(const settings&) override
+  {
+    return hal::success();
+  }
+  hal::result<transaction_t> driver_transaction(
+    hal::byte,
+    std::span<const hal::byte>,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function>) override
+  {
+    m_sample = static_cast<std::uint16_t>(m_sample + 0x10);
+    p_data_in[0] = static_cast<hal::byte>(m_sample >> 8);
+    p_data_in[1] = static_cast<hal::byte>(m_sample);
+    return transaction_t{};
+  }
+
+  std::uint16_t m_sample = 0x1900;
+};
+
+constexpr std::size_t recorded_reads = 64;
+constexpr std::size_t iterations = 1'000'000;
+}  // namespace
+
+int main()
+{
+  sensor_model sensor;
+  hal::benchmark::host_clock clock;
+  std::array<hal::byte, recorded_reads * 16> log{};
+  hal::i2c_recorder recorder(sensor, clock, log);
+  temperature_sensor recording_driver(recorder);
+  for (std::size_t i = 0; i < recorded_reads; i++) {
+    (void)recording_driver.read();
+  }
+  if (recorder.overflow()) {
+    return 1;
+  }
+
+  hal::i2c_replay replay(recorder.recording());
+  auto rewind_when_finished = [&replay]() {
+    if (replay.finished()) {
+      replay.rewind();
+    }
+  };
+
+  // Cost of the replay alone, with the same transaction the driver makes
+  const auto replay_only =
+    hal::benchmark::nanoseconds_per_call(iterations, [&]() {
+      rewind_when_finished();
+      constexpr std::array<hal::byte, 1> temperature_register{ 0x00 };
+      std::array<hal::byte, 2> data{};
+      (void)replay.transaction(
+        sensor_address, temperature_register, data, hal::never_timeout());
+    });
+
+  replay.rewind();
+  temperature_sensor driver(replay);
+  float sink = 0.0f;
+  const auto driver_read =
+    hal::benchmark::nanoseconds_per_call(iterations, [&]() {
+      rewind_when_finished();
+      sink += driver.read().value();
+    });
+
+  hal::benchmark::report("i2c_replay transaction", replay_only, "ns");
+  hal::benchmark::report(
+    "temperature_sensor::read() on replay", driver_read, "ns");
+  hal::benchmark::report(
+    "temperature_sensor::read() driver cost", driver_read - replay_only, "ns");
+  return sink > 0.0f ? 0 : 1;
+}
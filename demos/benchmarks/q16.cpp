@@ -0,0 +1,163 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <cstdint>
+
+#include <libhal/dac.hpp>
+#include <libhal/pwm.hpp>
+#include <libhal/q16.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file q16.cpp
+ * @brief Cost of setting a pwm duty cycle and a dac output through the q16
+ * entry points against the float ones.
+ *
+ * Each driver turns the value into a register count: a 48000 count pwm
+ * compare register and a 12 bit dac code. The "fallback" rows use drivers
+ * that only implement the float virtuals, so q16 values are converted to
+ * float by the interface first.
+ *
+ * A host FPU makes float and integer scaling cost about the same. On cores
+ * without one, such as the Cortex-M0, every float multiply and conversion is
+ * a library call, so the gap is expected to be far wider than reported here.
+ */
+namespace {
+constexpr std::size_t values_per_call = 1024;
+constexpr std::size_t calls = 20'000;
+constexpr std::uint32_t pwm_period = 48'000;
+constexpr std::uint32_t dac_full_scale = 4095;
+
+std::array<float, values_per_call> floats{};
+std::array<hal::q16, values_per_call> fractions{};
+
+class compare_pwm : public hal::pwm
+{
+public:
+  explicit compare_pwm(bool p_fixed_point)
+    : m_fixed_point(p_fixed_point)
+  {
+  }
+
+  std::uint32_t m_compare = 0;
+
+private:
+  hal::result<frequency_t> driver_frequency(hal::hertz) override
+  {
+    return frequency_t{};
+  }
+  hal::result<duty_cycle_t> driver_duty_cycle(float p_duty_cycle) override
+  {
+    m_compare = static_cast<std::uint32_t>(p_duty_cycle * pwm_period + 0.5f);
+    return duty_cycle_t{};
+  }
+  hal::result<duty_cycle_t> driver_duty_cycle_fraction(
+    hal::q16 p_duty_cycle) override
+  {
+    if (!m_fixed_point) {
+      return driver_duty_cycle(p_duty_cycle.to_float());
+    }
+    m_compare = p_duty_cycle.scale(pwm_period);
+    return duty_cycle_t{};
+  }
+
+  bool m_fixed_point;
+};
+
+class code_dac : public hal::dac
+{
+public:
+  explicit code_dac(bool p_fixed_point)
+    : m_fixed_point(p_fixed_point)
+  {
+  }
+
+  std::uint32_t m_code = 0;
+
+private:
+  hal::result<write_t> driver_write(float p_percentage) override
+  {
+    m_code = static_cast<std::uint32_t>(p_percentage * dac_full_scale + 0.5f);
+    return write_t{};
+  }
+  hal::result<write_t> driver_write_fraction(hal::q16 p_proportion) override
+  {
+    if (!m_fixed_point) {
+      return driver_write(p_proportion.to_float());
+    }
+    m_code = p_proportion.scale(dac_full_scale);
+    return write_t{};
+  }
+
+  bool m_fixed_point;
+};
+
+template<class Value, class Write>
+void measure(const char* p_name,
+             const std::array<Value, values_per_call>& p_values,
+             Write p_write)
+{
+  const auto per_call =
+    hal::benchmark::nanoseconds_per_call(calls, [&p_values, &p_write]() {
+      for (const auto& value : p_values) {
+        (void)p_write(value);
+      }
+    });
+  hal::benchmark::report(p_name, per_call / values_per_call, "ns/value");
+}
+}  // namespace
+
+int main()
+{
+  std::uint32_t noise = 1;
+  for (std::size_t i = 0; i < values_per_call; i++) {
+    noise = noise * 1'103'515'245U + 12'345U;
+    fractions[i] = hal::q16::from_raw(noise >> 15);
+    floats[i] = fractions[i].to_float();
+  }
+
+  compare_pwm fixed_pwm(true);
+  compare_pwm float_pwm(false);
+  hal::pwm& fixed_pwm_interface = fixed_pwm;
+  hal::pwm& float_pwm_interface = float_pwm;
+  measure("pwm::duty_cycle(float)", floats, [&](float p_value) {
+    return fixed_pwm_interface.duty_cycle(p_value);
+  });
+  measure("pwm::duty_cycle(q16)", fractions, [&](hal::q16 p_value) {
+    return fixed_pwm_interface.duty_cycle(p_value);
+  });
+  measure("pwm::duty_cycle(q16) fallback", fractions, [&](hal::q16 p_value) {
+    return float_pwm_interface.duty_cycle(p_value);
+  });
+
+  code_dac fixed_dac(true);
+  code_dac float_dac(false);
+  hal::dac& fixed_dac_interface = fixed_dac;
+  hal::dac& float_dac_interface = float_dac;
+  measure("dac::write(float)", floats, [&](float p_value) {
+    return fixed_dac_interface.write(p_value);
+  });
+  measure("dac::write(q16)", fractions, [&](hal::q16 p_value) {
+    return fixed_dac_interface.write(p_value);
+  });
+  measure("dac::write(q16) fallback", fractions, [&](hal::q16 p_value) {
+    return float_dac_interface.write(p_value);
+  });
+
+  const bool pwm_agrees = fixed_pwm.m_compare - float_pwm.m_compare + 1 <= 2;
+  const bool dac_agrees = fixed_dac.m_code - float_dac.m_code + 1 <= 2;
+  return pwm_agrees && dac_agrees ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+
+#include <libhal/simulated_i2c.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file simulated_i2c.cpp
+ * @brief Host throughput of simulated_i2c with register models mounted
+ *
+ * Reports the host time of a register read (write-then-read), a register
+ * write and a NACKed transaction, and the resulting transactions per second.
+ */
+namespace {
+constexpr std::size_t iterations = 10'000'000;
+
+void report_rate(const char* p_name, double p_ns)
+{
+  hal::benchmark::report(p_name, p_ns, "ns");
+  hal::benchmark::report("  transactions per second", 1000.0 / p_ns, "M");
+}
+}  // namespace
+
+int main()
+{
+  hal::simulated_i2c bus;
+  std::array<std::array<hal::byte, 16>, 4> registers{};
+  std::array<hal::i2c_register_model, 4> models{
+    hal::i2c_register_model(registers[0]),
+    hal::i2c_register_model(registers[1]),
+    hal::i2c_register_model(registers[2]),
+    hal::i2c_register_model(registers[3]),
+  };
+  for (std::size_t i = 0; i < models.size(); i++) {
+    (void)bus.mount(static_cast<hal::byte>(0x20 + i), models[i]);
+  }
+
+  const std::array<hal::byte, 1> pointer{ 0x04 };
+  const std::array<hal::byte, 3> write{ 0x04, 0x12, 0x34 };
+  std::array<hal::byte, 2> read{};
+  hal::byte address = 0x20;
+  auto next_address = [&address]() {
+    address = static_cast<hal::byte>(0x20 + ((address + 1) & 0x3));
+    return address;
+  };
+
+  const auto read_ns = hal::benchmark::nanoseconds_per_call(iterations, [&]() {
+    (void)bus.transaction(next_address(), pointer, read, hal::never_timeout());
+  });
+  const auto write_ns =
+    hal::benchmark::nanoseconds_per_call(iterations, [&]() {
+      (void)bus.transaction(
+        next_address(), write, std::span<hal::byte>{}, hal::never_timeout());
+    });
+  const auto nack_ns = hal::benchmark::nanoseconds_per_call(iterations, [&]() {
+    (void)bus.transaction(0x50, pointer, read, hal::never_timeout());
+  });
+
+  report_rate("simulated_i2c register read", read_ns);
+  report_rate("simulated_i2c register write", write_ns);
+  report_rate("simulated_i2c NACK", nack_ns);
+  return bus.transactions() == 3 * (iterations + 1) ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include <libhal/soft_pwm.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file soft_pwm.cpp
+ * @brief CPU cost and edge timing of `hal::soft_pwm` driving 8 channels at
+ * 1 kHz.
+ *
+ * The timer runs in virtual time and adds a pseudo random 0 to 5 us of
+ * interrupt latency to every callback. The host time per callback is the CPU
+ * cost of the engine and pin writes. The timing rows compare where the
+ * period starts land after 10000 periods against where they should be, and
+ * against the latency a scheduler timing each callback from the previous one
+ * would have accumulated.
+ */
+namespace {
+using namespace hal::literals;
+
+constexpr std::size_t channels = 8;
+constexpr std::uint64_t periods = 10'000;
+constexpr std::uint64_t period_ns = 1'000'000;
+
+/// Timer that runs its callback on demand, in virtual time with latency
+class virtual_timer : public hal::timer
+{
+public:
+  hal::callback<void(void)> m_callback = []() {};
+  std::uint64_t m_now = 0;
+  std::uint64_t m_due = 0;
+  std::uint64_t m_total_latency = 0;
+  std::uint64_t m_max_late = 0;
+  std::uint32_t m_noise = 1;
+
+  void fire()
+  {
+    m_noise = m_noise * 1'103'515'245U + 12'345U;
+    const auto latency = (m_noise >> 16) % 5'000U;
+    m_total_latency += latency;
+    m_max_late = std::max<std::uint64_t>(m_max_late, latency);
+    m_now = m_due + latency;
+    m_callback();
+  }
+
+private:
+  hal::result<is_running_t> driver_is_running() override
+  {
+    return is_running_t{ .is_running = true };
+  }
+  hal::result<cancel_t> driver_cancel() override
+  {
+    return cancel_t{};
+  }
+  hal::result<schedule_t> driver_schedule(hal::callback<void(void)> p_callback,
+                                          hal::time_duration p_delay) override
+  {
+    m_callback = p_callback;
+    m_due = m_now + static_cast<std::uint64_t>(p_delay.count());
+    return schedule_t{};
+  }
+};
+
+/// 1 GHz clock reading the virtual timer's nanoseconds
+class virtual_clock : public hal::steady_clock
+{
+public:
+  explicit virtual_clock(virtual_timer& p_timer)
+    : m_timer(&p_timer)
+  {
+  }
+
+private:
+  frequency_t driver_frequency() override
+  {
+    return frequency_t{ .operating_frequency = 1.0_GHz };
+  }
+  uptime_t driver_uptime() override
+  {
+    return uptime_t{ .ticks = m_timer->m_now };
+  }
+
+  virtual_timer* m_timer;
+};
+
+/// Pin recording the virtual time the channel last went HIGH
+class rising_edge_pin : public hal::output_pin
+{
+public:
+  explicit rising_edge_pin(virtual_timer& p_timer)
+    : m_timer(&p_timer)
+  {
+  }
+
+  std::uint64_t m_last_rise = 0;
+  std::uint64_t m_rises = 0;
+
+private:
+  hal::status driver_configure(const settings&) override
+  {
+    return hal::success();
+  }
+  hal::result<set_level_t> driver_level(bool p_high) override
+  {
+    if (p_high && !m_level) {
+      m_last_rise = m_timer->m_now;
+      m_rises++;
+    }
+    m_level = p_high;
+    return set_level_t{};
+  }
+  hal::result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_level };
+  }
+
+  virtual_timer* m_timer;
+  bool m_level = false;
+};
+}  // namespace
+
+int main()
+{
+  virtual_timer timer;
+  virtual_clock clock(timer);
+  std::array<rising_edge_pin, channels> pins{
+    rising_edge_pin(timer), rising_edge_pin(timer), rising_edge_pin(timer),
+    rising_edge_pin(timer), rising_edge_pin(timer), rising_edge_pin(timer),
+    rising_edge_pin(timer), rising_edge_pin(timer),
+  };
+  std::array<hal::output_pin*, channels> outputs{};
+  for (std::size_t i = 0; i < channels; i++) {
+    outputs[i] = &pins[i];
+  }
+  hal::soft_pwm<channels> engine(outputs, timer, clock, 1.0_kHz);
+  for (std::size_t i = 0; i < channels; i++) {
+    const auto duty_cycle = static_cast<float>(i + 1) / (channels + 2);
+    (void)engine[i].duty_cycle(duty_cycle);
+  }
+  (void)engine.start();
+
+  // Each period has one callback per distinct LOW time plus its start
+  constexpr std::uint64_t callbacks = periods * (channels + 1);
+  const auto per_callback = hal::benchmark::nanoseconds_per_call(
+    callbacks, [&timer]() { timer.fire(); });
+  hal::benchmark::report("soft_pwm<8> callback", per_callback, "ns");
+
+  // The warm up call makes one more callback than counted above
+  const auto ideal = (pins[0].m_rises - 1) * period_ns;
+  const auto error = static_cast<double>(pins[0].m_last_rise - ideal);
+  hal::benchmark::report("period start error after 10000 periods", error, "ns");
+  hal::benchmark::report(
+    "worst callback latency", static_cast<double>(timer.m_max_late), "ns");
+  hal::benchmark::report("relative scheduling error after 10000 periods",
+                         static_cast<double>(timer.m_total_latency),
+                         "ns");
+
+  return engine.pin_errors() == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+#include <libhal/simulated_spi_flash.hpp>
+#include <libhal/spi_device.hpp>
+#include <libhal/spi_flash.hpp>
+
+#include "benchmark.hpp"
+
+/**
+ * @file spi_flash_log.cpp
+ * @brief Log throughput of `hal::spi_flash` on a simulated flash
+ *
+ * Appends fixed size log records to a simulated flash running at 50 MHz with
+ * typical program and erase times, erasing each sector just before the log
+ * reaches it. Reports the throughput in the flash's virtual time, which is
+ * what the log would achieve on a real device, and the host time taken to
+ * simulate each record.
+ */
+namespace {
+using namespace hal::literals;
+
+constexpr std::size_t flash_size = 1024 * 1024;
+constexpr std::size_t record_size = 48;
+constexpr std::size_t records = flash_size / record_size;
+
+hal::status append_all(hal::spi_flash& p_flash,
+                       std::span<const hal::byte> p_record)
+{
+  std::uint32_t address = 0;
+  for (std::size_t i = 0; i < records; i++) {
+    // Erase each sector before the first record that reaches into it
+    const auto end = address + p_record.size() - 1;
+    const auto sector_size = hal::simulated_spi_flash::sector_size;
+    if (address == 0 || end / sector_size != (address - 1) / sector_size) {
+      HAL_CHECK(p_flash.erase_sector(end, hal::never_timeout()));
+    }
+    HAL_CHECK(p_flash.write(address, p_record, hal::never_timeout()));
+    address += static_cast<std::uint32_t>(p_record.size());
+  }
+  HAL_CHECK(p_flash.wait(hal::never_timeout()));
+  return hal::success();
+}
+}  // namespace
+
+int main()
+{
+  std::vector<hal::byte> storage(flash_size, 0xFF);
+  hal::simulated_spi_flash device(storage);
+  hal::spi_bus bus(device);
+  auto spi = hal::spi_device::create(
+               bus, device.chip_select(), { .clock_rate = 50.0_MHz })
+               .value();
+  auto flash = hal::spi_flash::create(spi).value();
+  std::array<hal::byte, record_size> record{};
+  record.fill(0x5A);
+
+  const auto host_start = std::chrono::steady_clock::now();
+  const auto start = device.clock().uptime().ticks;
+  const bool succeeded = bool{ append_all(flash, record) };
+  const auto virtual_ns =
+    static_cast<double>(device.clock().uptime().ticks - start);
+  const std::chrono::duration<double, std::nano> host_ns =
+    std::chrono::steady_clock::now() - host_start;
+
+  const auto logged_bytes = static_cast<double>(records * record_size);
+  hal::benchmark::report("spi_flash log throughput (virtual time)",
+                         logged_bytes / 1024.0 / (virtual_ns / 1e9),
+                         "KiB/s");
+  // Mostly the simulation of the status polls while the flash is busy
+  hal::benchmark::report("host time to simulate one record",
+                         host_ns.count() / static_cast<double>(records),
+                         "ns");
+  return succeeded && storage[flash_size / 2] == 0x5A ? 0 : 1;
+}
@@ -14,6 +14,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
 #include "error.hpp"
 
 namespace hal {
@@ -47,6 +52,53 @@ public:
     float sample;
   };
 
+  /**
+   * @brief Result from reading the adc without conversion to float.
+   *
+   */
+  struct read_raw_t
+  {
+    /**
+     * @brief Output code of the converter
+     *
+     * Between 0 (Vss) and 2^resolution - 1 (Vcc).
+     */
+    std::uint32_t code;
+
+    /**
+     * @brief Number of bits in the code
+     *
+     */
+    std::uint8_t resolution;
+  };
+
+  /// Resolution of the raw codes derived from `read()` by drivers that do not
+  /// report their own.
+  static constexpr std::uint8_t default_raw_resolution = 16;
+
+  /**
+   * @brief Result from reading a block of samples from the adc.
+   *
+   */
+  struct read_block_t
+  {
+    /**
+     * @brief The filled portion of the buffer passed to `read_block()`
+     *
+     * Each sample follows the same rules as `read_t::sample`.
+     */
+    std::span<float> samples;
+
+    /**
+     * @brief Number of samples lost since the previous read
+     *
+     * Drivers that capture continuously into a FIFO or DMA buffer report the
+     * number of samples overwritten before they could be read. A value above
+     * 0 means there is a gap between the previous block and this one.
+     */
+    std::uint32_t dropped = 0;
+  };
+
   /**
    * @brief Sample the analog to digital converter and return the result
    *
@@ -57,9 +109,76 @@ public:
     return driver_read();
   }
 
+  /**
+   * @brief Sample the analog to digital converter and return its output code
+   *
+   * Avoids float arithmetic for drivers that read integer codes from their
+   * hardware and applications that filter in integer arithmetic. Drivers that
+   * only provide a float sample return it scaled to a code of
+   * `default_raw_resolution` bits.
+   *
+   * @return result<read_raw_t> - the output code and its resolution
+   */
+  [[nodiscard]] result<read_raw_t> read_raw()
+  {
+    return driver_read_raw();
+  }
+
+  /**
+   * @brief Fill a buffer with consecutive samples
+   *
+   * Drivers that can capture with a hardware trigger, FIFO or DMA take the
+   * samples at the converter's configured sample rate. Otherwise, `read()` is
+   * called once per sample and the samples are taken as fast as the driver
+   * allows.
+   *
+   * @param p_samples - buffer to fill with samples
+   * @return result<read_block_t> - the samples captured and the number of
+   * samples dropped
+   */
+  [[nodiscard]] result<read_block_t> read_block(std::span<float> p_samples)
+  {
+    return driver_read_block(p_samples);
+  }
+
   virtual ~adc() = default;
 
 private:
   virtual result<read_t> driver_read() = 0;
+
+  /**
+   * @brief Implementation of `read_raw()`
+   *
+   * Drivers that read integer codes from their hardware should override this
+   * to return the code before it is converted to float.
+   *
+   * @return result<read_raw_t> - the output code and its resolution
+   */
+  virtual result<read_raw_t> driver_read_raw()
+  {
+    constexpr auto max_code = (1U << default_raw_resolution) - 1U;
+    const auto sample = std::clamp(HAL_CHECK(driver_read()).sample, 0.0f, 1.0f);
+    return read_raw_t{
+      .code = static_cast<std::uint32_t>(std::lround(sample * max_code)),
+      .resolution = default_raw_resolution,
+    };
+  }
+
+  /**
+   * @brief Implementation of `read_block()`
+   *
+   * Drivers with hardware assisted capture should override this to copy the
+   * samples out of their FIFO or DMA buffer.
+   *
+   * @param p_samples - buffer to fill with samples
+   * @return result<read_block_t> - the samples captured
+   */
+  virtual result<read_block_t> driver_read_block(std::span<float> p_samples)
+  {
+    for (auto& sample : p_samples) {
+      sample = HAL_CHECK(driver_read()).sample;
+    }
+    return read_block_t{ .samples = p_samples };
+  }
 };
 }  // namespace hal
@@ -0,0 +1,154 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "adc.hpp"
+#include "error.hpp"
+#include "steady_clock.hpp"
+
+namespace hal {
+/**
+ * @brief Multi-channel Analog to Digital Converter (ADC) interface
+ *
+ * Use this interface for converters that sample a fixed group of channels in
+ * one conversion sequence, such as an ADC peripheral in scan mode or several
+ * converters sharing a trigger. Sampling the channels together keeps the skew
+ * between them to the converter's sequence time, which matters when the
+ * channels are combined, for example the phase currents of a motor.
+ *
+ * Use `hal::sequential_adc_scan` to group individual `hal::adc` channels when
+ * the hardware has no scan mode.
+ */
+class adc_scan
+{
+public:
+  /**
+   * @brief Result from scanning the channels
+   *
+   */
+  struct read_t
+  {
+    /**
+     * @brief One sample per channel, in channel order
+     *
+     * The filled portion of the buffer passed to `read()`. Each sample follows
+     * the same rules as `hal::adc::read_t::sample`.
+     */
+    std::span<float> samples;
+
+    /**
+     * @brief Steady clock ticks when the sequence started
+     *
+     * Only provided by drivers that have access to a steady clock.
+     */
+    std::optional<std::uint64_t> timestamp{};
+  };
+
+  /**
+   * @brief Get the number of channels in the group
+   *
+   * @return std::size_t - number of channels sampled by `read()`
+   */
+  [[nodiscard]] std::size_t channels()
+  {
+    return driver_channels();
+  }
+
+  /**
+   * @brief Sample every channel in one conversion sequence
+   *
+   * @param p_samples - buffer to receive one sample per channel. If it holds
+   * fewer than `channels()` samples, the samples of the remaining channels
+   * are dropped.
+   * @return result<read_t> - the samples and when they were taken
+   */
+  [[nodiscard]] result<read_t> read(std::span<float> p_samples)
+  {
+    return driver_read(p_samples);
+  }
+
+  virtual ~adc_scan() = default;
+
+private:
+  virtual std::size_t driver_channels() = 0;
+  virtual result<read_t> driver_read(std::span<float> p_samples) = 0;
+};
+
+/**
+ * @brief Scan group made of individual adc channels read one after another
+ *
+ * The channels are read in order, so the samples are skewed by the time each
+ * `hal::adc::read()` takes. When constructed with a steady clock, the
+ * timestamp is taken just before the first channel is read.
+ */
+class sequential_adc_scan : public hal::adc_scan
+{
+public:
+  /**
+   * @brief Construct a scan group without timestamps
+   *
+   * @param p_channels - the channels of the group, in order. The span must
+   * outlive this object.
+   */
+  explicit sequential_adc_scan(std::span<hal::adc* const> p_channels)
+    : m_channels(p_channels)
+  {
+  }
+
+  /**
+   * @brief Construct a scan group with timestamps
+   *
+   * @param p_channels - the channels of the group, in order. The span must
+   * outlive this object.
+   * @param p_clock - steady clock used to timestamp each scan
+   */
+  sequential_adc_scan(std::span<hal::adc* const> p_channels,
+                      hal::steady_clock& p_clock)
+    : m_channels(p_channels)
+    , m_clock(&p_clock)
+  {
+  }
+
+private:
+  std::size_t driver_channels() override
+  {
+    return m_channels.size();
+  }
+
+  result<read_t> driver_read(std::span<float> p_samples) override
+  {
+    read_t scan{};
+    if (m_clock) {
+      scan.timestamp = m_clock->uptime().ticks;
+    }
+
+    const auto count = std::min(p_samples.size(), m_channels.size());
+    for (std::size_t i = 0; i < count; i++) {
+      p_samples[i] = HAL_CHECK(m_channels[i]->read()).sample;
+    }
+    scan.samples = p_samples.first(count);
+    return scan;
+  }
+
+  std::span<hal::adc* const> m_channels;
+  hal::steady_clock* m_clock = nullptr;
+};
+}  // namespace hal
@@ -0,0 +1,358 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <span>
+
+#include "error.hpp"
+#include "functional.hpp"
+#include "i2c.hpp"
+#include "output_pin.hpp"
+#include "steady_clock.hpp"
+#include "timeout.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Software i2c controller driven by two open drain output pins
+ *
+ * Generates the i2c waveform by toggling the SCL and SDA pins from software,
+ * using the steady clock to time each half of the serial clock period. Use this
+ * when a board runs out of hardware i2c peripherals.
+ *
+ * Both pins are configured as open drain. Reading back the pins via
+ * `output_pin::level()` is used to support:
+ *
+ *   - clock stretching: after releasing SCL, the controller waits until the
+ *     line actually reads HIGH before continuing.
+ *   - arbitration loss detection: if the controller releases SDA to send a 1
+ *     and the line reads LOW, another controller has won the bus. The
+ *     controller then waits for the bus to become free and retries the
+ *     transaction, as required by `hal::i2c::transaction()`.
+ *
+ * 10-bit addresses follow `hal::i2c::transaction()`: an address of
+ * 0b1111'00xx, where xx are the top two address bits, is sent as the 10-bit
+ * header and the first byte of p_data_out as the low address byte. Other
+ * addresses above 0x7F are rejected with `std::errc::invalid_argument`.
+ *
+ * The pin and clock types are template parameters so that the bit loop can be
+ * devirtualised. When `SclPin`, `SdaPin` and `Clock` are concrete driver types
+ * marked `final`, the compiler can resolve every pin and clock call at compile
+ * time and inline them. The defaults use the abstract interfaces and result in
+ * a virtual call per pin access.
+ *
+ * @tparam SclPin - output pin type used for the serial clock line
+ * @tparam SdaPin - output pin type used for the serial data line
+ * @tparam Clock - steady clock type used to time the bits
+ */
+template<std::derived_from<hal::output_pin> SclPin = hal::output_pin,
+         std::derived_from<hal::output_pin> SdaPin = hal::output_pin,
+         std::derived_from<hal::steady_clock> Clock = hal::steady_clock>
+class bit_bang_i2c : public hal::i2c
+{
+public:
+  /**
+   * @brief Create a bit bang i2c controller
+   *
+   * Configures both pins as open drain, releases both lines and applies
+   * p_settings.
+   *
+   * @param p_scl - serial clock pin
+   * @param p_sda - serial data pin
+   * @param p_clock - steady clock used to time each bit
+   * @param p_settings - initial bus settings
+   * @return result<bit_bang_i2c> - the i2c controller
+   * @throws std::errc::invalid_argument - if the settings could not be
+   * achieved.
+   */
+  [[nodiscard]] static result<bit_bang_i2c> create(
+    SclPin& p_scl,
+    SdaPin& p_sda,
+    Clock& p_clock,
+    const settings& p_settings = {})
+  {
+    constexpr hal::output_pin::settings open_drain{ .open_drain = true };
+    HAL_CHECK(p_scl.configure(open_drain));
+    HAL_CHECK(p_sda.configure(open_drain));
+    HAL_CHECK(p_scl.level(true));
+    HAL_CHECK(p_sda.level(true));
+
+    bit_bang_i2c controller(p_scl, p_sda, p_clock);
+    HAL_CHECK(controller.driver_configure(p_settings));
+    return controller;
+  }
+
+private:
+  /// Largest address that fits in the 7 bit address field
+  static constexpr hal::byte max_address = 0x7F;
+  /// Upper bits of an address that mark it as the top of a 10-bit address
+  static constexpr hal::byte ten_bit_prefix = 0b1111'0000;
+  /// Bits of a 10-bit address marker compared against `ten_bit_prefix`
+  static constexpr hal::byte ten_bit_prefix_mask = 0b1111'1100;
+
+  static constexpr bool is_ten_bit(hal::byte p_address)
+  {
+    return (p_address & ten_bit_prefix_mask) == ten_bit_prefix;
+  }
+
+  bit_bang_i2c(SclPin& p_scl, SdaPin& p_sda, Clock& p_clock)
+    : m_scl(&p_scl)
+    , m_sda(&p_sda)
+    , m_clock(&p_clock)
+  {
+  }
+
+  status driver_configure(const settings& p_settings) override
+  {
+    if (p_settings.clock_rate <= 0.0f) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+
+    const auto clock_frequency = m_clock->frequency().operating_frequency;
+    const auto half_period = clock_frequency / (p_settings.clock_rate * 2.0f);
+    // A half period below one tick means the pins will be toggled as fast as
+    // the CPU is able to.
+    m_half_period = static_cast<std::uint64_t>(half_period);
+    return success();
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    if (p_data_out.empty() && p_data_in.empty()) {
+      return transaction_t{};
+    }
+
+    // A 10-bit address needs its low byte at the start of p_data_out
+    const bool valid_ten_bit = is_ten_bit(p_address) && !p_data_out.empty();
+    if (p_address > max_address && !valid_ten_bit) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+
+    while (true) {
+      m_arbitration_lost = false;
+      auto attempt_result =
+        attempt_transaction(p_address, p_data_out, p_data_in, p_timeout);
+
+      if (attempt_result) {
+        return transaction_t{};
+      }
+
+      if (!m_arbitration_lost) {
+        // Leave the bus in the idle state on a best effort basis. The error
+        // from the transaction is more important than an error from this.
+        (void)stop(p_timeout);
+        return attempt_result.error();
+      }
+
+      HAL_CHECK(wait_for_bus_free(p_timeout));
+    }
+  }
+
+  status attempt_transaction(hal::byte p_address,
+                             std::span<const hal::byte> p_data_out,
+                             std::span<hal::byte> p_data_in,
+                             hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    constexpr hal::byte read_flag = 1;
+    const bool ten_bit = is_ten_bit(p_address);
+    // The 10-bit header is 0b11110 followed by the top two address bits
+    const auto header = ten_bit ? ten_bit_prefix | ((p_address & 0b11) << 1)
+                                : p_address << 1;
+    const auto write_address_byte = static_cast<hal::byte>(header);
+    const auto read_address_byte =
+      static_cast<hal::byte>(write_address_byte | read_flag);
+
+    HAL_CHECK(wait_for_bus_free(p_timeout));
+    HAL_CHECK(start());
+
+    if (!p_data_out.empty()) {
+      HAL_CHECK(write_address(write_address_byte, p_timeout));
+      auto data_out = p_data_out;
+      if (ten_bit) {
+        HAL_CHECK(write_address(data_out[0], p_timeout));
+        data_out = data_out.subspan(1);
+      }
+      for (const auto& data : data_out) {
+        HAL_CHECK(p_timeout());
+        if (!HAL_CHECK(write_byte(data, p_timeout))) {
+          return hal::new_error(std::errc::io_error);
+        }
+      }
+    }
+
+    if (!p_data_in.empty()) {
+      if (!p_data_out.empty()) {
+        HAL_CHECK(repeated_start(p_timeout));
+      }
+      HAL_CHECK(write_address(read_address_byte, p_timeout));
+      for (std::size_t i = 0; i < p_data_in.size(); i++) {
+        HAL_CHECK(p_timeout());
+        const bool last_byte = i == p_data_in.size() - 1;
+        p_data_in[i] = HAL_CHECK(read_byte(!last_byte, p_timeout));
+      }
+    }
+
+    HAL_CHECK(stop(p_timeout));
+    return success();
+  }
+
+  status write_address(hal::byte p_address,
+                       hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    if (!HAL_CHECK(write_byte(p_address, p_timeout))) {
+      return hal::new_error(std::errc::no_such_device_or_address);
+    }
+    return success();
+  }
+
+  void delay_half_period()
+  {
+    const auto end = m_clock->uptime().ticks + m_half_period;
+    while (m_clock->uptime().ticks < end) {
+      continue;
+    }
+  }
+
+  /**
+   * @brief Release SCL and wait for any device stretching the clock
+   *
+   */
+  status release_scl(hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(m_scl->level(true));
+    while (!HAL_CHECK(m_scl->level()).state) {
+      HAL_CHECK(p_timeout());
+    }
+    return success();
+  }
+
+  status wait_for_bus_free(hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(m_sda->level(true));
+    HAL_CHECK(m_scl->level(true));
+    while (!HAL_CHECK(m_scl->level()).state ||
+           !HAL_CHECK(m_sda->level()).state) {
+      HAL_CHECK(p_timeout());
+    }
+    delay_half_period();
+    return success();
+  }
+
+  status start()
+  {
+    // Another controller is already using the bus
+    if (!HAL_CHECK(m_sda->level()).state) {
+      return lose_arbitration();
+    }
+    HAL_CHECK(m_sda->level(false));
+    delay_half_period();
+    HAL_CHECK(m_scl->level(false));
+    delay_half_period();
+    return success();
+  }
+
+  status repeated_start(hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(m_sda->level(true));
+    delay_half_period();
+    HAL_CHECK(release_scl(p_timeout));
+    delay_half_period();
+    return start();
+  }
+
+  status stop(hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(m_sda->level(false));
+    delay_half_period();
+    HAL_CHECK(release_scl(p_timeout));
+    delay_half_period();
+    HAL_CHECK(m_sda->level(true));
+    delay_half_period();
+    return success();
+  }
+
+  status lose_arbitration()
+  {
+    m_arbitration_lost = true;
+    return hal::new_error(std::errc::resource_unavailable_try_again);
+  }
+
+  status write_bit(bool p_bit,
+                   hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(m_sda->level(p_bit));
+    delay_half_period();
+    HAL_CHECK(release_scl(p_timeout));
+    if (p_bit && !HAL_CHECK(m_sda->level()).state) {
+      return lose_arbitration();
+    }
+    delay_half_period();
+    HAL_CHECK(m_scl->level(false));
+    return success();
+  }
+
+  result<bool> read_bit(hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(m_sda->level(true));
+    delay_half_period();
+    HAL_CHECK(release_scl(p_timeout));
+    const bool bit = HAL_CHECK(m_sda->level()).state;
+    delay_half_period();
+    HAL_CHECK(m_scl->level(false));
+    return bit;
+  }
+
+  /**
+   * @brief Write a byte to the bus
+   *
+   * @return result<bool> - true if the byte was acknowledged
+   */
+  result<bool> write_byte(hal::byte p_byte,
+                          hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    for (int bit = 7; bit >= 0; bit--) {
+      HAL_CHECK(write_bit((p_byte >> bit) & 1, p_timeout));
+    }
+    const bool nack = HAL_CHECK(read_bit(p_timeout));
+    return !nack;
+  }
+
+  result<hal::byte> read_byte(
+    bool p_acknowledge,
+    hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    hal::byte data = 0;
+    for (int bit = 0; bit < 8; bit++) {
+      const bool bit_value = HAL_CHECK(read_bit(p_timeout));
+      data = static_cast<hal::byte>((data << 1) | (bit_value ? 1 : 0));
+    }
+    // The controller pulls SDA LOW to acknowledge a byte
+    HAL_CHECK(write_bit(!p_acknowledge, p_timeout));
+    return data;
+  }
+
+  SclPin* m_scl;
+  SdaPin* m_sda;
+  Clock* m_clock;
+  std::uint64_t m_half_period = 0;
+  bool m_arbitration_lost = false;
+};
+}  // namespace hal
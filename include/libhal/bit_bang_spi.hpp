@@ -0,0 +1,299 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <span>
+
+#include "error.hpp"
+#include "input_pin.hpp"
+#include "output_pin.hpp"
+#include "spi.hpp"
+#include "steady_clock.hpp"
+#include "units.hpp"
+
+namespace hal {
+template<bool ClockIdlesHigh,
+         bool DataValidOnTrailingEdge,
+         std::derived_from<hal::output_pin> SckPin,
+         std::derived_from<hal::output_pin> MosiPin,
+         std::derived_from<hal::input_pin> MisoPin,
+         std::derived_from<hal::steady_clock> Clock>
+class static_bit_bang_spi;
+
+/**
+ * @brief Software spi controller driven by output and input pins
+ *
+ * Generates the spi waveform by toggling the SCK and MOSI pins from software
+ * and sampling the MISO pin, using the steady clock to time each half of the
+ * serial clock period. Use this when a board runs out of hardware spi
+ * peripherals. Chip select is not managed, see `hal::spi_device`.
+ *
+ * The clock polarity and phase can be changed at runtime via `configure()`.
+ * Each transfer selects one of four shift loops, one per mode, in which the
+ * polarity and phase are compile time constants. When the mode is fixed, use
+ * `hal::static_bit_bang_spi` to skip the selection.
+ *
+ * The pin and clock types are template parameters so that the bit loop can be
+ * devirtualised. When they are concrete driver types marked `final`, the
+ * compiler can resolve every pin and clock call at compile time and inline
+ * them. The defaults use the abstract interfaces and result in a virtual call
+ * per pin access.
+ *
+ * @tparam SckPin - output pin type used for the serial clock line
+ * @tparam MosiPin - output pin type used for the controller data out line
+ * @tparam MisoPin - input pin type used for the controller data in line
+ * @tparam Clock - steady clock type used to time the bits
+ */
+template<std::derived_from<hal::output_pin> SckPin = hal::output_pin,
+         std::derived_from<hal::output_pin> MosiPin = hal::output_pin,
+         std::derived_from<hal::input_pin> MisoPin = hal::input_pin,
+         std::derived_from<hal::steady_clock> Clock = hal::steady_clock>
+class bit_bang_spi : public hal::spi
+{
+public:
+  /**
+   * @brief Create a bit bang spi controller
+   *
+   * Configures SCK and MOSI as push-pull outputs, applies p_settings and
+   * leaves SCK at its idle level.
+   *
+   * @param p_sck - serial clock pin
+   * @param p_mosi - controller data out pin
+   * @param p_miso - controller data in pin
+   * @param p_clock - steady clock used to time each bit
+   * @param p_settings - initial bus settings
+   * @return result<bit_bang_spi> - the spi controller
+   * @throws std::errc::invalid_argument - if the settings could not be
+   * achieved.
+   */
+  [[nodiscard]] static result<bit_bang_spi> create(
+    SckPin& p_sck,
+    MosiPin& p_mosi,
+    MisoPin& p_miso,
+    Clock& p_clock,
+    const settings& p_settings = {})
+  {
+    constexpr hal::output_pin::settings push_pull{ .open_drain = false };
+    HAL_CHECK(p_sck.configure(push_pull));
+    HAL_CHECK(p_mosi.configure(push_pull));
+
+    bit_bang_spi controller(p_sck, p_mosi, p_miso, p_clock);
+    HAL_CHECK(controller.driver_configure(p_settings));
+    return controller;
+  }
+
+private:
+  template<bool ClockIdlesHigh,
+           bool DataValidOnTrailingEdge,
+           std::derived_from<hal::output_pin>,
+           std::derived_from<hal::output_pin>,
+           std::derived_from<hal::input_pin>,
+           std::derived_from<hal::steady_clock>>
+  friend class static_bit_bang_spi;
+
+  bit_bang_spi(SckPin& p_sck, MosiPin& p_mosi, MisoPin& p_miso, Clock& p_clock)
+    : m_sck(&p_sck)
+    , m_mosi(&p_mosi)
+    , m_miso(&p_miso)
+    , m_clock(&p_clock)
+  {
+  }
+
+  status driver_configure(const settings& p_settings) override
+  {
+    if (p_settings.clock_rate <= 0.0f) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+
+    const auto clock_frequency = m_clock->frequency().operating_frequency;
+    const auto half_period = clock_frequency / (p_settings.clock_rate * 2.0f);
+    // A half period below one tick means the pins will be toggled as fast as
+    // the CPU is able to.
+    m_half_period = static_cast<std::uint64_t>(half_period);
+    m_clock_idles_high = p_settings.clock_idles_high;
+    m_data_valid_on_trailing_edge = p_settings.data_valid_on_trailing_edge;
+    HAL_CHECK(m_sck->level(m_clock_idles_high));
+    return success();
+  }
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte> p_data_out,
+                                     std::span<hal::byte> p_data_in,
+                                     hal::byte p_filler) override
+  {
+    if (m_clock_idles_high) {
+      if (m_data_valid_on_trailing_edge) {
+        return shift<true, true>(p_data_out, p_data_in, p_filler);
+      }
+      return shift<true, false>(p_data_out, p_data_in, p_filler);
+    }
+    if (m_data_valid_on_trailing_edge) {
+      return shift<false, true>(p_data_out, p_data_in, p_filler);
+    }
+    return shift<false, false>(p_data_out, p_data_in, p_filler);
+  }
+
+  /**
+   * @brief Shift bytes in and out of the bus in a fixed spi mode
+   *
+   * With the data valid on the leading edge (phase 0), MOSI is set before the
+   * leading edge and MISO is sampled on it. With the data valid on the
+   * trailing edge (phase 1), MOSI is set after the leading edge and MISO is
+   * sampled on the trailing edge.
+   */
+  template<bool ClockIdlesHigh, bool DataValidOnTrailingEdge>
+  result<transfer_t> shift(std::span<const hal::byte> p_data_out,
+                           std::span<hal::byte> p_data_in,
+                           hal::byte p_filler)
+  {
+    constexpr bool idle = ClockIdlesHigh;
+    constexpr bool active = !ClockIdlesHigh;
+    const auto length = std::max(p_data_out.size(), p_data_in.size());
+
+    for (std::size_t i = 0; i < length; i++) {
+      const auto byte_out = i < p_data_out.size() ? p_data_out[i] : p_filler;
+      hal::byte byte_in = 0;
+
+      for (int bit = 7; bit >= 0; bit--) {
+        const bool bit_out = (byte_out >> bit) & 1;
+        bool bit_in = false;
+
+        if constexpr (DataValidOnTrailingEdge) {
+          HAL_CHECK(m_sck->level(active));
+          HAL_CHECK(m_mosi->level(bit_out));
+          delay_half_period();
+          HAL_CHECK(m_sck->level(idle));
+          bit_in = HAL_CHECK(m_miso->level()).state;
+          delay_half_period();
+        } else {
+          HAL_CHECK(m_mosi->level(bit_out));
+          delay_half_period();
+          HAL_CHECK(m_sck->level(active));
+          bit_in = HAL_CHECK(m_miso->level()).state;
+          delay_half_period();
+          HAL_CHECK(m_sck->level(idle));
+        }
+
+        byte_in = static_cast<hal::byte>((byte_in << 1) | (bit_in ? 1 : 0));
+      }
+
+      if (i < p_data_in.size()) {
+        p_data_in[i] = byte_in;
+      }
+    }
+
+    return transfer_t{};
+  }
+
+  void delay_half_period()
+  {
+    const auto end = m_clock->uptime().ticks + m_half_period;
+    while (m_clock->uptime().ticks < end) {
+      continue;
+    }
+  }
+
+  SckPin* m_sck;
+  MosiPin* m_mosi;
+  MisoPin* m_miso;
+  Clock* m_clock;
+  std::uint64_t m_half_period = 0;
+  bool m_clock_idles_high = false;
+  bool m_data_valid_on_trailing_edge = false;
+};
+
+/**
+ * @brief Software spi controller with the spi mode fixed at compile time
+ *
+ * Same as `hal::bit_bang_spi`, but every transfer goes straight to the shift
+ * loop for the given mode. `configure()` only accepts settings whose polarity
+ * and phase match the template parameters.
+ *
+ * @tparam ClockIdlesHigh - see `hal::spi::settings::clock_idles_high`
+ * @tparam DataValidOnTrailingEdge - see
+ * `hal::spi::settings::data_valid_on_trailing_edge`
+ * @tparam SckPin - output pin type used for the serial clock line
+ * @tparam MosiPin - output pin type used for the controller data out line
+ * @tparam MisoPin - input pin type used for the controller data in line
+ * @tparam Clock - steady clock type used to time the bits
+ */
+template<bool ClockIdlesHigh,
+         bool DataValidOnTrailingEdge,
+         std::derived_from<hal::output_pin> SckPin = hal::output_pin,
+         std::derived_from<hal::output_pin> MosiPin = hal::output_pin,
+         std::derived_from<hal::input_pin> MisoPin = hal::input_pin,
+         std::derived_from<hal::steady_clock> Clock = hal::steady_clock>
+class static_bit_bang_spi : public hal::spi
+{
+public:
+  /**
+   * @brief Create a bit bang spi controller with a fixed spi mode
+   *
+   * @param p_sck - serial clock pin
+   * @param p_mosi - controller data out pin
+   * @param p_miso - controller data in pin
+   * @param p_clock - steady clock used to time each bit
+   * @param p_clock_rate - serial clock frequency
+   * @return result<static_bit_bang_spi> - the spi controller
+   * @throws std::errc::invalid_argument - if the clock rate could not be
+   * achieved.
+   */
+  [[nodiscard]] static result<static_bit_bang_spi> create(
+    SckPin& p_sck,
+    MosiPin& p_mosi,
+    MisoPin& p_miso,
+    Clock& p_clock,
+    hertz p_clock_rate = settings{}.clock_rate)
+  {
+    const settings mode_settings{
+      .clock_rate = p_clock_rate,
+      .clock_idles_high = ClockIdlesHigh,
+      .data_valid_on_trailing_edge = DataValidOnTrailingEdge,
+    };
+    auto controller = HAL_CHECK(
+      controller_t::create(p_sck, p_mosi, p_miso, p_clock, mode_settings));
+    return static_bit_bang_spi(controller);
+  }
+
+private:
+  using controller_t = bit_bang_spi<SckPin, MosiPin, MisoPin, Clock>;
+
+  explicit static_bit_bang_spi(controller_t p_controller)
+    : m_controller(p_controller)
+  {
+  }
+
+  status driver_configure(const settings& p_settings) override
+  {
+    if (p_settings.clock_idles_high != ClockIdlesHigh ||
+        p_settings.data_valid_on_trailing_edge != DataValidOnTrailingEdge) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    return m_controller.driver_configure(p_settings);
+  }
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte> p_data_out,
+                                     std::span<hal::byte> p_data_in,
+                                     hal::byte p_filler) override
+  {
+    return m_controller.template shift<ClockIdlesHigh, DataValidOnTrailingEdge>(
+      p_data_out, p_data_in, p_filler);
+  }
+
+  controller_t m_controller;
+};
+}  // namespace hal
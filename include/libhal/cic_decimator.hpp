@@ -0,0 +1,272 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+#include "adc.hpp"
+#include "error.hpp"
+
+namespace hal {
+/**
+ * @brief Cascaded integrator-comb (CIC) decimation filter
+ *
+ * Reduces the sample rate of a stream of adc output codes by an integer
+ * ratio, while averaging away noise to gain resolution. Only integer
+ * additions and subtractions are performed per sample, which suits cores
+ * without an FPU.
+ *
+ * The output codes have a gain of ratio^Order compared to the input codes.
+ * The registers are 32 bits wide and rely on unsigned wrap around, so the
+ * full scale output code, `max_code()`, must fit in 32 bits. The first Order
+ * outputs after creation or `reset()` are part of the filter's step response
+ * and should be discarded.
+ *
+ * @tparam Order - number of integrator and comb stages
+ */
+template<std::size_t Order = 3>
+class cic_decimator
+{
+public:
+  static_assert(Order > 0, "cic_decimator needs at least one stage");
+
+  /**
+   * @brief Create a CIC decimator
+   *
+   * @param p_ratio - number of input samples per output sample
+   * @param p_input_resolution - number of bits in the input codes
+   * @return result<cic_decimator> - the decimator
+   * @throws std::errc::invalid_argument - if the ratio is 0 or the full scale
+   * output code does not fit in 32 bits.
+   */
+  [[nodiscard]] static result<cic_decimator> create(
+    std::uint32_t p_ratio,
+    std::uint8_t p_input_resolution)
+  {
+    if (p_ratio == 0 || p_input_resolution == 0 || p_input_resolution > 32) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+
+    std::uint64_t max_code = (std::uint64_t{ 1 } << p_input_resolution) - 1;
+    for (std::size_t stage = 0; stage < Order; stage++) {
+      max_code *= p_ratio;
+      if (max_code > std::numeric_limits<std::uint32_t>::max()) {
+        return hal::new_error(std::errc::invalid_argument);
+      }
+    }
+
+    return cic_decimator(p_ratio, static_cast<std::uint32_t>(max_code));
+  }
+
+  /**
+   * @brief Filter and decimate a block of input codes
+   *
+   * The input is consumed entirely. The decimation phase carries over between
+   * calls, so the input can be split into blocks of any size.
+   *
+   * @param p_input - input codes
+   * @param p_output - buffer for the output codes. Needs room for
+   * p_input.size() / ratio() + 1 codes, outputs that do not fit are dropped.
+   * @return std::span<std::uint32_t> - the filled portion of p_output
+   */
+  std::span<std::uint32_t> process(std::span<const std::uint32_t> p_input,
+                                   std::span<std::uint32_t> p_output)
+  {
+    std::size_t count = 0;
+    for (const auto code : p_input) {
+      std::uint32_t output = 0;
+      if (process(code, output) && count < p_output.size()) {
+        p_output[count++] = output;
+      }
+    }
+    return p_output.first(count);
+  }
+
+  /**
+   * @brief Filter a single input code
+   *
+   * @param p_code - input code
+   * @param p_output - receives the output code when one is produced
+   * @return true - an output code was produced, which happens once every
+   * ratio() input codes
+   */
+  bool process(std::uint32_t p_code, std::uint32_t& p_output)
+  {
+    auto value = p_code;
+    for (auto& integrator : m_integrators) {
+      integrator += value;
+      value = integrator;
+    }
+
+    if (++m_phase < m_ratio) {
+      return false;
+    }
+    m_phase = 0;
+
+    for (auto& delayed : m_combs) {
+      const auto difference = value - delayed;
+      delayed = value;
+      value = difference;
+    }
+    p_output = value;
+    return true;
+  }
+
+  /**
+   * @brief Get the decimation ratio
+   *
+   * @return std::uint32_t - number of input samples per output sample
+   */
+  [[nodiscard]] std::uint32_t ratio() const
+  {
+    return m_ratio;
+  }
+
+  /**
+   * @brief Get the output code for a full scale input
+   *
+   * @return std::uint32_t - (2^input resolution - 1) * ratio^Order
+   */
+  [[nodiscard]] std::uint32_t max_code() const
+  {
+    return m_max_code;
+  }
+
+  /**
+   * @brief Get the number of bits needed to hold an output code
+   *
+   * @return std::uint8_t - output code resolution
+   */
+  [[nodiscard]] std::uint8_t output_resolution() const
+  {
+    return static_cast<std::uint8_t>(std::bit_width(m_max_code));
+  }
+
+  /**
+   * @brief Clear the filter's history and decimation phase
+   *
+   */
+  void reset()
+  {
+    m_integrators.fill(0);
+    m_combs.fill(0);
+    m_phase = 0;
+  }
+
+private:
+  cic_decimator(std::uint32_t p_ratio, std::uint32_t p_max_code)
+    : m_ratio(p_ratio)
+    , m_max_code(p_max_code)
+  {
+  }
+
+  std::array<std::uint32_t, Order> m_integrators{};
+  std::array<std::uint32_t, Order> m_combs{};
+  std::uint32_t m_ratio;
+  std::uint32_t m_max_code;
+  std::uint32_t m_phase = 0;
+};
+
+/**
+ * @brief Oversampling adc built on a CIC decimator
+ *
+ * Each sample is produced from ratio() raw codes read from another adc and
+ * filtered with `hal::cic_decimator`. `read_raw()` returns the decimator's
+ * output with its extended resolution, avoiding float arithmetic. As the
+ * decimator's full scale output, `max_code()`, is rarely a power of 2 minus
+ * 1, the code is rescaled with integer arithmetic so that a full scale input
+ * reads as 2^resolution - 1, like any other adc.
+ *
+ * @tparam Order - number of integrator and comb stages
+ */
+template<std::size_t Order = 3>
+class cic_adc : public hal::adc
+{
+public:
+  /**
+   * @brief Create an oversampling adc
+   *
+   * Reads one sample from p_adc to learn its resolution, then reads enough
+   * samples to settle the filter so that the first sample read is valid.
+   *
+   * @param p_adc - adc to oversample
+   * @param p_ratio - number of p_adc samples per sample
+   * @return result<cic_adc> - the oversampling adc
+   * @throws std::errc::invalid_argument - if the ratio is 0 or the output
+   * code does not fit in 32 bits.
+   */
+  [[nodiscard]] static result<cic_adc> create(hal::adc& p_adc,
+                                              std::uint32_t p_ratio)
+  {
+    const auto resolution = HAL_CHECK(p_adc.read_raw()).resolution;
+    auto decimator = HAL_CHECK(decimator_t::create(p_ratio, resolution));
+    cic_adc oversampled(p_adc, decimator);
+    for (std::size_t i = 0; i < Order; i++) {
+      HAL_CHECK(oversampled.next_output());
+    }
+    return oversampled;
+  }
+
+private:
+  using decimator_t = cic_decimator<Order>;
+
+  cic_adc(hal::adc& p_adc, const decimator_t& p_decimator)
+    : m_adc(&p_adc)
+    , m_decimator(p_decimator)
+  {
+  }
+
+  result<read_t> driver_read() override
+  {
+    const auto output = HAL_CHECK(next_output());
+    const auto max_code = static_cast<float>(m_decimator.max_code());
+    return read_t{ .sample = static_cast<float>(output) / max_code };
+  }
+
+  result<read_raw_t> driver_read_raw() override
+  {
+    const auto output = HAL_CHECK(next_output());
+    const auto resolution = m_decimator.output_resolution();
+    const auto full_scale = (std::uint64_t{ 1 } << resolution) - 1;
+    const auto max_code = std::uint64_t{ m_decimator.max_code() };
+    // Rounded; cannot overflow as both factors are below 2^32
+    const auto code = (output * full_scale + max_code / 2) / max_code;
+    return read_raw_t{
+      .code = static_cast<std::uint32_t>(code),
+      .resolution = resolution,
+    };
+  }
+
+  /// Read raw codes from the oversampled adc until an output is produced
+  result<std::uint64_t> next_output()
+  {
+    std::uint32_t output = 0;
+    bool produced = false;
+    while (!produced) {
+      const auto raw = HAL_CHECK(m_adc->read_raw());
+      produced = m_decimator.process(raw.code, output);
+    }
+    return output;
+  }
+
+  hal::adc* m_adc;
+  decimator_t m_decimator;
+};
+}  // namespace hal
@@ -17,6 +17,7 @@
 #include <cstdint>
 
 #include "error.hpp"
+#include "q16.hpp"
 
 namespace hal {
 /**
@@ -66,9 +67,36 @@ public:
     return driver_write(clamped_percentage);
   }
 
+  /**
+   * @brief Set the output voltage of the DAC without float arithmetic
+   *
+   * A q16 is always between 0 and 1, so no clamping is performed. Drivers
+   * that override this can convert the proportion to a dac code with
+   * `q16::scale()`. Otherwise, the proportion is converted to float and
+   * passed to the float implementation.
+   *
+   * @param p_proportion - proportion of the output voltage from Vss to Vcc
+   * @return result<write_t> - success or failure
+   */
+  [[nodiscard]] result<write_t> write(q16 p_proportion)
+  {
+    return driver_write_fraction(p_proportion);
+  }
+
   virtual ~dac() = default;
 
 private:
   virtual result<write_t> driver_write(float p_percentage) = 0;
+
+  /**
+   * @brief Implementation of the fixed point `write()`
+   *
+   * @param p_proportion - proportion of the output voltage from Vss to Vcc
+   * @return result<write_t> - success or failure
+   */
+  virtual result<write_t> driver_write_fraction(q16 p_proportion)
+  {
+    return driver_write(p_proportion.to_float());
+  }
 };
 }  // namespace hal
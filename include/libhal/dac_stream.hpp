@@ -0,0 +1,139 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "error.hpp"
+#include "functional.hpp"
+#include "q16.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Play buffers of samples through a dac at a fixed sample rate
+ *
+ * Up to `queue_depth` buffers can be queued, so one buffer can be refilled
+ * while the other plays. When a buffer has been played, the complete handler
+ * is called with it, from the context that played it, so that it can be
+ * refilled and submitted again. Submitting the same buffer from the handler
+ * loops it.
+ *
+ * If a sample period arrives with no buffer queued, the dac holds its last
+ * value and the period is counted as an underrun.
+ *
+ * Drivers for dacs that can be fed by DMA or triggered by a hardware timer
+ * implement this interface directly. `hal::soft_dac_stream` implements it for
+ * any `hal::dac` with a `hal::timer` writing one sample per timer callback.
+ */
+class dac_stream
+{
+public:
+  /// Called with a buffer once all of its samples have been written
+  using complete_handler = void(std::span<const q16> p_samples);
+
+  /// Number of buffers every implementation can queue
+  static constexpr std::size_t queue_depth = 2;
+
+  /**
+   * @brief Queue a buffer of samples to be played
+   *
+   * May be called from a different context than the one playing the samples,
+   * such as the main loop, while the stream is running.
+   *
+   * @param p_samples - proportions of the output voltage from Vss to Vcc, see
+   * `hal::dac::write()`. The memory must stay valid until the complete handler
+   * is called for it.
+   * @return true - the buffer was queued
+   * @return false - the queue is full or the buffer is empty
+   */
+  [[nodiscard]] bool submit(std::span<const q16> p_samples)
+  {
+    return driver_submit(p_samples);
+  }
+
+  /**
+   * @brief Set the handler called when a buffer has been played
+   *
+   * @param p_handler - called from the context playing the samples
+   */
+  void on_complete(hal::callback<complete_handler> p_handler)
+  {
+    driver_on_complete(p_handler);
+  }
+
+  /**
+   * @brief Start writing a sample every sample period
+   *
+   * @param p_sample_rate - number of samples written per second
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument - if the sample rate is not positive
+   * or cannot be generated
+   */
+  [[nodiscard]] status start(hertz p_sample_rate)
+  {
+    if (p_sample_rate <= 0.0f) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    return driver_start(p_sample_rate);
+  }
+
+  /**
+   * @brief Stop writing samples
+   *
+   * Queued buffers stay queued and continue playing from where they left off
+   * when `start()` is called again.
+   *
+   * @return status - success or failure
+   */
+  [[nodiscard]] status stop()
+  {
+    return driver_stop();
+  }
+
+  /**
+   * @brief Get the number of buffers waiting to be played or playing
+   *
+   * @return std::size_t - number of queued buffers
+   */
+  [[nodiscard]] std::size_t queued()
+  {
+    return driver_queued();
+  }
+
+  /**
+   * @brief Get the number of sample periods with no sample to write
+   *
+   * @return std::uint32_t - number of underruns since construction
+   */
+  [[nodiscard]] std::uint32_t underruns()
+  {
+    return driver_underruns();
+  }
+
+  virtual ~dac_stream() = default;
+
+private:
+  virtual bool driver_submit(std::span<const q16> p_samples) = 0;
+  virtual void driver_on_complete(
+    hal::callback<complete_handler> p_handler) = 0;
+  virtual status driver_start(hertz p_sample_rate) = 0;
+  virtual status driver_stop() = 0;
+  virtual std::size_t driver_queued() = 0;
+  virtual std::uint32_t driver_underruns() = 0;
+};
+}  // namespace hal
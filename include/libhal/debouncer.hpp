@@ -0,0 +1,282 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include "error.hpp"
+#include "functional.hpp"
+#include "interrupt_pin.hpp"
+#include "steady_clock.hpp"
+#include "timer.hpp"
+#include "units.hpp"
+
+namespace hal {
+class debounced_pin;
+
+/**
+ * @brief Debounce many interrupt pins with one timer
+ *
+ * A pin is considered stable once no edge has been seen on it for the settle
+ * time. Every edge restarts the pin's settle time, so a burst of bounces
+ * produces at most one callback, delivered one settle time after the last
+ * bounce, and only if the pin ended in a different state than it was last
+ * stable in.
+ *
+ * Pins waiting to settle are kept in a list ordered by their last edge. As
+ * every pin has the same settle time, that is also the order in which they
+ * settle, so an edge only moves its pin to the end of the list, and the timer
+ * only ever needs to wait for the pin at the front. Each edge costs O(1) and
+ * at most one timer callback is pending at any time.
+ *
+ * The timer's interrupt and the interrupts of the pins must not preempt each
+ * other, for example by giving them the same priority.
+ *
+ * If the timer fails to schedule, the failure is counted in
+ * `schedule_errors()` and the waiting pins stay in the list. The next edge on
+ * any pin schedules the timer again, and pins that settled in the meantime are
+ * delivered by that callback.
+ */
+class debouncer
+{
+public:
+  /**
+   * @brief Construct a new debouncer
+   *
+   * @param p_timer - timer used to wait for pins to settle
+   * @param p_clock - clock used to timestamp edges
+   * @param p_settle_time - time without edges after which a pin is stable
+   */
+  debouncer(hal::timer& p_timer,
+            hal::steady_clock& p_clock,
+            hal::time_duration p_settle_time)
+    : m_timer(&p_timer)
+    , m_clock(&p_clock)
+  {
+    m_frequency = m_clock->frequency().operating_frequency;
+    const std::chrono::duration<double> settle_time(p_settle_time);
+    m_settle_ticks = static_cast<std::uint64_t>(
+      std::ceil(settle_time.count() * static_cast<double>(m_frequency)));
+  }
+
+  debouncer(const debouncer&) = delete;
+  debouncer& operator=(const debouncer&) = delete;
+  debouncer(debouncer&&) = delete;
+  debouncer& operator=(debouncer&&) = delete;
+
+  /**
+   * @brief Get the number of times scheduling the timer failed
+   *
+   * @return std::uint32_t - number of failed schedules since construction
+   */
+  [[nodiscard]] std::uint32_t schedule_errors() const
+  {
+    return m_schedule_errors.load(std::memory_order_relaxed);
+  }
+
+private:
+  friend class debounced_pin;
+
+  inline void edge(debounced_pin& p_pin, bool p_state);
+  inline void expire();
+  inline void unlink(debounced_pin& p_pin);
+  void schedule(std::uint64_t p_ticks)
+  {
+    const std::chrono::duration<double> delay(static_cast<double>(p_ticks) /
+                                              static_cast<double>(m_frequency));
+    auto scheduled = m_timer->schedule(
+      [this]() { expire(); }, std::chrono::ceil<hal::time_duration>(delay));
+    if (!scheduled) {
+      // Edges and the timer do not preempt each other, so load and store
+      // suffice on cores without atomic increments
+      m_schedule_errors.store(
+        m_schedule_errors.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+      return;
+    }
+    m_armed = true;
+  }
+
+  hal::timer* m_timer;
+  hal::steady_clock* m_clock;
+  hertz m_frequency = 0.0_Hz;
+  std::uint64_t m_settle_ticks = 0;
+  debounced_pin* m_head = nullptr;
+  debounced_pin* m_tail = nullptr;
+  std::atomic<std::uint32_t> m_schedule_errors = 0;
+  bool m_armed = false;
+};
+
+/**
+ * @brief Interrupt pin that only triggers once per stable transition
+ *
+ * Wraps an interrupt pin and calls its handler from the debouncer's timer
+ * once the pin has settled. The handler receives the settled state, and is
+ * only called for settled states that match the configured trigger edge.
+ *
+ * The wrapped pin must trigger on both edges. `configure()` sets that up, so
+ * call it before relying on the pin. Until then, the wrapped pin keeps the
+ * trigger it was configured with, and a pin triggering on one edge only would
+ * never see the bounce back to the stable state.
+ */
+class debounced_pin : public hal::interrupt_pin
+{
+public:
+  /**
+   * @brief Construct a new debounced pin
+   *
+   * @param p_debouncer - debouncer shared with other pins
+   * @param p_pin - the bouncy pin. Its handler is replaced, and reset to do
+   * nothing when this object is destroyed.
+   * @param p_initial_state - state the pin is assumed to be stable in until
+   * its first edge. For a pull up and a switch to ground, this is true.
+   */
+  debounced_pin(hal::debouncer& p_debouncer,
+                hal::interrupt_pin& p_pin,
+                bool p_initial_state = true)
+    : m_debouncer(&p_debouncer)
+    , m_pin(&p_pin)
+    , m_stable_state(p_initial_state)
+    , m_last_state(p_initial_state)
+  {
+    m_pin->on_trigger(
+      [this](bool p_state) { m_debouncer->edge(*this, p_state); });
+  }
+
+  debounced_pin(const debounced_pin&) = delete;
+  debounced_pin& operator=(const debounced_pin&) = delete;
+  debounced_pin(debounced_pin&&) = delete;
+  debounced_pin& operator=(debounced_pin&&) = delete;
+
+  /**
+   * @brief Get the last stable state of the pin
+   *
+   * @return true - the pin settled HIGH
+   * @return false - the pin settled LOW
+   */
+  [[nodiscard]] bool stable_state() const
+  {
+    return m_stable_state;
+  }
+
+  ~debounced_pin() override
+  {
+    m_pin->on_trigger([](bool) {});
+    if (m_queued) {
+      m_debouncer->unlink(*this);
+    }
+  }
+
+private:
+  friend class debouncer;
+
+  status driver_configure(const settings& p_settings) override
+  {
+    auto both_edges = p_settings;
+    both_edges.trigger = trigger_edge::both;
+    HAL_CHECK(m_pin->configure(both_edges));
+    m_trigger = p_settings.trigger;
+    return success();
+  }
+
+  void driver_on_trigger(hal::callback<handler> p_callback) override
+  {
+    m_handler = p_callback;
+  }
+
+  void settle()
+  {
+    if (m_last_state == m_stable_state) {
+      return;
+    }
+    m_stable_state = m_last_state;
+    const bool wanted = m_trigger == trigger_edge::both ||
+                        (m_trigger == trigger_edge::rising) == m_stable_state;
+    if (wanted) {
+      m_handler(m_stable_state);
+    }
+  }
+
+  hal::debouncer* m_debouncer;
+  hal::interrupt_pin* m_pin;
+  hal::callback<handler> m_handler = [](bool) {};
+  std::uint64_t m_last_edge = 0;
+  debounced_pin* m_previous = nullptr;
+  debounced_pin* m_next = nullptr;
+  trigger_edge m_trigger = trigger_edge::rising;
+  bool m_stable_state;
+  bool m_last_state;
+  bool m_queued = false;
+};
+
+inline void debouncer::unlink(debounced_pin& p_pin)
+{
+  if (p_pin.m_previous) {
+    p_pin.m_previous->m_next = p_pin.m_next;
+  } else {
+    m_head = p_pin.m_next;
+  }
+  if (p_pin.m_next) {
+    p_pin.m_next->m_previous = p_pin.m_previous;
+  } else {
+    m_tail = p_pin.m_previous;
+  }
+  p_pin.m_previous = nullptr;
+  p_pin.m_next = nullptr;
+  p_pin.m_queued = false;
+}
+
+inline void debouncer::edge(debounced_pin& p_pin, bool p_state)
+{
+  p_pin.m_last_edge = m_clock->uptime().ticks;
+  p_pin.m_last_state = p_state;
+
+  if (p_pin.m_queued) {
+    unlink(p_pin);
+  }
+  p_pin.m_previous = m_tail;
+  if (m_tail) {
+    m_tail->m_next = &p_pin;
+  } else {
+    m_head = &p_pin;
+  }
+  m_tail = &p_pin;
+  p_pin.m_queued = true;
+
+  // A pending callback will reschedule itself for the front of the list
+  if (!m_armed) {
+    schedule(m_settle_ticks);
+  }
+}
+
+inline void debouncer::expire()
+{
+  m_armed = false;
+  const auto now = m_clock->uptime().ticks;
+  while (m_head) {
+    auto& pin = *m_head;
+    const auto elapsed = now - pin.m_last_edge;
+    if (elapsed < m_settle_ticks) {
+      schedule(m_settle_ticks - elapsed);
+      return;
+    }
+    unlink(pin);
+    pin.settle();
+  }
+}
+}  // namespace hal
@@ -0,0 +1,148 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "interrupt_pin.hpp"
+#include "steady_clock.hpp"
+
+namespace hal {
+/// Pin state and time of one captured edge
+struct edge_event
+{
+  /// Uptime of the steady clock when the interrupt ran
+  std::uint64_t ticks;
+  /// State of the pin reported by the interrupt
+  bool state;
+};
+
+/**
+ * @brief Record timestamped interrupt pin edges for the application to read
+ *
+ * The pin's handler only reads the steady clock and stores the edge in a
+ * single producer, single consumer queue, which keeps the time spent in the
+ * interrupt short and constant. The application drains the queue in batches,
+ * for example to measure pulse widths from the differences between ticks.
+ *
+ * When the queue is full, new edges are dropped and counted as overflows.
+ * `drain()` may be called from a different context than the interrupt, such
+ * as the main loop, without masking the interrupt.
+ *
+ * @tparam Capacity - number of edges the queue holds, a power of two
+ */
+template<std::size_t Capacity>
+class edge_capture
+{
+public:
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+  /**
+   * @brief Construct a new edge capture
+   *
+   * Configure the pin's trigger edge separately. Both edges are usually
+   * wanted when measuring pulse widths.
+   *
+   * @param p_pin - pin to capture edges from. Its handler is replaced, and
+   * reset to do nothing when this object is destroyed.
+   * @param p_clock - clock used to timestamp the edges
+   */
+  edge_capture(hal::interrupt_pin& p_pin, hal::steady_clock& p_clock)
+    : m_pin(&p_pin)
+    , m_clock(&p_clock)
+  {
+    m_pin->on_trigger([this](bool p_state) { capture(p_state); });
+  }
+
+  edge_capture(const edge_capture&) = delete;
+  edge_capture& operator=(const edge_capture&) = delete;
+  edge_capture(edge_capture&&) = delete;
+  edge_capture& operator=(edge_capture&&) = delete;
+
+  ~edge_capture()
+  {
+    m_pin->on_trigger([](bool) {});
+  }
+
+  /**
+   * @brief Move captured edges out of the queue, oldest first
+   *
+   * @param p_buffer - where to copy the edges to
+   * @return std::span<edge_event> - the part of p_buffer filled with edges.
+   * Empty if no edges were captured.
+   */
+  [[nodiscard]] std::span<edge_event> drain(std::span<edge_event> p_buffer)
+  {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    const auto head = m_head.load(std::memory_order_acquire);
+    std::size_t count = 0;
+    while (count < p_buffer.size() && tail + count != head) {
+      p_buffer[count] = m_events[(tail + count) % Capacity];
+      count++;
+    }
+    m_tail.store(tail + count, std::memory_order_release);
+    return p_buffer.first(count);
+  }
+
+  /**
+   * @brief Get the number of edges waiting to be drained
+   *
+   * @return std::size_t - number of edges in the queue
+   */
+  [[nodiscard]] std::size_t size() const
+  {
+    return m_head.load(std::memory_order_acquire) -
+           m_tail.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Get the number of edges dropped because the queue was full
+   *
+   * @return std::uint32_t - number of dropped edges since construction
+   */
+  [[nodiscard]] std::uint32_t overflows() const
+  {
+    return m_overflows.load(std::memory_order_relaxed);
+  }
+
+private:
+  void capture(bool p_state)
+  {
+    const auto ticks = m_clock->uptime().ticks;
+    const auto head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= Capacity) {
+      // Only this handler writes the count, so a load and a store are enough,
+      // and cores without atomic read-modify-write, such as ARMv6-M, have them
+      m_overflows.store(m_overflows.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+      return;
+    }
+    m_events[head % Capacity] = edge_event{ .ticks = ticks, .state = p_state };
+    m_head.store(head + 1, std::memory_order_release);
+  }
+
+  hal::interrupt_pin* m_pin;
+  hal::steady_clock* m_clock;
+  std::array<edge_event, Capacity> m_events{};
+  std::atomic<std::size_t> m_head = 0;
+  std::atomic<std::size_t> m_tail = 0;
+  std::atomic<std::uint32_t> m_overflows = 0;
+};
+}  // namespace hal
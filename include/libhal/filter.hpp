@@ -0,0 +1,464 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file filter.hpp
+ * @brief Digital filters for streams of samples, such as those from
+ * `hal::adc`.
+ *
+ * Every filter keeps its state in fixed size members and never allocates.
+ * Samples can be filtered one at a time with `process(float)` or a block at a
+ * time with `process(input, output)`. The input and output of a block may be
+ * the same buffer. Block processing produces exactly the same output as
+ * processing the samples one at a time.
+ *
+ * `fir_filter` and `biquad` have block kernels of their own, see their
+ * descriptions. Each output of `moving_average` and `median_filter` depends on
+ * the state left by the previous sample, so their block functions loop over
+ * the per sample path and are provided for a uniform interface.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <span>
+
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Average of the last Length samples
+ *
+ * A running sum makes each sample cost the same regardless of Length. The sum
+ * is recomputed from the window each time the window wraps around, so
+ * rounding errors cannot build up over long runs. Until Length samples have
+ * been processed, the missing samples count as 0.
+ *
+ * @tparam Length - number of samples averaged
+ */
+template<std::size_t Length>
+class moving_average
+{
+public:
+  static_assert(Length > 0, "moving_average needs at least one sample");
+
+  /**
+   * @brief Filter a single sample
+   *
+   * @param p_sample - the next input sample
+   * @return float - the average of the last Length samples
+   */
+  float process(float p_sample)
+  {
+    m_sum += p_sample - m_window[m_next];
+    m_window[m_next] = p_sample;
+    m_next = (m_next + 1) % Length;
+    if (m_next == 0) {
+      m_sum = 0.0f;
+      for (const auto sample : m_window) {
+        m_sum += sample;
+      }
+    }
+    return m_sum / static_cast<float>(Length);
+  }
+
+  /**
+   * @brief Filter a block of samples
+   *
+   * @param p_input - input samples
+   * @param p_output - buffer for the filtered samples. Only the first
+   * p_input.size() samples are written, it must be at least that large.
+   */
+  void process(std::span<const float> p_input, std::span<float> p_output)
+  {
+    for (std::size_t i = 0; i < p_input.size(); i++) {
+      p_output[i] = process(p_input[i]);
+    }
+  }
+
+  /**
+   * @brief Clear the filter's history
+   *
+   */
+  void reset()
+  {
+    m_window.fill(0.0f);
+    m_sum = 0.0f;
+    m_next = 0;
+  }
+
+private:
+  std::array<float, Length> m_window{};
+  float m_sum = 0.0f;
+  std::size_t m_next = 0;
+};
+
+/**
+ * @brief Median of the last Length samples
+ *
+ * Removes impulse noise, such as a single corrupted conversion, without
+ * smoothing edges. A sorted copy of the window is kept up to date so each
+ * sample costs O(Length) comparisons. Until Length samples have been
+ * processed, the missing samples count as 0.
+ *
+ * @tparam Length - number of samples in the window, must be odd
+ */
+template<std::size_t Length>
+class median_filter
+{
+public:
+  static_assert(Length % 2 == 1, "median_filter length must be odd");
+
+  /**
+   * @brief Filter a single sample
+   *
+   * @param p_sample - the next input sample
+   * @return float - the median of the last Length samples
+   */
+  float process(float p_sample)
+  {
+    const auto oldest = m_window[m_next];
+    m_window[m_next] = p_sample;
+    m_next = (m_next + 1) % Length;
+
+    // Replace the oldest sample in the sorted window with the new sample and
+    // move it into place.
+    auto position = static_cast<std::size_t>(
+      std::lower_bound(m_sorted.begin(), m_sorted.end(), oldest) -
+      m_sorted.begin());
+    m_sorted[position] = p_sample;
+    while (position > 0 && m_sorted[position - 1] > p_sample) {
+      std::swap(m_sorted[position - 1], m_sorted[position]);
+      position--;
+    }
+    while (position + 1 < Length && m_sorted[position + 1] < p_sample) {
+      std::swap(m_sorted[position + 1], m_sorted[position]);
+      position++;
+    }
+
+    return m_sorted[Length / 2];
+  }
+
+  /**
+   * @brief Filter a block of samples
+   *
+   * @param p_input - input samples
+   * @param p_output - buffer for the filtered samples. Only the first
+   * p_input.size() samples are written, it must be at least that large.
+   */
+  void process(std::span<const float> p_input, std::span<float> p_output)
+  {
+    for (std::size_t i = 0; i < p_input.size(); i++) {
+      p_output[i] = process(p_input[i]);
+    }
+  }
+
+  /**
+   * @brief Clear the filter's history
+   *
+   */
+  void reset()
+  {
+    m_window.fill(0.0f);
+    m_sorted.fill(0.0f);
+    m_next = 0;
+  }
+
+private:
+  std::array<float, Length> m_window{};
+  std::array<float, Length> m_sorted{};
+  std::size_t m_next = 0;
+};
+
+/**
+ * @brief Second order IIR filter section
+ *
+ * Implemented in transposed direct form II, which needs two state variables
+ * and has good numerical behaviour in single precision. Higher order filters
+ * can be made by chaining sections.
+ */
+class biquad
+{
+public:
+  /**
+   * @brief Filter coefficients, normalised so that a0 is 1
+   *
+   * The transfer function is:
+   *
+   *   H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+   */
+  struct coefficients
+  {
+    float b0 = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+  };
+
+  /// Quality factor of a maximally flat (Butterworth) response
+  static constexpr float butterworth_q = std::numbers::sqrt2_v<float> / 2.0f;
+
+  /**
+   * @brief Calculate low pass filter coefficients
+   *
+   * @param p_cutoff - -3dB frequency, must be below half of p_sample_rate
+   * @param p_sample_rate - rate at which samples are filtered
+   * @param p_q - quality factor
+   * @return coefficients - the filter coefficients
+   */
+  [[nodiscard]] static coefficients low_pass(hertz p_cutoff,
+                                             hertz p_sample_rate,
+                                             float p_q = butterworth_q)
+  {
+    const auto [cos_w0, alpha] = prototype(p_cutoff, p_sample_rate, p_q);
+    const auto a0 = 1.0f + alpha;
+    return coefficients{
+      .b0 = (1.0f - cos_w0) / 2.0f / a0,
+      .b1 = (1.0f - cos_w0) / a0,
+      .b2 = (1.0f - cos_w0) / 2.0f / a0,
+      .a1 = -2.0f * cos_w0 / a0,
+      .a2 = (1.0f - alpha) / a0,
+    };
+  }
+
+  /**
+   * @brief Calculate high pass filter coefficients
+   *
+   * @param p_cutoff - -3dB frequency, must be below half of p_sample_rate
+   * @param p_sample_rate - rate at which samples are filtered
+   * @param p_q - quality factor
+   * @return coefficients - the filter coefficients
+   */
+  [[nodiscard]] static coefficients high_pass(hertz p_cutoff,
+                                              hertz p_sample_rate,
+                                              float p_q = butterworth_q)
+  {
+    const auto [cos_w0, alpha] = prototype(p_cutoff, p_sample_rate, p_q);
+    const auto a0 = 1.0f + alpha;
+    return coefficients{
+      .b0 = (1.0f + cos_w0) / 2.0f / a0,
+      .b1 = -(1.0f + cos_w0) / a0,
+      .b2 = (1.0f + cos_w0) / 2.0f / a0,
+      .a1 = -2.0f * cos_w0 / a0,
+      .a2 = (1.0f - alpha) / a0,
+    };
+  }
+
+  /**
+   * @brief Construct a new biquad
+   *
+   * @param p_coefficients - the filter coefficients
+   */
+  explicit biquad(const coefficients& p_coefficients)
+    : m_coefficients(p_coefficients)
+  {
+  }
+
+  /**
+   * @brief Filter a single sample
+   *
+   * @param p_sample - the next input sample
+   * @return float - the filtered sample
+   */
+  float process(float p_sample)
+  {
+    const auto& c = m_coefficients;
+    const auto output = c.b0 * p_sample + m_state1;
+    m_state1 = c.b1 * p_sample - c.a1 * output + m_state2;
+    m_state2 = c.b2 * p_sample - c.a2 * output;
+    return output;
+  }
+
+  /**
+   * @brief Filter a block of samples
+   *
+   * @param p_input - input samples
+   * @param p_output - buffer for the filtered samples. Only the first
+   * p_input.size() samples are written, it must be at least that large.
+   */
+  void process(std::span<const float> p_input, std::span<float> p_output)
+  {
+    // Keeping the state in locals lets the compiler hold it in registers for
+    // the whole block.
+    const auto c = m_coefficients;
+    auto state1 = m_state1;
+    auto state2 = m_state2;
+    for (std::size_t i = 0; i < p_input.size(); i++) {
+      const auto input = p_input[i];
+      const auto output = c.b0 * input + state1;
+      state1 = c.b1 * input - c.a1 * output + state2;
+      state2 = c.b2 * input - c.a2 * output;
+      p_output[i] = output;
+    }
+    m_state1 = state1;
+    m_state2 = state2;
+  }
+
+  /**
+   * @brief Clear the filter's history
+   *
+   */
+  void reset()
+  {
+    m_state1 = 0.0f;
+    m_state2 = 0.0f;
+  }
+
+private:
+  struct prototype_t
+  {
+    float cos_w0;
+    float alpha;
+  };
+
+  static prototype_t prototype(hertz p_cutoff, hertz p_sample_rate, float p_q)
+  {
+    const auto w0 =
+      2.0f * std::numbers::pi_v<float> * p_cutoff / p_sample_rate;
+    return prototype_t{
+      .cos_w0 = std::cos(w0),
+      .alpha = std::sin(w0) / (2.0f * p_q),
+    };
+  }
+
+  coefficients m_coefficients;
+  float m_state1 = 0.0f;
+  float m_state2 = 0.0f;
+};
+
+/**
+ * @brief Finite impulse response filter
+ *
+ * The history is stored twice, back to back, so that the last Taps samples
+ * are always contiguous in memory. This turns each output sample into a
+ * plain dot product over two arrays.
+ *
+ * The block kernel copies the history and up to `block_chunk` input samples
+ * into a contiguous buffer on the stack, then accumulates one tap at a time
+ * across all outputs of the chunk. The inner loop has no dependency between
+ * iterations, so compilers vectorise it for the target's SIMD or DSP
+ * multiply-accumulate instructions, and each output still sums its taps in
+ * the same order as the per sample path.
+ *
+ * @tparam Taps - number of coefficients
+ */
+template<std::size_t Taps>
+class fir_filter
+{
+public:
+  static_assert(Taps > 0, "fir_filter needs at least one tap");
+
+  /// Number of samples filtered at a time by the block kernel
+  static constexpr std::size_t block_chunk = 32;
+
+  /**
+   * @brief Construct a new fir filter
+   *
+   * @param p_coefficients - the impulse response, p_coefficients[0] is applied
+   * to the newest sample
+   */
+  explicit fir_filter(const std::array<float, Taps>& p_coefficients)
+  {
+    std::reverse_copy(
+      p_coefficients.begin(), p_coefficients.end(), m_reversed.begin());
+  }
+
+  /**
+   * @brief Filter a single sample
+   *
+   * @param p_sample - the next input sample
+   * @return float - the filtered sample
+   */
+  float process(float p_sample)
+  {
+    m_history[m_next] = p_sample;
+    m_history[m_next + Taps] = p_sample;
+    // Oldest sample first, newest last, matching the reversed coefficients
+    const auto* window = &m_history[m_next + 1];
+    m_next = (m_next + 1) % Taps;
+
+    float output = 0.0f;
+    for (std::size_t i = 0; i < Taps; i++) {
+      output += m_reversed[i] * window[i];
+    }
+    return output;
+  }
+
+  /**
+   * @brief Filter a block of samples
+   *
+   * @param p_input - input samples
+   * @param p_output - buffer for the filtered samples. Only the first
+   * p_input.size() samples are written, it must be at least that large.
+   */
+  void process(std::span<const float> p_input, std::span<float> p_output)
+  {
+    while (!p_input.empty()) {
+      const auto length = std::min(p_input.size(), block_chunk);
+      process_chunk(p_input.first(length), p_output.first(length));
+      p_input = p_input.subspan(length);
+      p_output = p_output.subspan(length);
+    }
+  }
+
+  /**
+   * @brief Clear the filter's history
+   *
+   */
+  void reset()
+  {
+    m_history.fill(0.0f);
+    m_next = 0;
+  }
+
+private:
+  void process_chunk(std::span<const float> p_input, std::span<float> p_output)
+  {
+    // The Taps - 1 most recent samples, oldest first, followed by the input
+    std::array<float, Taps - 1 + block_chunk> samples{};
+    const auto* recent = &m_history[m_next + 1];
+    std::copy(recent, recent + Taps - 1, samples.begin());
+    std::copy(p_input.begin(), p_input.end(), samples.begin() + Taps - 1);
+
+    // A whole chunk is always computed, a fixed trip count lets the compiler
+    // vectorise without a scalar remainder loop. The outputs past the end of
+    // a short chunk are discarded.
+    std::array<float, block_chunk> output{};
+    for (std::size_t tap = 0; tap < Taps; tap++) {
+      const auto coefficient = m_reversed[tap];
+      for (std::size_t i = 0; i < block_chunk; i++) {
+        output[i] += coefficient * samples[tap + i];
+      }
+    }
+    std::copy_n(output.begin(), p_input.size(), p_output.begin());
+
+    // Only the last Taps samples of the chunk are needed as history
+    const auto kept = std::min(p_input.size(), Taps);
+    for (std::size_t i = p_input.size() - kept; i < p_input.size(); i++) {
+      const auto sample = samples[Taps - 1 + i];
+      m_history[m_next] = sample;
+      m_history[m_next + Taps] = sample;
+      m_next = (m_next + 1) % Taps;
+    }
+  }
+
+  std::array<float, Taps> m_reversed{};
+  std::array<float, Taps * 2> m_history{};
+  std::size_t m_next = 0;
+};
+}  // namespace hal
@@ -56,6 +56,40 @@ public:
   struct transaction_t
   {};
 
+  /**
+   * @brief Description of a single transaction within a transaction list
+   *
+   * The fields follow the same rules as the parameters of `transaction()`.
+   */
+  struct transaction_descriptor
+  {
+    /**
+     * @brief 7-bit address of the device to communicate with
+     *
+     */
+    hal::byte address;
+    /**
+     * @brief Data to be written to the addressed device
+     *
+     */
+    std::span<const hal::byte> data_out{};
+    /**
+     * @brief Buffer to store read data from the addressed device
+     *
+     */
+    std::span<hal::byte> data_in{};
+    /**
+     * @brief Chain the next transaction to this one with a repeated start
+     *
+     * If true, drivers that support it will omit the STOP condition at the end
+     * of this transaction and begin the next transaction in the list with a
+     * repeated START, keeping control of the bus between them. This is a hint,
+     * drivers that do not support chaining will issue a STOP and a START
+     * instead. Ignored for the last transaction in the list.
+     */
+    bool repeated_start = false;
+  };
+
   /**
    * @brief Configure i2c to match the settings supplied
    *
@@ -126,6 +160,130 @@ public:
     return driver_transaction(p_address, p_data_out, p_data_in, p_timeout);
   }
 
+  /**
+   * @brief perform a list of i2c transactions back to back
+   *
+   * Each transaction is performed in order and with the same semantics as
+   * `transaction()`. Every transaction in the list shares the same timeout,
+   * meaning that p_timeout bounds the whole list and not each individual
+   * transaction.
+   *
+   * Drivers may override this to execute the whole list from an interrupt or
+   * DMA state machine without returning control to the CPU between each
+   * transaction. The default implementation calls `transaction()` for each
+   * descriptor.
+   *
+   * If a transaction fails, the transactions after it are not performed and
+   * the error is returned.
+   *
+   * @param p_transactions - list of transactions to perform in order
+   * @param p_timeout callable which notifies the i2c driver that it has run out
+   * of time to perform the transactions and must stop and return control to the
+   * caller.
+   * @return result<transaction_t> - success or failure
+   * @throws std::errc::io_error - see `transaction()`
+   * @throws std::errc::no_such_device_or_address - see `transaction()`
+   * @throws std::errc::timed_out if the transactions exceeded their time
+   * allotment indicated by p_timeout.
+   */
+  [[nodiscard]] result<transaction_t> transactions(
+    std::span<const transaction_descriptor> p_transactions,
+    hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    return driver_transactions(p_transactions, p_timeout);
+  }
+
+  /**
+   * @brief Start an i2c transaction without waiting for it to complete
+   *
+   * The transaction has the same semantics as `transaction()` but this
+   * function returns control to the caller as soon as the transaction has been
+   * started. Call `transaction_state()` to drive and check the progress of the
+   * transaction. The spans passed to this function must remain valid until
+   * `transaction_state()` reaches a terminal state or returns an error.
+   *
+   * Drivers that cannot perform non-blocking transactions return an error
+   * rather than blocking without a timeout. Use `transaction()` with such
+   * drivers.
+   *
+   * @param p_address - see `transaction()`
+   * @param p_data_out - see `transaction()`
+   * @param p_data_in - see `transaction()`
+   * @return status - success or failure
+   * @throws std::errc::device_or_resource_busy - if a transaction is already in
+   * progress.
+   * @throws std::errc::operation_not_supported - if the driver cannot perform
+   * non-blocking transactions.
+   */
+  [[nodiscard]] status start_transaction(hal::byte p_address,
+                                         std::span<const hal::byte> p_data_out,
+                                         std::span<hal::byte> p_data_in)
+  {
+    return driver_start_transaction(p_address, p_data_out, p_data_in);
+  }
+
+  /**
+   * @brief Get the state of the transaction started by `start_transaction()`
+   *
+   * This function will not block. Drivers that require software to move the
+   * transaction along (for example, to load the next byte into a data
+   * register) will do so within this call.
+   *
+   * @return result<work_state> - `work_state::in_progress` while the
+   * transaction is still on going and `work_state::finished` once the
+   * transaction has completed. Returns `work_state::finished` if no transaction
+   * was started.
+   * @throws std::errc::io_error - see `transaction()`
+   * @throws std::errc::no_such_device_or_address - see `transaction()`
+   */
+  [[nodiscard]] result<work_state> transaction_state()
+  {
+    return driver_transaction_state();
+  }
+
+  /**
+   * @brief Create a resumable worker that performs an i2c transaction
+   *
+   * The first call to the worker starts the transaction, each call after that
+   * checks on its progress. The worker satisfies `hal::worker` and can be
+   * driven by hand within a super loop or via `hal::try_until()`. Once the
+   * worker reaches a terminal state it will return that state without touching
+   * the i2c bus. If the transaction fails, the error is returned once and
+   * every call afterwards returns `work_state::failed`.
+   *
+   * The worker holds a reference to this i2c object and to the spans passed to
+   * it, both must outlive the worker.
+   *
+   * @param p_address - see `transaction()`
+   * @param p_data_out - see `transaction()`
+   * @param p_data_in - see `transaction()`
+   * @return auto - callable object with the signature `hal::work_function`
+   */
+  [[nodiscard]] auto transaction_worker(hal::byte p_address,
+                                        std::span<const hal::byte> p_data_out,
+                                        std::span<hal::byte> p_data_in)
+  {
+    return [this,
+            p_address,
+            p_data_out,
+            p_data_in,
+            started = false,
+            state = work_state::in_progress]() mutable -> result<work_state> {
+      if (hal::terminated(state)) {
+        return state;
+      }
+      // Assume failure until the driver reports otherwise, so that an error
+      // returned by HAL_CHECK leaves the worker in the failed state.
+      state = work_state::failed;
+      if (!started) {
+        started = true;
+        HAL_CHECK(start_transaction(p_address, p_data_out, p_data_in));
+      }
+      state = HAL_CHECK(transaction_state());
+      return state;
+    };
+  }
+
   virtual ~i2c() = default;
 
 private:
@@ -135,5 +293,30 @@ private:
     std::span<const hal::byte> p_data_out,
     std::span<hal::byte> p_data_in,
     hal::function_ref<hal::timeout_function> p_timeout) = 0;
+
+  virtual result<transaction_t> driver_transactions(
+    std::span<const transaction_descriptor> p_transactions,
+    hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    for (const auto& transaction : p_transactions) {
+      HAL_CHECK(driver_transaction(transaction.address,
+                                   transaction.data_out,
+                                   transaction.data_in,
+                                   p_timeout));
+    }
+    return transaction_t{};
+  }
+
+  virtual status driver_start_transaction(hal::byte,
+                                          std::span<const hal::byte>,
+                                          std::span<hal::byte>)
+  {
+    return hal::new_error(std::errc::operation_not_supported);
+  }
+
+  virtual result<work_state> driver_transaction_state()
+  {
+    return work_state::finished;
+  }
 };
 }  // namespace hal
@@ -0,0 +1,613 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file i2c_recording.hpp
+ * @brief Record i2c transactions on real hardware and replay them without it.
+ *
+ * Each transaction is stored in the log as a record with the following
+ * layout, where "varint" is an unsigned LEB128 encoded integer:
+ *
+ *   | field     | size        | description                                |
+ *   | --------- | ----------- | ------------------------------------------ |
+ *   | address   | 1 byte      | address passed to the transaction          |
+ *   | status    | 1 byte      | 0 on success, otherwise see below          |
+ *   | out size  | varint      | number of bytes written                    |
+ *   | in size   | varint      | number of bytes read                       |
+ *   | duration  | varint      | steady clock ticks taken by the transaction|
+ *   | out bytes | out size    | bytes written                              |
+ *   | in bytes  | in size     | bytes read                                 |
+ *
+ * The status is the value of the `std::errc` the transaction failed with or
+ * `i2c_record_unknown_error` if the error was not a `std::errc`.
+ *
+ * A transaction list that failed is stored as a single list record, as the
+ * bus only reports that the list failed and not which transaction did:
+ *
+ *   | field     | size        | description                                |
+ *   | --------- | ----------- | ------------------------------------------ |
+ *   | unused    | 1 byte      | 0                                          |
+ *   | marker    | 1 byte      | `i2c_record_list`                          |
+ *   | count     | varint      | number of transactions in the list         |
+ *   | status    | 1 byte      | status of the whole list                   |
+ *   | duration  | varint      | steady clock ticks taken by the list       |
+ *
+ * followed by `count` entries of:
+ *
+ *   | field     | size        | description                                |
+ *   | --------- | ----------- | ------------------------------------------ |
+ *   | address   | 1 byte      | address of the transaction                 |
+ *   | out size  | varint      | number of bytes to write                   |
+ *   | in size   | varint      | number of bytes to read                    |
+ *   | out bytes | out size    | bytes to write                             |
+ *
+ * No read bytes are stored, as whether they reached the bus is unknown.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <system_error>
+
+#include "error.hpp"
+#include "functional.hpp"
+#include "i2c.hpp"
+#include "steady_clock.hpp"
+#include "timeout.hpp"
+#include "units.hpp"
+
+namespace hal {
+/// Record status value used for errors that are not a `std::errc`
+constexpr hal::byte i2c_record_unknown_error = 0xFF;
+
+/// Record status value marking a failed transaction list
+constexpr hal::byte i2c_record_list = 0xFE;
+
+/**
+ * @brief i2c decorator that records every transaction into a log
+ *
+ * Transactions are forwarded to the wrapped i2c unchanged, including
+ * transaction lists and non-blocking transactions, so the wrapped bus sees
+ * the same traffic it would without the recorder. Their address, data, result
+ * and duration are appended to a caller supplied log buffer. If the log
+ * buffer fills up, recording stops, `overflow()` returns true and
+ * transactions continue to be forwarded.
+ *
+ * A successful transaction list is recorded as one record per transaction,
+ * with the list's duration stored in its last record and a duration of 0 in
+ * the others. As the wrapped bus reports a single result for the whole list,
+ * a failed list is recorded as one list record with the list's result, so
+ * that transactions which never reached the bus are not recorded as
+ * successful. A non-blocking transaction is
+ * recorded once `transaction_state()` reports that it has finished or
+ * failed, with the duration measured from `start_transaction()`.
+ */
+class i2c_recorder : public hal::i2c
+{
+public:
+  /**
+   * @brief Construct a new i2c recorder
+   *
+   * @param p_i2c - i2c bus to forward transactions to
+   * @param p_clock - steady clock used to measure each transaction
+   * @param p_log - buffer to store the recording in
+   */
+  i2c_recorder(hal::i2c& p_i2c,
+               hal::steady_clock& p_clock,
+               std::span<hal::byte> p_log)
+    : m_i2c(&p_i2c)
+    , m_clock(&p_clock)
+    , m_log(p_log)
+  {
+  }
+
+  /**
+   * @brief Get the portion of the log buffer holding recorded transactions
+   *
+   * @return std::span<const hal::byte> - the recording, suitable to pass to
+   * `hal::i2c_replay`.
+   */
+  [[nodiscard]] std::span<const hal::byte> recording() const
+  {
+    return m_log.first(m_length);
+  }
+
+  /**
+   * @brief Determine if a transaction was dropped due to a full log
+   *
+   * @return true - at least one transaction was not recorded
+   */
+  [[nodiscard]] bool overflow() const
+  {
+    return m_overflow;
+  }
+
+  /**
+   * @brief Discard the recording and start again from an empty log
+   *
+   */
+  void clear()
+  {
+    m_length = 0;
+    m_overflow = false;
+  }
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    return m_i2c->configure(p_settings);
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    hal::byte status_code = 0;
+    const auto start = m_clock->uptime().ticks;
+    auto transaction_result = capture_status(status_code, [&]() {
+      return m_i2c->transaction(p_address, p_data_out, p_data_in, p_timeout);
+    });
+    const auto duration = m_clock->uptime().ticks - start;
+
+    append(p_address, status_code, duration, p_data_out, p_data_in);
+    return transaction_result;
+  }
+
+  result<transaction_t> driver_transactions(
+    std::span<const transaction_descriptor> p_transactions,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    hal::byte status_code = 0;
+    const auto start = m_clock->uptime().ticks;
+    auto transactions_result = capture_status(status_code, [&]() {
+      return m_i2c->transactions(p_transactions, p_timeout);
+    });
+    const auto duration = m_clock->uptime().ticks - start;
+
+    if (!transactions_result) {
+      append_list(p_transactions, status_code, duration);
+      return transactions_result;
+    }
+
+    for (std::size_t i = 0; i < p_transactions.size(); i++) {
+      const auto& transaction = p_transactions[i];
+      const bool last = i + 1 == p_transactions.size();
+      append(transaction.address,
+             0,
+             last ? duration : 0,
+             transaction.data_out,
+             transaction.data_in);
+    }
+    return transactions_result;
+  }
+
+  status driver_start_transaction(hal::byte p_address,
+                                  std::span<const hal::byte> p_data_out,
+                                  std::span<hal::byte> p_data_in) override
+  {
+    const auto start = m_clock->uptime().ticks;
+    HAL_CHECK(m_i2c->start_transaction(p_address, p_data_out, p_data_in));
+    m_pending = pending_transaction{
+      .address = p_address,
+      .data_out = p_data_out,
+      .data_in = p_data_in,
+      .start = start,
+    };
+    return success();
+  }
+
+  result<work_state> driver_transaction_state() override
+  {
+    hal::byte status_code = 0;
+    auto state_result = capture_status(
+      status_code, [this]() { return m_i2c->transaction_state(); });
+
+    if (m_pending && (!state_result || hal::terminated(state_result.value()))) {
+      const auto duration = m_clock->uptime().ticks - m_pending->start;
+      append(m_pending->address,
+             status_code,
+             duration,
+             m_pending->data_out,
+             m_pending->data_in);
+      m_pending.reset();
+    }
+    return state_result;
+  }
+
+  /// Call p_call and store the record status of its result in p_status
+  template<class Call>
+  static auto capture_status(hal::byte& p_status, Call p_call)
+    -> decltype(p_call())
+  {
+    using call_result = decltype(p_call());
+    call_result outcome = hal::attempt(
+      [&p_call]() -> call_result { return p_call(); },
+      [&p_status](std::errc p_errc) -> call_result {
+        p_status = static_cast<hal::byte>(p_errc);
+        return hal::new_error(p_errc);
+      });
+    if (!outcome && p_status == 0) {
+      p_status = i2c_record_unknown_error;
+    }
+    return outcome;
+  }
+
+  void append(hal::byte p_address,
+              hal::byte p_status,
+              std::uint64_t p_duration,
+              std::span<const hal::byte> p_data_out,
+              std::span<const hal::byte> p_data_in)
+  {
+    if (m_overflow) {
+      return;
+    }
+
+    auto position = m_length;
+    const bool fits = put(position, p_address) && put(position, p_status) &&
+                      put_varint(position, p_data_out.size()) &&
+                      put_varint(position, p_data_in.size()) &&
+                      put_varint(position, p_duration) &&
+                      put_bytes(position, p_data_out) &&
+                      put_bytes(position, p_data_in);
+
+    if (!fits) {
+      m_overflow = true;
+      return;
+    }
+    m_length = position;
+  }
+
+  void append_list(std::span<const transaction_descriptor> p_transactions,
+                   hal::byte p_status,
+                   std::uint64_t p_duration)
+  {
+    if (m_overflow) {
+      return;
+    }
+
+    auto position = m_length;
+    bool fits = put(position, 0) && put(position, i2c_record_list) &&
+                put_varint(position, p_transactions.size()) &&
+                put(position, p_status) && put_varint(position, p_duration);
+    for (const auto& transaction : p_transactions) {
+      fits = fits && put(position, transaction.address) &&
+             put_varint(position, transaction.data_out.size()) &&
+             put_varint(position, transaction.data_in.size()) &&
+             put_bytes(position, transaction.data_out);
+    }
+
+    if (!fits) {
+      m_overflow = true;
+      return;
+    }
+    m_length = position;
+  }
+
+  bool put(std::size_t& p_position, hal::byte p_byte)
+  {
+    if (p_position >= m_log.size()) {
+      return false;
+    }
+    m_log[p_position++] = p_byte;
+    return true;
+  }
+
+  bool put_varint(std::size_t& p_position, std::uint64_t p_value)
+  {
+    do {
+      auto encoded = static_cast<hal::byte>(p_value & 0x7F);
+      p_value >>= 7;
+      if (p_value != 0) {
+        encoded |= 0x80;
+      }
+      if (!put(p_position, encoded)) {
+        return false;
+      }
+    } while (p_value != 0);
+    return true;
+  }
+
+  bool put_bytes(std::size_t& p_position, std::span<const hal::byte> p_bytes)
+  {
+    if (m_log.size() - p_position < p_bytes.size()) {
+      return false;
+    }
+    const auto destination = m_log.subspan(p_position);
+    std::copy(p_bytes.begin(), p_bytes.end(), destination.begin());
+    p_position += p_bytes.size();
+    return true;
+  }
+
+  /// Non-blocking transaction waiting to be recorded
+  struct pending_transaction
+  {
+    hal::byte address;
+    std::span<const hal::byte> data_out;
+    std::span<hal::byte> data_in;
+    std::uint64_t start;
+  };
+
+  hal::i2c* m_i2c;
+  hal::steady_clock* m_clock;
+  std::span<hal::byte> m_log;
+  std::size_t m_length = 0;
+  std::optional<pending_transaction> m_pending{};
+  bool m_overflow = false;
+};
+
+/**
+ * @brief i2c implementation that replays a recording made by
+ * `hal::i2c_recorder`
+ *
+ * Each transaction is matched against the next record in the log. When the
+ * address and the written bytes match the record, the recorded read bytes are
+ * copied into p_data_in and the recorded result is returned. No hardware is
+ * touched, which makes this suitable for running and benchmarking device
+ * drivers off target. Call `rewind()` to replay the recording again.
+ *
+ * A transaction fails with `std::errc::protocol_error` if the recording has
+ * been exhausted or is malformed or if the transaction does not match the next
+ * record.
+ *
+ * Successful transaction lists are replayed one record per transaction. A
+ * failed list is replayed from its list record: the list must match it as a
+ * whole, the recorded error is returned and no read buffer is written.
+ * Non-blocking
+ * transactions are replayed by `start_transaction()` and their recorded
+ * result is reported by the next call to `transaction_state()`.
+ */
+class i2c_replay : public hal::i2c
+{
+public:
+  /**
+   * @brief Construct a new i2c replay
+   *
+   * @param p_recording - recording made by `hal::i2c_recorder`
+   */
+  explicit i2c_replay(std::span<const hal::byte> p_recording)
+    : m_recording(p_recording)
+  {
+  }
+
+  /**
+   * @brief Restart the replay from the first record
+   *
+   */
+  void rewind()
+  {
+    m_position = 0;
+    m_replayed = 0;
+  }
+
+  /**
+   * @brief Get the number of transactions replayed since the last rewind
+   *
+   * @return std::size_t - number of transactions replayed
+   */
+  [[nodiscard]] std::size_t replayed() const
+  {
+    return m_replayed;
+  }
+
+  /**
+   * @brief Determine if every record has been replayed
+   *
+   * @return true - if there are no records left
+   */
+  [[nodiscard]] bool finished() const
+  {
+    return m_position >= m_recording.size();
+  }
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function>) override
+  {
+    const auto status_code =
+      HAL_CHECK(replay_record(p_address, p_data_out, p_data_in));
+    HAL_CHECK(recorded_status(status_code));
+    return transaction_t{};
+  }
+
+  result<transaction_t> driver_transactions(
+    std::span<const transaction_descriptor> p_transactions,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    if (next_is_list()) {
+      const auto status_code = HAL_CHECK(replay_list(p_transactions));
+      HAL_CHECK(recorded_status(status_code));
+      return transaction_t{};
+    }
+
+    for (const auto& transaction : p_transactions) {
+      HAL_CHECK(driver_transaction(transaction.address,
+                                   transaction.data_out,
+                                   transaction.data_in,
+                                   p_timeout));
+    }
+    return transaction_t{};
+  }
+
+  status driver_start_transaction(hal::byte p_address,
+                                  std::span<const hal::byte> p_data_out,
+                                  std::span<hal::byte> p_data_in) override
+  {
+    if (m_pending_status) {
+      return hal::new_error(std::errc::device_or_resource_busy);
+    }
+    m_pending_status =
+      HAL_CHECK(replay_record(p_address, p_data_out, p_data_in));
+    return success();
+  }
+
+  result<work_state> driver_transaction_state() override
+  {
+    if (!m_pending_status) {
+      return work_state::finished;
+    }
+    const auto status_code = *m_pending_status;
+    m_pending_status.reset();
+    HAL_CHECK(recorded_status(status_code));
+    return work_state::finished;
+  }
+
+  /**
+   * @brief Match a transaction against the next record and copy its data
+   *
+   * @return result<hal::byte> - the recorded status of the transaction
+   */
+  result<hal::byte> replay_record(hal::byte p_address,
+                                  std::span<const hal::byte> p_data_out,
+                                  std::span<hal::byte> p_data_in)
+  {
+    auto position = m_position;
+    hal::byte address = 0;
+    hal::byte status_code = 0;
+    std::uint64_t out_size = 0;
+    std::uint64_t in_size = 0;
+    std::uint64_t duration = 0;
+
+    const bool valid =
+      get(position, address) && get(position, status_code) &&
+      get_varint(position, out_size) && get_varint(position, in_size) &&
+      get_varint(position, duration) &&
+      m_recording.size() - position >= out_size + in_size;
+
+    if (!valid || status_code == i2c_record_list || address != p_address ||
+        out_size != p_data_out.size() || in_size != p_data_in.size()) {
+      return hal::new_error(std::errc::protocol_error);
+    }
+
+    const auto recorded_out = m_recording.subspan(position, out_size);
+    if (!std::equal(
+          p_data_out.begin(), p_data_out.end(), recorded_out.begin())) {
+      return hal::new_error(std::errc::protocol_error);
+    }
+
+    position += out_size;
+    const auto recorded_in = m_recording.subspan(position, in_size);
+    std::copy(recorded_in.begin(), recorded_in.end(), p_data_in.begin());
+    position += in_size;
+
+    m_position = position;
+    m_replayed++;
+    return status_code;
+  }
+
+  bool next_is_list() const
+  {
+    auto position = m_position + 1;
+    hal::byte marker = 0;
+    return get(position, marker) && marker == i2c_record_list;
+  }
+
+  /**
+   * @brief Match a transaction list against the next list record
+   *
+   * @return result<hal::byte> - the recorded status of the list
+   */
+  result<hal::byte> replay_list(
+    std::span<const transaction_descriptor> p_transactions)
+  {
+    auto position = m_position + 2;
+    std::uint64_t count = 0;
+    hal::byte status_code = 0;
+    std::uint64_t duration = 0;
+    if (!get_varint(position, count) || count != p_transactions.size() ||
+        !get(position, status_code) || !get_varint(position, duration)) {
+      return hal::new_error(std::errc::protocol_error);
+    }
+
+    for (const auto& transaction : p_transactions) {
+      hal::byte address = 0;
+      std::uint64_t out_size = 0;
+      std::uint64_t in_size = 0;
+      const bool valid = get(position, address) &&
+                         get_varint(position, out_size) &&
+                         get_varint(position, in_size) &&
+                         m_recording.size() - position >= out_size;
+      if (!valid || address != transaction.address ||
+          out_size != transaction.data_out.size() ||
+          in_size != transaction.data_in.size()) {
+        return hal::new_error(std::errc::protocol_error);
+      }
+      const auto recorded_out = m_recording.subspan(position, out_size);
+      if (!std::equal(transaction.data_out.begin(),
+                      transaction.data_out.end(),
+                      recorded_out.begin())) {
+        return hal::new_error(std::errc::protocol_error);
+      }
+      position += out_size;
+    }
+
+    m_position = position;
+    m_replayed += p_transactions.size();
+    return status_code;
+  }
+
+  static status recorded_status(hal::byte p_status)
+  {
+    if (p_status == i2c_record_unknown_error) {
+      return hal::new_error();
+    }
+    if (p_status != 0) {
+      return hal::new_error(static_cast<std::errc>(p_status));
+    }
+    return success();
+  }
+
+  bool get(std::size_t& p_position, hal::byte& p_byte) const
+  {
+    if (p_position >= m_recording.size()) {
+      return false;
+    }
+    p_byte = m_recording[p_position++];
+    return true;
+  }
+
+  bool get_varint(std::size_t& p_position, std::uint64_t& p_value) const
+  {
+    p_value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      hal::byte encoded = 0;
+      if (!get(p_position, encoded)) {
+        return false;
+      }
+      p_value |= static_cast<std::uint64_t>(encoded & 0x7F) << shift;
+      if ((encoded & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::span<const hal::byte> m_recording;
+  std::size_t m_position = 0;
+  std::size_t m_replayed = 0;
+  std::optional<hal::byte> m_pending_status{};
+};
+}  // namespace hal
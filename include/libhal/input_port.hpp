@@ -0,0 +1,160 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "error.hpp"
+#include "input_pin.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Group of digital input pins read together
+ *
+ * Use this to read a set of pins, such as a DIP switch or the data lines of a
+ * parallel bus, with one call. Bit N of the state corresponds to pin N of the
+ * port.
+ *
+ * Ports backed by a GPIO port register can read every pin with a single
+ * register load, which also samples the pins at the same instant. Use
+ * `hal::input_pin_port` to make a port from individual `hal::input_pin`s.
+ */
+class input_port
+{
+public:
+  /// Generic settings for input ports, applied to every pin of the port
+  struct settings
+  {
+    /// Pull resistor for the pins
+    pin_resistor resistor = pin_resistor::pull_up;
+  };
+
+  /// Port level reading structure
+  struct level_t
+  {
+    /// Measured state of the pins, bit N is HIGH if pin N is HIGH
+    std::uint32_t state;
+  };
+
+  /// Largest number of pins in a port
+  static constexpr std::size_t max_width = 32;
+
+  /**
+   * @brief Configure every pin of the port to match the settings supplied
+   *
+   * @param p_settings - settings to apply to the port
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument if the settings could not be achieved.
+   */
+  [[nodiscard]] status configure(const settings& p_settings)
+  {
+    return driver_configure(p_settings);
+  }
+
+  /**
+   * @brief Get the number of pins in the port
+   *
+   * @return std::size_t - number of pins, at most `max_width`
+   */
+  [[nodiscard]] std::size_t width()
+  {
+    return driver_width();
+  }
+
+  /**
+   * @brief Read the state of the pins
+   *
+   * @return result<level_t> - the state of the pins. Bits at or above the
+   * port's width are 0.
+   */
+  [[nodiscard]] result<level_t> level()
+  {
+    return driver_level();
+  }
+
+  virtual ~input_port() = default;
+
+private:
+  virtual status driver_configure(const settings& p_settings) = 0;
+  virtual std::size_t driver_width() = 0;
+  virtual result<level_t> driver_level() = 0;
+};
+
+/**
+ * @brief Input port made of individual input pins
+ *
+ * Each pin is read with its own call, so the pins are not sampled at the same
+ * instant. `configure()` configures each pin with the same settings.
+ */
+class input_pin_port : public hal::input_port
+{
+public:
+  /**
+   * @brief Create an input port from individual pins
+   *
+   * @param p_pins - the pins of the port, pin N becomes bit N. The span must
+   * outlive this object.
+   * @return result<input_pin_port> - the port
+   * @throws std::errc::invalid_argument - if there are more than `max_width`
+   * pins.
+   */
+  [[nodiscard]] static result<input_pin_port> create(
+    std::span<hal::input_pin* const> p_pins)
+  {
+    if (p_pins.size() > max_width) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    return input_pin_port(p_pins);
+  }
+
+private:
+  explicit input_pin_port(std::span<hal::input_pin* const> p_pins)
+    : m_pins(p_pins)
+  {
+  }
+
+  status driver_configure(const settings& p_settings) override
+  {
+    const hal::input_pin::settings pin_settings{
+      .resistor = p_settings.resistor,
+    };
+    for (auto* pin : m_pins) {
+      HAL_CHECK(pin->configure(pin_settings));
+    }
+    return success();
+  }
+
+  std::size_t driver_width() override
+  {
+    return m_pins.size();
+  }
+
+  result<level_t> driver_level() override
+  {
+    std::uint32_t state = 0;
+    for (std::size_t i = 0; i < m_pins.size(); i++) {
+      if (HAL_CHECK(m_pins[i]->level()).state) {
+        state |= std::uint32_t{ 1 } << i;
+      }
+    }
+    return level_t{ .state = state };
+  }
+
+  std::span<hal::input_pin* const> m_pins;
+};
+}  // namespace hal
@@ -0,0 +1,256 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "error.hpp"
+#include "output_pin.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Group of digital output pins driven together
+ *
+ * Use this to drive a set of pins, such as the data lines of a parallel
+ * display or bus, with one call. Bit N of each mask corresponds to pin N of
+ * the port. Bits at or above the port's width are ignored.
+ *
+ * Ports backed by a GPIO port register can set every pin with a single
+ * register store. Use `hal::output_pin_port` to make a port from individual
+ * `hal::output_pin`s.
+ */
+class output_port
+{
+public:
+  /// Generic settings for output ports, applied to every pin of the port
+  struct settings
+  {
+    /// Pull resistor for the pins. This generally only helpful when open
+    /// drain is enabled.
+    pin_resistor resistor = pin_resistor::none;
+
+    /// Drive the pins LOW only and let them float for HIGH, if true
+    bool open_drain = false;
+  };
+
+  /**
+   * @brief Feedback from setting the port state
+   *
+   * This structure is currently empty as no feedback has been determined for
+   * now. This structure may be expanded in the future.
+   */
+  struct set_level_t
+  {};
+
+  /// Port level reading structure
+  struct level_t
+  {
+    /// Current state of the pins, bit N is HIGH if pin N is HIGH
+    std::uint32_t state;
+  };
+
+  /// Largest number of pins in a port
+  static constexpr std::size_t max_width = 32;
+
+  /**
+   * @brief Configure every pin of the port to match the settings supplied
+   *
+   * @param p_settings - settings to apply to the port
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument if the settings could not be achieved.
+   */
+  [[nodiscard]] status configure(const settings& p_settings)
+  {
+    return driver_configure(p_settings);
+  }
+
+  /**
+   * @brief Get the number of pins in the port
+   *
+   * @return std::size_t - number of pins, at most `max_width`
+   */
+  [[nodiscard]] std::size_t width()
+  {
+    return driver_width();
+  }
+
+  /**
+   * @brief Set the state of every pin in the port
+   *
+   * @param p_levels - bit N sets pin N HIGH if 1 and LOW if 0
+   * @return result<set_level_t> - success or failure
+   */
+  [[nodiscard]] result<set_level_t> level(std::uint32_t p_levels)
+  {
+    return driver_level(p_levels, ~std::uint32_t{ 0 });
+  }
+
+  /**
+   * @brief Set the state of some pins in the port
+   *
+   * @param p_levels - bit N sets pin N HIGH if 1 and LOW if 0
+   * @param p_mask - only pins whose bit is 1 are changed
+   * @return result<set_level_t> - success or failure
+   */
+  [[nodiscard]] result<set_level_t> level(std::uint32_t p_levels,
+                                          std::uint32_t p_mask)
+  {
+    return driver_level(p_levels, p_mask);
+  }
+
+  /**
+   * @brief Set pins HIGH
+   *
+   * @param p_mask - pins whose bit is 1 are set HIGH, the rest are unchanged
+   * @return result<set_level_t> - success or failure
+   */
+  [[nodiscard]] result<set_level_t> set(std::uint32_t p_mask)
+  {
+    return driver_level(p_mask, p_mask);
+  }
+
+  /**
+   * @brief Set pins LOW
+   *
+   * @param p_mask - pins whose bit is 1 are set LOW, the rest are unchanged
+   * @return result<set_level_t> - success or failure
+   */
+  [[nodiscard]] result<set_level_t> clear(std::uint32_t p_mask)
+  {
+    return driver_level(0, p_mask);
+  }
+
+  /**
+   * @brief Invert the state of pins
+   *
+   * @param p_mask - pins whose bit is 1 are inverted, the rest are unchanged
+   * @return result<set_level_t> - success or failure
+   */
+  [[nodiscard]] result<set_level_t> toggle(std::uint32_t p_mask)
+  {
+    return driver_toggle(p_mask);
+  }
+
+  /**
+   * @brief Read the current state of the pins
+   *
+   * As with `hal::output_pin::level()`, implementations must read the state
+   * from hardware. Bits at or above the port's width are 0.
+   *
+   * @return result<level_t> - the current state of the pins
+   */
+  [[nodiscard]] result<level_t> level()
+  {
+    return driver_level();
+  }
+
+  virtual ~output_port() = default;
+
+private:
+  virtual status driver_configure(const settings& p_settings) = 0;
+  virtual std::size_t driver_width() = 0;
+  virtual result<set_level_t> driver_level(std::uint32_t p_levels,
+                                           std::uint32_t p_mask) = 0;
+  virtual result<level_t> driver_level() = 0;
+
+  /// Implementations with a toggle register should override this
+  virtual result<set_level_t> driver_toggle(std::uint32_t p_mask)
+  {
+    const auto current = HAL_CHECK(driver_level()).state;
+    return driver_level(~current, p_mask);
+  }
+};
+
+/**
+ * @brief Output port made of individual output pins
+ *
+ * Each pin is set with its own call, so the pins do not change at the same
+ * instant. Only pins whose bit is in the mask are written. If a pin fails,
+ * the pins before it have already been set. `configure()` configures each pin
+ * with the same settings.
+ */
+class output_pin_port : public hal::output_port
+{
+public:
+  /**
+   * @brief Create an output port from individual pins
+   *
+   * @param p_pins - the pins of the port, pin N becomes bit N. The span must
+   * outlive this object.
+   * @return result<output_pin_port> - the port
+   * @throws std::errc::invalid_argument - if there are more than `max_width`
+   * pins.
+   */
+  [[nodiscard]] static result<output_pin_port> create(
+    std::span<hal::output_pin* const> p_pins)
+  {
+    if (p_pins.size() > max_width) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    return output_pin_port(p_pins);
+  }
+
+private:
+  explicit output_pin_port(std::span<hal::output_pin* const> p_pins)
+    : m_pins(p_pins)
+  {
+  }
+
+  status driver_configure(const settings& p_settings) override
+  {
+    const hal::output_pin::settings pin_settings{
+      .resistor = p_settings.resistor,
+      .open_drain = p_settings.open_drain,
+    };
+    for (auto* pin : m_pins) {
+      HAL_CHECK(pin->configure(pin_settings));
+    }
+    return success();
+  }
+
+  std::size_t driver_width() override
+  {
+    return m_pins.size();
+  }
+
+  result<set_level_t> driver_level(std::uint32_t p_levels,
+                                   std::uint32_t p_mask) override
+  {
+    for (std::size_t i = 0; i < m_pins.size(); i++) {
+      const auto bit = std::uint32_t{ 1 } << i;
+      if (p_mask & bit) {
+        HAL_CHECK(m_pins[i]->level((p_levels & bit) != 0));
+      }
+    }
+    return set_level_t{};
+  }
+
+  result<level_t> driver_level() override
+  {
+    std::uint32_t state = 0;
+    for (std::size_t i = 0; i < m_pins.size(); i++) {
+      if (HAL_CHECK(m_pins[i]->level()).state) {
+        state |= std::uint32_t{ 1 } << i;
+      }
+    }
+    return level_t{ .state = state };
+  }
+
+  std::span<hal::output_pin* const> m_pins;
+};
+}  // namespace hal
@@ -18,6 +18,7 @@
 #include <cstdint>
 
 #include "error.hpp"
+#include "q16.hpp"
 #include "units.hpp"
 
 namespace hal {
@@ -120,10 +121,37 @@ public:
     return driver_duty_cycle(clamped_duty_cycle);
   }
 
+  /**
+   * @brief Set the pwm waveform duty cycle without float arithmetic
+   *
+   * A q16 is always between 0 and 1, so no clamping is performed. Drivers
+   * that override this can convert the duty cycle to a compare value with
+   * `q16::scale()`. Otherwise, the duty cycle is converted to float and
+   * passed to the float implementation.
+   *
+   * @param p_duty_cycle - proportion of the period the waveform is HIGH
+   * @return result<duty_cycle_t> - success or failure
+   */
+  [[nodiscard]] result<duty_cycle_t> duty_cycle(q16 p_duty_cycle)
+  {
+    return driver_duty_cycle_fraction(p_duty_cycle);
+  }
+
   virtual ~pwm() = default;
 
 private:
   virtual result<frequency_t> driver_frequency(hertz p_frequency) = 0;
   virtual result<duty_cycle_t> driver_duty_cycle(float p_duty_cycle) = 0;
+
+  /**
+   * @brief Implementation of the fixed point `duty_cycle()`
+   *
+   * @param p_duty_cycle - proportion of the period the waveform is HIGH
+   * @return result<duty_cycle_t> - success or failure
+   */
+  virtual result<duty_cycle_t> driver_duty_cycle_fraction(q16 p_duty_cycle)
+  {
+    return driver_duty_cycle(p_duty_cycle.to_float());
+  }
 };
 }  // namespace hal
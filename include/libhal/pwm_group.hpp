@@ -0,0 +1,159 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <span>
+
+#include "error.hpp"
+#include "pwm.hpp"
+#include "q16.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Group of pwm channels updated together
+ *
+ * Use this interface for pwm generators whose channels share a counter, such
+ * as the timer driving the three half bridges of a motor inverter. Drivers
+ * stage the new duty cycles in shadow registers and load them together at the
+ * next period boundary, so no period is generated with a mix of old and new
+ * duty cycles.
+ *
+ * Duty cycles are given as `hal::q16` fractions, which need no clamping and
+ * can be converted to compare values without float arithmetic.
+ *
+ * Use `hal::sequential_pwm_group` to group individual `hal::pwm` channels
+ * when the hardware cannot update them together.
+ */
+class pwm_group
+{
+public:
+  /**
+   * @brief Feedback from updating the group.
+   *
+   * This structure is currently empty as no feedback has been determined for
+   * now. This structure may be expanded in the future.
+   */
+  struct update_t
+  {};
+
+  /**
+   * @brief Get the number of channels in the group
+   *
+   * @return std::size_t - number of channels
+   */
+  [[nodiscard]] std::size_t channels()
+  {
+    return driver_channels();
+  }
+
+  /**
+   * @brief Set the duty cycle of the channels together
+   *
+   * @param p_duty_cycles - duty cycle per channel, in channel order. Channels
+   * past the end of the span keep their duty cycle.
+   * @return result<update_t> - success or failure
+   * @throws std::errc::invalid_argument - if there are more duty cycles than
+   * channels.
+   */
+  [[nodiscard]] result<update_t> update(std::span<const q16> p_duty_cycles)
+  {
+    return driver_update(p_duty_cycles, std::nullopt);
+  }
+
+  /**
+   * @brief Set the frequency and the duty cycle of the channels together
+   *
+   * The frequency is clamped in the same way as `hal::pwm::frequency()`.
+   *
+   * @param p_duty_cycles - duty cycle per channel, in channel order. Channels
+   * past the end of the span keep their duty cycle.
+   * @param p_frequency - frequency for every channel in the group
+   * @return result<update_t> - success or failure
+   * @throws std::errc::invalid_argument - if there are more duty cycles than
+   * channels.
+   * @throws std::errc::argument_out_of_domain - if the frequency is beyond
+   * what the pwm generator is capable of achieving.
+   */
+  [[nodiscard]] result<update_t> update(std::span<const q16> p_duty_cycles,
+                                        hertz p_frequency)
+  {
+    auto clamped_frequency = std::clamp(p_frequency, 1.0_Hz, 1.0_GHz);
+    return driver_update(p_duty_cycles, clamped_frequency);
+  }
+
+  virtual ~pwm_group() = default;
+
+private:
+  virtual std::size_t driver_channels() = 0;
+  virtual result<update_t> driver_update(
+    std::span<const q16> p_duty_cycles,
+    std::optional<hertz> p_frequency) = 0;
+};
+
+/**
+ * @brief Group made of individual pwm channels updated one after another
+ *
+ * The frequency, if given, is applied to every channel first and then the
+ * duty cycles are applied back to back. The channels may change on different
+ * periods. If a channel fails, the channels before it have already been
+ * updated.
+ */
+class sequential_pwm_group : public hal::pwm_group
+{
+public:
+  /**
+   * @brief Construct a new sequential pwm group
+   *
+   * @param p_channels - the channels of the group, in order. The span must
+   * outlive this object.
+   */
+  explicit sequential_pwm_group(std::span<hal::pwm* const> p_channels)
+    : m_channels(p_channels)
+  {
+  }
+
+private:
+  std::size_t driver_channels() override
+  {
+    return m_channels.size();
+  }
+
+  result<update_t> driver_update(std::span<const q16> p_duty_cycles,
+                                 std::optional<hertz> p_frequency) override
+  {
+    if (p_duty_cycles.size() > m_channels.size()) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+
+    if (p_frequency) {
+      for (auto* channel : m_channels) {
+        HAL_CHECK(channel->frequency(*p_frequency));
+      }
+    }
+
+    for (std::size_t i = 0; i < p_duty_cycles.size(); i++) {
+      HAL_CHECK(m_channels[i]->duty_cycle(p_duty_cycles[i]));
+    }
+
+    return update_t{};
+  }
+
+  std::span<hal::pwm* const> m_channels;
+};
+}  // namespace hal
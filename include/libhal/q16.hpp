@@ -0,0 +1,138 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+
+namespace hal {
+/**
+ * @brief Fraction from 0 to 1 in 16 bit fixed point
+ *
+ * Used for proportions such as a dac output level or a pwm duty cycle in
+ * code that must avoid float arithmetic, such as control loops on cores
+ * without an FPU. The value is stored as an integer where `raw_one`
+ * represents 1.0, so 1.0 is exactly representable. Every way of making a q16
+ * saturates to the range 0 to 1, so a q16 never needs clamping.
+ */
+class q16
+{
+public:
+  /// Raw value representing 1.0
+  static constexpr std::uint32_t raw_one = std::uint32_t{ 1 } << 16;
+
+  /**
+   * @brief Construct a fraction of 0
+   *
+   */
+  constexpr q16() = default;
+
+  /**
+   * @brief Make a fraction from its raw value
+   *
+   * @param p_raw - value in units of 1 / `raw_one`, saturated to `raw_one`
+   * @return constexpr q16 - the fraction
+   */
+  [[nodiscard]] static constexpr q16 from_raw(std::uint32_t p_raw)
+  {
+    return q16(std::min(p_raw, raw_one));
+  }
+
+  /**
+   * @brief Make a fraction from a float
+   *
+   * @param p_value - value saturated to between 0.0f and 1.0f. NaN becomes 0.
+   * @return constexpr q16 - the nearest fraction
+   */
+  [[nodiscard]] static constexpr q16 from_float(float p_value)
+  {
+    if (!(p_value > 0.0f)) {
+      return q16();
+    }
+    if (p_value >= 1.0f) {
+      return q16(raw_one);
+    }
+    return q16(static_cast<std::uint32_t>(p_value * raw_one + 0.5f));
+  }
+
+  /**
+   * @brief Make a fraction from the ratio of two integers
+   *
+   * Useful to turn a count, such as a timer compare value, into a fraction
+   * without float arithmetic.
+   *
+   * @param p_numerator - numerator
+   * @param p_denominator - denominator
+   * @return constexpr q16 - p_numerator / p_denominator rounded down,
+   * saturated to 1. A denominator of 0 gives 1.
+   */
+  [[nodiscard]] static constexpr q16 from_ratio(std::uint32_t p_numerator,
+                                               std::uint32_t p_denominator)
+  {
+    if (p_numerator >= p_denominator) {
+      return q16(raw_one);
+    }
+    const auto scaled = std::uint64_t{ p_numerator } << 16;
+    return q16(static_cast<std::uint32_t>(scaled / p_denominator));
+  }
+
+  /**
+   * @brief Get the raw value
+   *
+   * @return constexpr std::uint32_t - value in units of 1 / `raw_one`
+   */
+  [[nodiscard]] constexpr std::uint32_t raw() const
+  {
+    return m_raw;
+  }
+
+  /**
+   * @brief Convert to float
+   *
+   * @return constexpr float - value from 0.0f to 1.0f
+   */
+  [[nodiscard]] constexpr float to_float() const
+  {
+    return static_cast<float>(m_raw) / static_cast<float>(raw_one);
+  }
+
+  /**
+   * @brief Scale an integer by this fraction
+   *
+   * Converts the fraction to a register count, such as a dac code or a timer
+   * compare value, with a single multiply and shift.
+   *
+   * @param p_full_scale - count representing 1.0
+   * @return constexpr std::uint32_t - p_full_scale times this fraction,
+   * rounded to the nearest count
+   */
+  [[nodiscard]] constexpr std::uint32_t scale(std::uint32_t p_full_scale) const
+  {
+    const auto product = std::uint64_t{ p_full_scale } * m_raw;
+    return static_cast<std::uint32_t>((product + raw_one / 2) >> 16);
+  }
+
+  constexpr auto operator<=>(const q16&) const = default;
+
+private:
+  explicit constexpr q16(std::uint32_t p_raw)
+    : m_raw(p_raw)
+  {
+  }
+
+  std::uint32_t m_raw = 0;
+};
+}  // namespace hal
@@ -0,0 +1,533 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <concepts>
+#include <cstddef>
+#include <span>
+
+#include "error.hpp"
+#include "functional.hpp"
+#include "i2c.hpp"
+#include "spi.hpp"
+#include "spi_device.hpp"
+#include "timeout.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief How the register cache treats a device register
+ *
+ */
+enum class register_access : hal::byte
+{
+  /// The device can change this register on its own, for example status and
+  /// measurement registers. Reads always go to the bus and writes are
+  /// performed immediately, after any pending writes.
+  volatile_register,
+  /// Only software changes this register, for example configuration
+  /// registers. Reads are served from the cache after the first read and
+  /// writes are held in the cache until flushed.
+  cacheable,
+  /// The register cannot be read back from the device. Reads return the last
+  /// value written or loaded via `load_defaults()` and writes are held in the
+  /// cache until flushed.
+  write_only,
+};
+
+/**
+ * @brief Compile time description of a device's registers
+ *
+ * The index of each element is the register address.
+ *
+ * @tparam Count - number of registers, starting from address 0
+ */
+template<std::size_t Count>
+using register_map = std::array<register_access, Count>;
+
+/**
+ * @brief Register bus for devices on an i2c bus
+ *
+ * Writes are sent as a single transaction with the register address as the
+ * first byte. Reads are a write-then-read transaction of the register
+ * address followed by the data.
+ */
+class i2c_register_bus
+{
+public:
+  /**
+   * @brief Construct a register bus for a device on an i2c bus
+   *
+   * @param p_i2c - i2c bus the device is on
+   * @param p_address - 7-bit address of the device
+   */
+  i2c_register_bus(hal::i2c& p_i2c, hal::byte p_address)
+    : m_i2c(&p_i2c)
+    , m_address(p_address)
+  {
+  }
+
+  /**
+   * @brief Write a frame to the device
+   *
+   * @param p_frame - first byte is the starting register address followed by
+   * the data to write to consecutive registers.
+   * @param p_timeout - timeout for the transaction
+   * @return status - success or failure
+   */
+  [[nodiscard]] status write(std::span<hal::byte> p_frame,
+                             hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(m_i2c->transaction(
+      m_address, p_frame, std::span<hal::byte>{}, p_timeout));
+    return success();
+  }
+
+  /**
+   * @brief Read consecutive registers from the device
+   *
+   * @param p_register - starting register address
+   * @param p_data - buffer to fill with register values
+   * @param p_timeout - timeout for the transaction
+   * @return status - success or failure
+   */
+  [[nodiscard]] status read(hal::byte p_register,
+                            std::span<hal::byte> p_data,
+                            hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    const std::array<hal::byte, 1> register_address{ p_register };
+    HAL_CHECK(
+      m_i2c->transaction(m_address, register_address, p_data, p_timeout));
+    return success();
+  }
+
+private:
+  hal::i2c* m_i2c;
+  hal::byte m_address;
+};
+
+/**
+ * @brief Register bus for devices on an spi bus
+ *
+ * The register address is the first byte of each transfer, OR'd with a read
+ * or write flag. Each access is a single transfer through the device, so the
+ * device's chip select is held for the whole of the access.
+ */
+class spi_register_bus
+{
+public:
+  /**
+   * @brief Flags OR'd into the register address byte
+   *
+   * The defaults match the common convention where the most significant bit
+   * of the address byte is set for reads.
+   */
+  struct settings
+  {
+    /// Mask OR'd with the register address for reads
+    hal::byte read_flag = 0x80;
+    /// Mask OR'd with the register address for writes
+    hal::byte write_flag = 0x00;
+  };
+
+  /**
+   * @brief Construct a register bus for a device on an spi bus
+   *
+   * @param p_device - the device, which owns its chip select
+   * @param p_settings - read and write flags for the address byte
+   */
+  spi_register_bus(hal::spi_device& p_device, settings p_settings)
+    : m_device(&p_device)
+    , m_settings(p_settings)
+  {
+  }
+
+  /**
+   * @brief Construct a register bus for a device on an spi bus using the
+   * default read and write flags
+   *
+   * @param p_device - the device, which owns its chip select
+   */
+  explicit spi_register_bus(hal::spi_device& p_device)
+    : spi_register_bus(p_device, settings{})
+  {
+  }
+
+  /**
+   * @brief Write a frame to the device
+   *
+   * @param p_frame - first byte is the starting register address followed by
+   * the data to write to consecutive registers. The first byte is modified to
+   * include the write flag.
+   * @return status - success or failure
+   */
+  [[nodiscard]] status write(std::span<hal::byte> p_frame,
+                             hal::function_ref<hal::timeout_function>)
+  {
+    p_frame[0] |= m_settings.write_flag;
+    HAL_CHECK(m_device->transfer(p_frame, std::span<hal::byte>{}));
+    return success();
+  }
+
+  /**
+   * @brief Read consecutive registers from the device
+   *
+   * @param p_register - starting register address
+   * @param p_data - buffer to fill with register values
+   * @return status - success or failure
+   */
+  [[nodiscard]] status read(hal::byte p_register,
+                            std::span<hal::byte> p_data,
+                            hal::function_ref<hal::timeout_function>)
+  {
+    const std::array<hal::byte, 1> register_address{
+      static_cast<hal::byte>(p_register | m_settings.read_flag)
+    };
+    const std::array<spi::transfer_segment, 2> segments{
+      spi::transfer_segment{ .data_out = register_address },
+      spi::transfer_segment{ .data_in = p_data },
+    };
+    HAL_CHECK(m_device->transfer(segments));
+    return success();
+  }
+
+private:
+  hal::spi_device* m_device;
+  settings m_settings;
+};
+
+/**
+ * @brief A bus that can read and write device registers
+ *
+ * Satisfied by `hal::i2c_register_bus` and `hal::spi_register_bus`.
+ */
+template<class T>
+concept register_bus =
+  requires(T p_bus,
+           hal::byte p_register,
+           std::span<hal::byte> p_data,
+           hal::function_ref<hal::timeout_function> p_timeout) {
+    {
+      p_bus.write(p_data, p_timeout)
+    } -> std::same_as<status>;
+    {
+      p_bus.read(p_register, p_data, p_timeout)
+    } -> std::same_as<status>;
+  };
+
+/**
+ * @brief Shadow cache for the registers of a device
+ *
+ * Device drivers often read-modify-write configuration registers and read
+ * back values they wrote themselves. This cache keeps a copy of every
+ * register that only software can change, so that those reads are served
+ * without touching the bus and writes that do not change a register are
+ * dropped.
+ *
+ * Writes to cacheable and write only registers are held in the cache and
+ * marked dirty until `flush()` is called. `flush()` coalesces runs of adjacent
+ * dirty registers into a single burst write, which requires that the device
+ * automatically increments its register address during a multi-byte write.
+ *
+ * @tparam Map - register map of the device, see `hal::register_map`
+ * @tparam Bus - register bus used to reach the device
+ */
+template<auto Map, register_bus Bus>
+class register_cache
+{
+public:
+  /// Number of registers described by the register map
+  static constexpr std::size_t register_count = Map.size();
+
+  static_assert(register_count > 0, "Register map must not be empty");
+  static_assert(register_count <= 256,
+                "Register addresses must fit within a single byte");
+
+  /**
+   * @brief Construct a register cache
+   *
+   * The cache starts empty, meaning that the first read of each cacheable
+   * register will go to the bus.
+   *
+   * @param p_bus - register bus used to reach the device
+   */
+  explicit register_cache(Bus p_bus)
+    : m_bus(p_bus)
+  {
+  }
+
+  /**
+   * @brief Load the reset values of the device's registers into the cache
+   *
+   * Use this after the device has been reset to avoid reading back registers
+   * whose values are already known. This is the only way to give write only
+   * registers a known value before they are first written. Does not touch the
+   * bus and clears all pending writes.
+   *
+   * @param p_values - value of each register starting from address 0
+   */
+  void load_defaults(std::span<const hal::byte> p_values)
+  {
+    const auto count = std::min(p_values.size(), register_count);
+    std::copy_n(p_values.begin(), count, m_shadow.begin());
+    for (std::size_t i = 0; i < count; i++) {
+      m_valid[i] = Map[i] != register_access::volatile_register;
+    }
+    m_dirty.reset();
+  }
+
+  /**
+   * @brief Forget every cached value and every pending write
+   *
+   * Use this if the device may have been reset without software's knowledge.
+   */
+  void invalidate()
+  {
+    m_valid.reset();
+    m_dirty.reset();
+  }
+
+  /**
+   * @brief Read a register
+   *
+   * @param p_register - register address
+   * @param p_timeout - timeout for any bus access
+   * @return result<hal::byte> - value of the register
+   * @throws std::errc::invalid_argument - if the register is not in the map
+   */
+  [[nodiscard]] result<hal::byte> read(
+    hal::byte p_register,
+    hal::function_ref<hal::timeout_function> p_timeout = hal::never_timeout())
+  {
+    std::array<hal::byte, 1> value{};
+    HAL_CHECK(read(p_register, value, p_timeout));
+    return value[0];
+  }
+
+  /**
+   * @brief Read consecutive registers
+   *
+   * If every register in the range can be served from the cache, the bus is
+   * not touched. Otherwise the range is read in a single burst and the cache
+   * is updated with any cacheable values read. Write only registers are never
+   * read from the device, so a range containing them is read as one burst on
+   * each side of them.
+   *
+   * @param p_first - address of the first register
+   * @param p_data - buffer to fill with register values
+   * @param p_timeout - timeout for any bus access
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument - if a register is not in the map
+   */
+  [[nodiscard]] status read(
+    hal::byte p_first,
+    std::span<hal::byte> p_data,
+    hal::function_ref<hal::timeout_function> p_timeout = hal::never_timeout())
+  {
+    HAL_CHECK(check_range(p_first, p_data.size()));
+
+    std::size_t offset = 0;
+    while (offset < p_data.size()) {
+      if (Map[p_first + offset] == register_access::write_only) {
+        p_data[offset] = m_shadow[p_first + offset];
+        offset++;
+        continue;
+      }
+
+      const auto start = offset;
+      while (offset < p_data.size() &&
+             Map[p_first + offset] != register_access::write_only) {
+        offset++;
+      }
+      HAL_CHECK(read_run(p_first + start,
+                         p_data.subspan(start, offset - start),
+                         p_timeout));
+    }
+
+    return success();
+  }
+
+  /**
+   * @brief Write a register
+   *
+   * Volatile registers are written immediately, after flushing any pending
+   * writes so the device sees every write in program order. Cacheable and
+   * write only registers are updated in the cache and written to the device
+   * on the next `flush()`. Writing the value the register is already known to
+   * hold does nothing.
+   *
+   * @param p_register - register address
+   * @param p_value - value to write
+   * @param p_timeout - timeout for any bus access
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument - if the register is not in the map
+   */
+  [[nodiscard]] status write(
+    hal::byte p_register,
+    hal::byte p_value,
+    hal::function_ref<hal::timeout_function> p_timeout = hal::never_timeout())
+  {
+    HAL_CHECK(check_range(p_register, 1));
+
+    if (Map[p_register] == register_access::volatile_register) {
+      // A volatile write, such as a start command, may depend on the pending
+      // configuration writes having reached the device first
+      HAL_CHECK(flush(p_timeout));
+      std::array<hal::byte, 2> frame{ p_register, p_value };
+      return m_bus.write(frame, p_timeout);
+    }
+
+    if (m_valid[p_register] && m_shadow[p_register] == p_value) {
+      return success();
+    }
+
+    m_shadow[p_register] = p_value;
+    m_valid[p_register] = true;
+    m_dirty[p_register] = true;
+    return success();
+  }
+
+  /**
+   * @brief Read-modify-write the bits of a register selected by a mask
+   *
+   * @param p_register - register address
+   * @param p_mask - bits of the register to change
+   * @param p_value - new value of the bits selected by p_mask
+   * @param p_timeout - timeout for any bus access
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument - if the register is not in the map
+   */
+  [[nodiscard]] status modify(
+    hal::byte p_register,
+    hal::byte p_mask,
+    hal::byte p_value,
+    hal::function_ref<hal::timeout_function> p_timeout = hal::never_timeout())
+  {
+    const auto current = HAL_CHECK(read(p_register, p_timeout));
+    const auto updated =
+      static_cast<hal::byte>((current & ~p_mask) | (p_value & p_mask));
+    return write(p_register, updated, p_timeout);
+  }
+
+  /**
+   * @brief Write every pending register to the device
+   *
+   * Adjacent dirty registers are written with a single burst write.
+   *
+   * @param p_timeout - timeout for each bus access
+   * @return status - success or failure. On failure, registers that were not
+   * written remain dirty.
+   */
+  [[nodiscard]] status flush(
+    hal::function_ref<hal::timeout_function> p_timeout = hal::never_timeout())
+  {
+    std::size_t address = 0;
+    while (address < register_count) {
+      if (!m_dirty[address]) {
+        address++;
+        continue;
+      }
+
+      const auto first = address;
+      while (address < register_count && m_dirty[address]) {
+        address++;
+      }
+      const auto length = address - first;
+
+      m_frame[0] = static_cast<hal::byte>(first);
+      std::copy_n(&m_shadow[first], length, &m_frame[1]);
+      HAL_CHECK(m_bus.write(std::span(m_frame).first(length + 1), p_timeout));
+
+      for (auto i = first; i < address; i++) {
+        m_dirty[i] = false;
+      }
+    }
+    return success();
+  }
+
+  /**
+   * @brief Determine if there are writes waiting to be flushed
+   *
+   * @return true - if at least one register is dirty
+   */
+  [[nodiscard]] bool dirty() const
+  {
+    return m_dirty.any();
+  }
+
+private:
+  /// Read a range without write only registers, in at most one burst
+  status read_run(std::size_t p_first,
+                  std::span<hal::byte> p_data,
+                  hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    bool cached = true;
+    for (std::size_t i = 0; i < p_data.size(); i++) {
+      cached = cached && served_from_cache(p_first + i);
+    }
+
+    if (!cached) {
+      HAL_CHECK(
+        m_bus.read(static_cast<hal::byte>(p_first), p_data, p_timeout));
+      for (std::size_t i = 0; i < p_data.size(); i++) {
+        const auto address = p_first + i;
+        // Never clobber a value waiting to be flushed
+        if (Map[address] == register_access::cacheable && !m_dirty[address]) {
+          m_shadow[address] = p_data[i];
+          m_valid[address] = true;
+        }
+      }
+    }
+
+    for (std::size_t i = 0; i < p_data.size(); i++) {
+      if (served_from_cache(p_first + i)) {
+        p_data[i] = m_shadow[p_first + i];
+      }
+    }
+    return success();
+  }
+
+  [[nodiscard]] bool served_from_cache(std::size_t p_address) const
+  {
+    switch (Map[p_address]) {
+      case register_access::cacheable:
+        return m_valid[p_address];
+      case register_access::write_only:
+        return true;
+      case register_access::volatile_register:
+      default:
+        return false;
+    }
+  }
+
+  [[nodiscard]] static status check_range(std::size_t p_first,
+                                          std::size_t p_length)
+  {
+    if (p_first + p_length > register_count) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    return success();
+  }
+
+  Bus m_bus;
+  std::array<hal::byte, register_count> m_shadow{};
+  std::array<hal::byte, register_count + 1> m_frame{};
+  std::bitset<register_count> m_valid{};
+  std::bitset<register_count> m_dirty{};
+};
+}  // namespace hal
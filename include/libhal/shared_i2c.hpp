@@ -0,0 +1,329 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+
+#include "error.hpp"
+#include "functional.hpp"
+#include "i2c.hpp"
+#include "steady_clock.hpp"
+#include "timeout.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Share a single i2c bus between multiple threads with priority
+ * ordered access
+ *
+ * Each user of the bus gets its own `shared_i2c::device`, which implements
+ * `hal::i2c` and can be handed to a device driver like any other i2c. Only one
+ * device performs a transaction at a time. When the bus is busy, waiting
+ * devices are queued by priority and then by arrival order, so that a high
+ * rate control loop sensor does not get stuck behind a queue of slow EEPROM
+ * writes.
+ *
+ * The internal lock is only held to update the wait queue. It is never held
+ * while a transaction is being performed or while a waiting device is calling
+ * its timeout function, meaning that a device whose timeout expires while
+ * waiting leaves the queue without blocking anyone.
+ *
+ * A device's transaction list (`transactions()`) holds the bus for the whole
+ * list, so other devices cannot interleave with it.
+ *
+ * Each device records how long it waited for the bus, in steady clock ticks.
+ *
+ * This requires a platform with thread support (std::mutex and
+ * std::condition_variable).
+ */
+class shared_i2c
+{
+public:
+  /**
+   * @brief Time between checks of a waiting device's timeout function
+   *
+   */
+  static constexpr auto timeout_poll_period = std::chrono::microseconds(500);
+
+  /**
+   * @brief Statistics about a device's access to the bus
+   *
+   */
+  struct wait_statistics
+  {
+    /// Number of transactions performed by the device
+    std::uint64_t transactions = 0;
+    /// Sum of the steady clock ticks spent waiting for the bus
+    std::uint64_t total_wait_ticks = 0;
+    /// Longest wait for the bus in steady clock ticks
+    std::uint64_t max_wait_ticks = 0;
+  };
+
+  /**
+   * @brief A handle to the shared bus for a single user
+   *
+   * Devices hold a reference to the shared_i2c that created them, which must
+   * outlive them. A device object must not be used by more than one thread at
+   * a time.
+   */
+  class device : public hal::i2c
+  {
+  public:
+    /**
+     * @brief Get statistics about this device's access to the bus
+     *
+     * @return wait_statistics - bus access statistics
+     */
+    [[nodiscard]] wait_statistics statistics() const
+    {
+      return m_statistics;
+    }
+
+    /**
+     * @brief Get the priority of this device
+     *
+     * @return int - priority, higher values are served first
+     */
+    [[nodiscard]] int priority() const
+    {
+      return m_priority;
+    }
+
+  private:
+    friend class shared_i2c;
+
+    device(shared_i2c& p_shared, int p_priority)
+      : m_shared(&p_shared)
+      , m_priority(p_priority)
+    {
+    }
+
+    status driver_configure(const settings& p_settings) override
+    {
+      // Applied to the bus before each of this device's transactions
+      m_settings = p_settings;
+      return success();
+    }
+
+    result<transaction_t> driver_transaction(
+      hal::byte p_address,
+      std::span<const hal::byte> p_data_out,
+      std::span<hal::byte> p_data_in,
+      hal::function_ref<hal::timeout_function> p_timeout) override
+    {
+      return m_shared->with_bus(*this, 1, p_timeout, [&]() {
+        return m_shared->m_bus->transaction(
+          p_address, p_data_out, p_data_in, p_timeout);
+      });
+    }
+
+    result<transaction_t> driver_transactions(
+      std::span<const transaction_descriptor> p_transactions,
+      hal::function_ref<hal::timeout_function> p_timeout) override
+    {
+      // The bus is held for the whole list so that no other device can
+      // interleave a transaction between two of this device's transactions.
+      return m_shared->with_bus(
+        *this, p_transactions.size(), p_timeout, [&]() {
+          return m_shared->m_bus->transactions(p_transactions, p_timeout);
+        });
+    }
+
+    shared_i2c* m_shared;
+    int m_priority;
+    std::optional<settings> m_settings{};
+    wait_statistics m_statistics{};
+  };
+
+  /**
+   * @brief Construct a new shared i2c bus
+   *
+   * @param p_bus - i2c bus to share
+   * @param p_clock - steady clock used to measure waiting time
+   */
+  shared_i2c(hal::i2c& p_bus, hal::steady_clock& p_clock)
+    : m_bus(&p_bus)
+    , m_clock(&p_clock)
+  {
+  }
+
+  shared_i2c(const shared_i2c&) = delete;
+  shared_i2c& operator=(const shared_i2c&) = delete;
+  shared_i2c(shared_i2c&&) = delete;
+  shared_i2c& operator=(shared_i2c&&) = delete;
+
+  /**
+   * @brief Create a handle to the bus
+   *
+   * @param p_priority - priority of the device when waiting for the bus,
+   * higher values are served first. Devices of the same priority are served
+   * in the order they started waiting.
+   * @return device - i2c handle to the shared bus
+   */
+  [[nodiscard]] device make_device(int p_priority = 0)
+  {
+    return device(*this, p_priority);
+  }
+
+  /**
+   * @brief Get the number of devices currently waiting for the bus
+   *
+   * @return std::size_t - number of waiting devices
+   */
+  [[nodiscard]] std::size_t waiting() const
+  {
+    std::scoped_lock lock(m_mutex);
+    std::size_t count = 0;
+    for (auto* node = m_queue; node != nullptr; node = node->next) {
+      count++;
+    }
+    return count;
+  }
+
+private:
+  /// Queue entry, lives on the stack of the waiting thread
+  struct waiter
+  {
+    int priority;
+    waiter* next = nullptr;
+    bool granted = false;
+  };
+
+  /**
+   * @brief Perform p_operation on the bus on behalf of p_device
+   *
+   * @param p_device - device performing the operation
+   * @param p_count - number of transactions p_operation performs
+   * @param p_timeout - timeout for waiting for the bus
+   * @param p_operation - callable performing the transactions on m_bus
+   * @return result<i2c::transaction_t> - result of p_operation
+   */
+  template<class Operation>
+  result<i2c::transaction_t> with_bus(
+    device& p_device,
+    std::size_t p_count,
+    hal::function_ref<hal::timeout_function> p_timeout,
+    Operation p_operation)
+  {
+    const auto wait_start = m_clock->uptime().ticks;
+    HAL_CHECK(acquire(p_device.m_priority, p_timeout));
+    const auto wait_ticks = m_clock->uptime().ticks - wait_start;
+
+    auto& statistics = p_device.m_statistics;
+    statistics.transactions += p_count;
+    statistics.total_wait_ticks += wait_ticks;
+    statistics.max_wait_ticks = std::max(statistics.max_wait_ticks, wait_ticks);
+
+    auto operation_result = [&]() -> result<i2c::transaction_t> {
+      // Only reconfigure the bus when switching to a device that needs a
+      // different clock rate
+      if (p_device.m_settings &&
+          (!m_applied_settings || m_applied_settings->clock_rate !=
+                                    p_device.m_settings->clock_rate)) {
+        HAL_CHECK(m_bus->configure(*p_device.m_settings));
+        m_applied_settings = p_device.m_settings;
+      }
+      return p_operation();
+    }();
+
+    release();
+    return operation_result;
+  }
+
+  status acquire(int p_priority,
+                 hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    std::unique_lock lock(m_mutex);
+    if (!m_busy && m_queue == nullptr) {
+      m_busy = true;
+      return success();
+    }
+
+    waiter node{ .priority = p_priority };
+    enqueue(node);
+
+    while (!node.granted) {
+      m_condition.wait_for(lock, timeout_poll_period);
+      if (node.granted) {
+        break;
+      }
+
+      lock.unlock();
+      auto timeout_result = p_timeout();
+      lock.lock();
+
+      if (!timeout_result && !node.granted) {
+        dequeue(node);
+        return timeout_result;
+      }
+    }
+
+    return success();
+  }
+
+  void release()
+  {
+    {
+      std::scoped_lock lock(m_mutex);
+      if (m_queue == nullptr) {
+        m_busy = false;
+        return;
+      }
+      // Ownership of the bus passes directly to the next waiter so that no
+      // other thread can take the bus in between.
+      auto* next = m_queue;
+      m_queue = next->next;
+      next->granted = true;
+    }
+    m_condition.notify_all();
+  }
+
+  void enqueue(waiter& p_node)
+  {
+    // Insert after every waiter of equal or higher priority to keep arrival
+    // order within a priority level
+    waiter** link = &m_queue;
+    while (*link != nullptr && (*link)->priority >= p_node.priority) {
+      link = &(*link)->next;
+    }
+    p_node.next = *link;
+    *link = &p_node;
+  }
+
+  void dequeue(waiter& p_node)
+  {
+    for (waiter** link = &m_queue; *link != nullptr; link = &(*link)->next) {
+      if (*link == &p_node) {
+        *link = p_node.next;
+        return;
+      }
+    }
+  }
+
+  hal::i2c* m_bus;
+  hal::steady_clock* m_clock;
+  mutable std::mutex m_mutex{};
+  std::condition_variable m_condition{};
+  waiter* m_queue = nullptr;
+  std::optional<i2c::settings> m_applied_settings{};
+  bool m_busy = false;
+};
+}  // namespace hal
@@ -0,0 +1,349 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include "error.hpp"
+#include "functional.hpp"
+#include "i2c.hpp"
+#include "steady_clock.hpp"
+#include "timeout.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Model of a device that can be mounted onto a `hal::simulated_i2c`
+ *
+ * The simulated bus calls `write()` with the bytes written by the controller
+ * and then `read()` with the buffer the controller expects to be filled. A
+ * write-then-read transaction (repeated start) calls both, in that order.
+ * Returning an error from either function acts as a NACK of the data.
+ */
+class simulated_i2c_device
+{
+public:
+  /**
+   * @brief Receive the bytes written by the controller
+   *
+   * @param p_data - bytes written to the device
+   * @return status - success or an error to fail the transaction with
+   */
+  [[nodiscard]] status write(std::span<const hal::byte> p_data)
+  {
+    return driver_write(p_data);
+  }
+
+  /**
+   * @brief Fill the bytes read by the controller
+   *
+   * @param p_data - buffer to fill with the device's response
+   * @return status - success or an error to fail the transaction with
+   */
+  [[nodiscard]] status read(std::span<hal::byte> p_data)
+  {
+    return driver_read(p_data);
+  }
+
+  virtual ~simulated_i2c_device() = default;
+
+private:
+  virtual status driver_write(std::span<const hal::byte> p_data) = 0;
+  virtual status driver_read(std::span<hal::byte> p_data) = 0;
+};
+
+/**
+ * @brief Model of a typical register based i2c device
+ *
+ * The first byte written sets the register pointer and any following bytes
+ * are written to consecutive registers. Reads start from the register pointer.
+ * The pointer auto increments after each byte and wraps around at the end of
+ * the register space.
+ *
+ * The register storage is owned by the caller so that tests can set up and
+ * inspect the device's state directly.
+ */
+class i2c_register_model : public simulated_i2c_device
+{
+public:
+  /**
+   * @brief Construct a new register model
+   *
+   * @param p_registers - the device's register space, must not be empty
+   */
+  explicit i2c_register_model(std::span<hal::byte> p_registers)
+    : m_registers(p_registers)
+  {
+  }
+
+  /**
+   * @brief Get the current register pointer
+   *
+   * @return std::size_t - address of the next register to be accessed
+   */
+  [[nodiscard]] std::size_t pointer() const
+  {
+    return m_pointer;
+  }
+
+private:
+  status driver_write(std::span<const hal::byte> p_data) override
+  {
+    if (p_data.empty()) {
+      return success();
+    }
+    if (p_data[0] >= m_registers.size()) {
+      return hal::new_error(std::errc::io_error);
+    }
+    m_pointer = p_data[0];
+    for (auto value : p_data.subspan(1)) {
+      m_registers[m_pointer] = value;
+      advance();
+    }
+    return success();
+  }
+
+  status driver_read(std::span<hal::byte> p_data) override
+  {
+    for (auto& value : p_data) {
+      value = m_registers[m_pointer];
+      advance();
+    }
+    return success();
+  }
+
+  void advance()
+  {
+    m_pointer++;
+    if (m_pointer == m_registers.size()) {
+      m_pointer = 0;
+    }
+  }
+
+  std::span<hal::byte> m_registers;
+  std::size_t m_pointer = 0;
+};
+
+/**
+ * @brief Simulated i2c bus for testing drivers without hardware
+ *
+ * Device models are mounted at 7-bit addresses. Transactions to an address
+ * without a device fail with `std::errc::no_such_device_or_address`, as they
+ * would when the address byte is not acknowledged.
+ *
+ * The bus keeps virtual time, available through `clock()`. Each transaction
+ * advances it by the time the bytes would take on the wire at the configured
+ * clock rate plus any clock stretching configured for the device. Faults can
+ * be injected to make a number of upcoming transactions fail. A transaction
+ * with nothing to write or read puts nothing on the bus and succeeds without
+ * being counted, timed or checked against injected faults.
+ *
+ * Lookups and transactions do no allocation and take constant time apart
+ * from the device model itself.
+ */
+class simulated_i2c : public hal::i2c
+{
+public:
+  /// Number of addresses available to 7-bit addressed devices
+  static constexpr std::size_t address_count = 128;
+
+  /**
+   * @brief Construct a new simulated i2c bus with no devices mounted
+   *
+   */
+  simulated_i2c() = default;
+
+  simulated_i2c(const simulated_i2c&) = delete;
+  simulated_i2c& operator=(const simulated_i2c&) = delete;
+  simulated_i2c(simulated_i2c&&) = delete;
+  simulated_i2c& operator=(simulated_i2c&&) = delete;
+
+  /**
+   * @brief Mount a device model onto the bus
+   *
+   * @param p_address - 7-bit address of the device
+   * @param p_device - device model, must outlive its time on the bus
+   * @param p_stretch - time the device holds the clock low after each byte
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument - if the address is not a 7-bit
+   * address
+   * @throws std::errc::address_in_use - if a device is already mounted at the
+   * address
+   */
+  [[nodiscard]] status mount(
+    hal::byte p_address,
+    simulated_i2c_device& p_device,
+    std::chrono::nanoseconds p_stretch = std::chrono::nanoseconds(0))
+  {
+    if (p_address >= address_count) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    auto& slot = m_devices[p_address];
+    if (slot.device != nullptr) {
+      return hal::new_error(std::errc::address_in_use);
+    }
+    slot.device = &p_device;
+    slot.stretch_ns = static_cast<std::uint64_t>(p_stretch.count());
+    return success();
+  }
+
+  /**
+   * @brief Remove the device at an address from the bus
+   *
+   * @param p_address - 7-bit address of the device
+   */
+  void unmount(hal::byte p_address)
+  {
+    if (p_address < address_count) {
+      m_devices[p_address] = mounted_device{};
+    }
+  }
+
+  /**
+   * @brief Make upcoming transactions fail
+   *
+   * @param p_error - error the failing transactions return
+   * @param p_after - number of transactions to let through first
+   * @param p_count - number of transactions to fail
+   */
+  void inject_fault(std::errc p_error,
+                    std::uint32_t p_after = 0,
+                    std::uint32_t p_count = 1)
+  {
+    m_fault_error = p_error;
+    m_fault_after = p_after;
+    m_fault_count = p_count;
+  }
+
+  /**
+   * @brief Get the number of transactions performed on the bus
+   *
+   * @return std::uint64_t - number of transactions, including failed ones but
+   * not empty ones
+   */
+  [[nodiscard]] std::uint64_t transactions() const
+  {
+    return m_transactions;
+  }
+
+  /**
+   * @brief Get the bus's virtual time
+   *
+   * The clock ticks once per nanosecond of virtual time.
+   *
+   * @return hal::steady_clock& - clock that only advances with bus activity
+   */
+  [[nodiscard]] hal::steady_clock& clock()
+  {
+    return m_clock;
+  }
+
+private:
+  struct mounted_device
+  {
+    simulated_i2c_device* device = nullptr;
+    std::uint64_t stretch_ns = 0;
+  };
+
+  class virtual_clock : public hal::steady_clock
+  {
+  public:
+    std::uint64_t m_ticks = 0;
+
+  private:
+    frequency_t driver_frequency() override
+    {
+      return frequency_t{ .operating_frequency = 1.0_GHz };
+    }
+
+    uptime_t driver_uptime() override
+    {
+      return uptime_t{ .ticks = m_ticks };
+    }
+  };
+
+  status driver_configure(const settings& p_settings) override
+  {
+    if (p_settings.clock_rate <= 0.0f) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    m_bit_ns = static_cast<std::uint64_t>(1.0e9f / p_settings.clock_rate);
+    return success();
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    // Nothing is put on the bus, so nothing is counted or timed
+    if (p_data_out.empty() && p_data_in.empty()) {
+      return transaction_t{};
+    }
+
+    m_transactions++;
+
+    // Start, address byte with ACK and stop
+    std::uint64_t bits = 1 + 9 + 1;
+    if (!p_data_out.empty() && !p_data_in.empty()) {
+      // Repeated start and second address byte
+      bits += 1 + 9;
+    }
+    const auto bytes = p_data_out.size() + p_data_in.size();
+    m_clock.m_ticks += (bits + 9 * bytes) * m_bit_ns;
+
+    if (m_fault_count > 0) {
+      if (m_fault_after > 0) {
+        m_fault_after--;
+      } else {
+        m_fault_count--;
+        return hal::new_error(m_fault_error);
+      }
+    }
+
+    if (p_address >= address_count || m_devices[p_address].device == nullptr) {
+      return hal::new_error(std::errc::no_such_device_or_address);
+    }
+    const auto& mounted = m_devices[p_address];
+
+    if (mounted.stretch_ns > 0 && bytes > 0) {
+      m_clock.m_ticks += mounted.stretch_ns * bytes;
+      HAL_CHECK(p_timeout());
+    }
+
+    if (!p_data_out.empty()) {
+      HAL_CHECK(mounted.device->write(p_data_out));
+    }
+    if (!p_data_in.empty()) {
+      HAL_CHECK(mounted.device->read(p_data_in));
+    }
+    return transaction_t{};
+  }
+
+  std::array<mounted_device, address_count> m_devices{};
+  virtual_clock m_clock{};
+  std::uint64_t m_bit_ns = 10'000;
+  std::uint64_t m_transactions = 0;
+  std::uint32_t m_fault_after = 0;
+  std::uint32_t m_fault_count = 0;
+  std::errc m_fault_error = std::errc::io_error;
+};
+}  // namespace hal
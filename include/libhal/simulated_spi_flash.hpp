@@ -0,0 +1,391 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "error.hpp"
+#include "output_pin.hpp"
+#include "spi.hpp"
+#include "spi_flash.hpp"
+#include "steady_clock.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Simulated JEDEC spi NOR flash for testing without hardware
+ *
+ * Implements the commands used by `hal::spi_flash` on top of caller supplied
+ * storage. Like a real device:
+ *
+ *   - commands are framed by the chip select pin returned by `chip_select()`
+ *   - program and erase commands require a preceding write enable and start
+ *     when chip select is released
+ *   - programming can only clear bits and wraps around within a page
+ *   - while a program or erase is in progress, only the status register can
+ *     be read and every other command is ignored
+ *
+ * To use it with `hal::spi_flash`, put it on a `hal::spi_bus` and create a
+ * `hal::spi_device` from the bus and `chip_select()`.
+ *
+ * The device keeps virtual time, available through `clock()`, which advances
+ * with each byte transferred at the configured clock rate. Program and erase
+ * operations keep the device busy for the configured amount of virtual time.
+ */
+class simulated_spi_flash : public hal::spi
+{
+public:
+  /**
+   * @brief Duration of program and erase operations
+   *
+   * The defaults are typical values for a 16 MiB device.
+   */
+  struct timings
+  {
+    std::chrono::nanoseconds page_program = std::chrono::microseconds(700);
+    std::chrono::nanoseconds sector_erase = std::chrono::milliseconds(45);
+    std::chrono::nanoseconds block_erase = std::chrono::milliseconds(150);
+    std::chrono::nanoseconds chip_erase = std::chrono::seconds(40);
+  };
+
+  /// Manufacturer id reported by the simulated device
+  static constexpr hal::byte manufacturer_id = 0xEF;
+  /// Memory type reported by the simulated device
+  static constexpr hal::byte memory_type = 0x40;
+  /// Page size of the simulated device
+  static constexpr std::size_t page_size = 256;
+  /// Sector size of the simulated device
+  static constexpr std::size_t sector_size = 4 * 1024;
+  /// Block size of the simulated device
+  static constexpr std::size_t block_size = 64 * 1024;
+
+  /**
+   * @brief Construct a new simulated flash
+   *
+   * @param p_storage - contents of the flash. The size must be a power of 2 of
+   * at least one block.
+   * @param p_timings - duration of program and erase operations
+   */
+  simulated_spi_flash(std::span<hal::byte> p_storage,
+                      const timings& p_timings)
+    : m_storage(p_storage)
+    , m_timings(p_timings)
+    , m_chip_select(*this)
+  {
+  }
+
+  /**
+   * @brief Construct a new simulated flash with typical timings
+   *
+   * @param p_storage - contents of the flash. The size must be a power of 2 of
+   * at least one block.
+   */
+  explicit simulated_spi_flash(std::span<hal::byte> p_storage)
+    : simulated_spi_flash(p_storage, timings{})
+  {
+  }
+
+  simulated_spi_flash(const simulated_spi_flash&) = delete;
+  simulated_spi_flash& operator=(const simulated_spi_flash&) = delete;
+  simulated_spi_flash(simulated_spi_flash&&) = delete;
+  simulated_spi_flash& operator=(simulated_spi_flash&&) = delete;
+
+  /**
+   * @brief Get the device's active LOW chip select pin
+   *
+   * @return hal::output_pin& - chip select pin
+   */
+  [[nodiscard]] hal::output_pin& chip_select()
+  {
+    return m_chip_select;
+  }
+
+  /**
+   * @brief Get the device's virtual time
+   *
+   * The clock ticks once per nanosecond of virtual time.
+   *
+   * @return hal::steady_clock& - clock that only advances with bus activity
+   */
+  [[nodiscard]] hal::steady_clock& clock()
+  {
+    return m_clock;
+  }
+
+  /**
+   * @brief Determine if a program or erase is in progress
+   *
+   * @return true - if the device is busy
+   */
+  [[nodiscard]] bool busy() const
+  {
+    return m_clock.m_ticks < m_busy_until;
+  }
+
+  /**
+   * @brief Get the number of page programs performed
+   *
+   * @return std::uint32_t - number of page program operations
+   */
+  [[nodiscard]] std::uint32_t programs() const
+  {
+    return m_programs;
+  }
+
+  /**
+   * @brief Get the number of erase operations performed
+   *
+   * @return std::uint32_t - number of sector, block and chip erases
+   */
+  [[nodiscard]] std::uint32_t erases() const
+  {
+    return m_erases;
+  }
+
+private:
+  class chip_select_pin : public hal::output_pin
+  {
+  public:
+    explicit chip_select_pin(simulated_spi_flash& p_flash)
+      : m_flash(&p_flash)
+    {
+    }
+
+  private:
+    status driver_configure(const settings&) override
+    {
+      return success();
+    }
+
+    result<set_level_t> driver_level(bool p_high) override
+    {
+      if (p_high && m_flash->m_selected) {
+        m_flash->deselect();
+      } else if (!p_high && !m_flash->m_selected) {
+        m_flash->select();
+      }
+      return set_level_t{};
+    }
+
+    result<level_t> driver_level() override
+    {
+      return level_t{ .state = !m_flash->m_selected };
+    }
+
+    simulated_spi_flash* m_flash;
+  };
+
+  class virtual_clock : public hal::steady_clock
+  {
+  public:
+    std::uint64_t m_ticks = 0;
+
+  private:
+    frequency_t driver_frequency() override
+    {
+      return frequency_t{ .operating_frequency = 1.0_GHz };
+    }
+
+    uptime_t driver_uptime() override
+    {
+      return uptime_t{ .ticks = m_ticks };
+    }
+  };
+
+  status driver_configure(const settings& p_settings) override
+  {
+    if (p_settings.clock_rate <= 0.0f) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    m_byte_ns = static_cast<std::uint64_t>(8.0e9f / p_settings.clock_rate);
+    return success();
+  }
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte> p_data_out,
+                                     std::span<hal::byte> p_data_in,
+                                     hal::byte p_filler) override
+  {
+    const auto length = std::max(p_data_out.size(), p_data_in.size());
+    for (std::size_t i = 0; i < length; i++) {
+      const auto byte_out = i < p_data_out.size() ? p_data_out[i] : p_filler;
+      m_clock.m_ticks += m_byte_ns;
+      // Nothing drives MISO when the device is not selected
+      const auto byte_in = m_selected ? exchange(byte_out) : hal::byte{ 0xFF };
+      if (i < p_data_in.size()) {
+        p_data_in[i] = byte_in;
+      }
+    }
+    return transfer_t{};
+  }
+
+  void select()
+  {
+    m_selected = true;
+    m_position = 0;
+    m_address = 0;
+    m_command = 0;
+    m_data_bytes = 0;
+  }
+
+  void deselect()
+  {
+    m_selected = false;
+    if (busy() || !m_write_enabled) {
+      return;
+    }
+
+    const bool address_complete = m_position >= 4;
+    switch (m_command) {
+      case spi_flash::command::page_program:
+        if (address_complete && m_data_bytes > 0) {
+          start_operation(m_timings.page_program);
+          m_programs++;
+        }
+        break;
+      case spi_flash::command::sector_erase:
+        if (address_complete) {
+          erase_region(sector_size, m_timings.sector_erase);
+        }
+        break;
+      case spi_flash::command::block_erase:
+        if (address_complete) {
+          erase_region(block_size, m_timings.block_erase);
+        }
+        break;
+      case spi_flash::command::chip_erase:
+        std::fill(m_storage.begin(), m_storage.end(), hal::byte{ 0xFF });
+        start_operation(m_timings.chip_erase);
+        m_erases++;
+        break;
+      default:
+        break;
+    }
+  }
+
+  void erase_region(std::size_t p_size, std::chrono::nanoseconds p_duration)
+  {
+    const auto start = wrap(m_address) & ~(p_size - 1);
+    const auto region = m_storage.subspan(start, p_size);
+    std::fill(region.begin(), region.end(), hal::byte{ 0xFF });
+    start_operation(p_duration);
+    m_erases++;
+  }
+
+  void start_operation(std::chrono::nanoseconds p_duration)
+  {
+    const auto duration = static_cast<std::uint64_t>(p_duration.count());
+    m_busy_until = m_clock.m_ticks + duration;
+    m_write_enabled = false;
+  }
+
+  hal::byte status_register() const
+  {
+    hal::byte value = 0;
+    if (busy()) {
+      value |= spi_flash::status_busy;
+    }
+    if (m_write_enabled) {
+      value |= spi_flash::status_write_enabled;
+    }
+    return value;
+  }
+
+  hal::byte exchange(hal::byte p_byte)
+  {
+    const auto position = m_position++;
+
+    if (position == 0) {
+      m_command = p_byte;
+      if (m_command == spi_flash::command::write_enable && !busy()) {
+        m_write_enabled = true;
+      }
+      return 0xFF;
+    }
+
+    if (m_command == spi_flash::command::read_status) {
+      return status_register();
+    }
+    if (busy()) {
+      return 0xFF;
+    }
+
+    if (m_command == spi_flash::command::read_jedec_id) {
+      switch (position) {
+        case 1:
+          return manufacturer_id;
+        case 2:
+          return memory_type;
+        case 3:
+          return static_cast<hal::byte>(std::countr_zero(m_storage.size()));
+        default:
+          return 0xFF;
+      }
+    }
+
+    if (position <= 3) {
+      m_address = (m_address << 8) | p_byte;
+      return 0xFF;
+    }
+
+    switch (m_command) {
+      case spi_flash::command::fast_read:
+        if (position == 4) {
+          // Dummy byte
+          return 0xFF;
+        }
+        [[fallthrough]];
+      case spi_flash::command::read:
+        return m_storage[wrap(m_address++)];
+      case spi_flash::command::page_program: {
+        if (!m_write_enabled) {
+          return 0xFF;
+        }
+        const auto page_start = wrap(m_address) & ~(page_size - 1);
+        const auto offset = (wrap(m_address) + m_data_bytes) % page_size;
+        m_storage[page_start + offset] &= p_byte;
+        m_data_bytes++;
+        return 0xFF;
+      }
+      default:
+        return 0xFF;
+    }
+  }
+
+  std::size_t wrap(std::size_t p_address) const
+  {
+    return p_address & (m_storage.size() - 1);
+  }
+
+  std::span<hal::byte> m_storage;
+  timings m_timings;
+  chip_select_pin m_chip_select;
+  virtual_clock m_clock{};
+  std::uint64_t m_byte_ns = 80'000;
+  std::uint64_t m_busy_until = 0;
+  std::size_t m_position = 0;
+  std::size_t m_address = 0;
+  std::size_t m_data_bytes = 0;
+  std::uint32_t m_programs = 0;
+  std::uint32_t m_erases = 0;
+  hal::byte m_command = 0;
+  bool m_selected = false;
+  bool m_write_enabled = false;
+};
+}  // namespace hal
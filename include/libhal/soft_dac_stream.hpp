@@ -0,0 +1,209 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "dac.hpp"
+#include "dac_stream.hpp"
+#include "error.hpp"
+#include "functional.hpp"
+#include "q16.hpp"
+#include "steady_clock.hpp"
+#include "timer.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Software dac stream writing one sample per timer callback
+ *
+ * Each timer callback schedules the next one and then writes a sample with
+ * `hal::dac::write(q16)`, so drivers that override the fixed point write turn
+ * each sample into a dac code without float arithmetic.
+ *
+ * Callbacks are scheduled against absolute deadlines read from a steady
+ * clock, so interrupt latency and the time taken by the callback delay a
+ * single sample rather than accumulating into the period. Sample periods that
+ * are not a whole number of clock ticks are spread over the periods, so the
+ * average sample rate matches the requested one.
+ */
+class soft_dac_stream : public dac_stream
+{
+public:
+  /**
+   * @brief Construct a new software dac stream
+   *
+   * @param p_dac - dac to write the samples to
+   * @param p_timer - timer used to pace the samples
+   * @param p_clock - clock the sample deadlines are measured with
+   */
+  soft_dac_stream(hal::dac& p_dac,
+                  hal::timer& p_timer,
+                  hal::steady_clock& p_clock)
+    : m_dac(&p_dac)
+    , m_timer(&p_timer)
+    , m_clock(&p_clock)
+  {
+  }
+
+  soft_dac_stream(const soft_dac_stream&) = delete;
+  soft_dac_stream& operator=(const soft_dac_stream&) = delete;
+  soft_dac_stream(soft_dac_stream&&) = delete;
+  soft_dac_stream& operator=(soft_dac_stream&&) = delete;
+
+  /**
+   * @brief Get the number of samples the dac failed to write
+   *
+   * @return std::uint32_t - number of failed writes since construction
+   */
+  [[nodiscard]] std::uint32_t write_errors() const
+  {
+    return m_write_errors.load(std::memory_order_relaxed);
+  }
+
+private:
+  bool driver_submit(std::span<const q16> p_samples) override
+  {
+    const auto submitted = m_submitted.load(std::memory_order_relaxed);
+    const auto completed = m_completed.load(std::memory_order_acquire);
+    if (p_samples.empty() || submitted - completed >= queue_depth) {
+      return false;
+    }
+    m_queue[submitted % queue_depth] = p_samples;
+    m_submitted.store(submitted + 1, std::memory_order_release);
+    return true;
+  }
+
+  void driver_on_complete(hal::callback<complete_handler> p_handler) override
+  {
+    m_on_complete = p_handler;
+  }
+
+  status driver_start(hertz p_sample_rate) override
+  {
+    // Split the period, in clock ticks, into a whole part and a fraction of
+    // the sample rate in millihertz, so deadlines never drift from rounding
+    const auto clock_rate = m_clock->frequency().operating_frequency;
+    const auto millihertz =
+      static_cast<std::uint64_t>(p_sample_rate * 1000.0f + 0.5f);
+    const auto ticks_per_kilosecond =
+      static_cast<std::uint64_t>(clock_rate + 0.5f) * 1000U;
+    if (millihertz == 0 || ticks_per_kilosecond < millihertz) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+
+    m_ticks_per_second = ticks_per_kilosecond / 1000U;
+    m_period_ticks = ticks_per_kilosecond / millihertz;
+    m_period_fraction = ticks_per_kilosecond % millihertz;
+    m_fraction_divisor = millihertz;
+    m_fraction = 0;
+    m_deadline = m_clock->uptime().ticks;
+    m_running = true;
+    return schedule();
+  }
+
+  status driver_stop() override
+  {
+    m_running = false;
+    HAL_CHECK(m_timer->cancel());
+    return success();
+  }
+
+  std::size_t driver_queued() override
+  {
+    return m_submitted.load(std::memory_order_acquire) -
+           m_completed.load(std::memory_order_acquire);
+  }
+
+  std::uint32_t driver_underruns() override
+  {
+    return m_underruns.load(std::memory_order_relaxed);
+  }
+
+  /// Schedule the next tick for one period after the previous deadline
+  status schedule()
+  {
+    m_deadline += m_period_ticks;
+    m_fraction += m_period_fraction;
+    if (m_fraction >= m_fraction_divisor) {
+      m_fraction -= m_fraction_divisor;
+      m_deadline++;
+    }
+
+    const auto now = m_clock->uptime().ticks;
+    const auto remaining = m_deadline > now ? m_deadline - now : 0;
+    const auto delay = hal::time_duration(
+      static_cast<hal::time_duration::rep>(remaining * 1'000'000'000U /
+                                           m_ticks_per_second));
+    HAL_CHECK(m_timer->schedule([this]() { tick(); }, delay));
+    return success();
+  }
+
+  /// Add one to a counter only written from the timer's context, without an
+  /// atomic read-modify-write, which some cores lack
+  static void count(std::atomic<std::uint32_t>& p_counter)
+  {
+    p_counter.store(p_counter.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+  }
+
+  void tick()
+  {
+    // Schedule first so that the time taken below does not delay the next
+    if (!m_running || !schedule()) {
+      m_running = false;
+    }
+
+    const auto completed = m_completed.load(std::memory_order_relaxed);
+    if (m_submitted.load(std::memory_order_acquire) == completed) {
+      count(m_underruns);
+      return;
+    }
+
+    const auto samples = m_queue[completed % queue_depth];
+    if (!m_dac->write(samples[m_position])) {
+      count(m_write_errors);
+    }
+
+    if (++m_position == samples.size()) {
+      m_position = 0;
+      m_completed.store(completed + 1, std::memory_order_release);
+      m_on_complete(samples);
+    }
+  }
+
+  hal::dac* m_dac;
+  hal::timer* m_timer;
+  hal::steady_clock* m_clock;
+  std::array<std::span<const q16>, queue_depth> m_queue{};
+  std::atomic<std::size_t> m_submitted = 0;
+  std::atomic<std::size_t> m_completed = 0;
+  hal::callback<complete_handler> m_on_complete = [](std::span<const q16>) {};
+  std::uint64_t m_ticks_per_second = 0;
+  std::uint64_t m_period_ticks = 0;
+  std::uint64_t m_period_fraction = 0;
+  std::uint64_t m_fraction_divisor = 1;
+  std::uint64_t m_fraction = 0;
+  std::uint64_t m_deadline = 0;
+  std::size_t m_position = 0;
+  std::atomic<std::uint32_t> m_underruns = 0;
+  std::atomic<std::uint32_t> m_write_errors = 0;
+  bool m_running = false;
+};
+}  // namespace hal
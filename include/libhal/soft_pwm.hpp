@@ -0,0 +1,338 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+
+#include "error.hpp"
+#include "output_pin.hpp"
+#include "pwm.hpp"
+#include "q16.hpp"
+#include "steady_clock.hpp"
+#include "timer.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Software pwm for many output pins sharing one timer
+ *
+ * Every pin is set HIGH at the start of each period, except those with a 0
+ * duty cycle, and set LOW when its duty cycle has elapsed. The channels are
+ * kept sorted by the time they go LOW, so each period takes one timer
+ * callback for the period start plus one per distinct LOW time, regardless of
+ * the number of channels or the duty cycle resolution. Channels with equal
+ * duty cycles share a callback.
+ *
+ * Duty cycle changes are picked up at the start of the next period. Each
+ * changed channel is moved to its new place in the schedule, the rest of the
+ * schedule is left as is. Frequency changes affect every channel.
+ *
+ * Edges are scheduled against absolute deadlines read from a steady clock, so
+ * interrupt latency and the time taken by the callbacks delay single edges
+ * rather than stretching the period. The period is rounded to the nearest
+ * clock tick.
+ *
+ * Duty cycles and frequency may be changed from one context that the timer
+ * callback can preempt, such as the main loop, on the same core. The new
+ * values are published to the callback with a release store of a flag, so
+ * the callback never sees the flag before the values. Changing them from more
+ * than one context needs those contexts to be masked from each other.
+ *
+ * Failed pin writes do not stop the waveform, they are counted and reported
+ * by `pin_errors()`.
+ *
+ * @tparam Count - number of channels
+ */
+template<std::size_t Count>
+class soft_pwm
+{
+public:
+  /**
+   * @brief One channel of the software pwm
+   *
+   * Changes take effect at the start of the next period. Change channels of
+   * the same soft_pwm from one context only, or mask the other contexts while
+   * doing so. The timer callback itself does not need to be masked.
+   */
+  class channel : public hal::pwm
+  {
+  private:
+    friend class soft_pwm;
+
+    result<frequency_t> driver_frequency(hertz p_frequency) override
+    {
+      m_engine->set_frequency(p_frequency);
+      return frequency_t{};
+    }
+
+    result<duty_cycle_t> driver_duty_cycle(float p_duty_cycle) override
+    {
+      m_engine->set_duty_cycle(m_index, q16::from_float(p_duty_cycle));
+      return duty_cycle_t{};
+    }
+
+    result<duty_cycle_t> driver_duty_cycle_fraction(q16 p_duty_cycle) override
+    {
+      m_engine->set_duty_cycle(m_index, p_duty_cycle);
+      return duty_cycle_t{};
+    }
+
+    soft_pwm* m_engine = nullptr;
+    std::size_t m_index = 0;
+  };
+
+  /**
+   * @brief Construct a new software pwm
+   *
+   * All channels start with a duty cycle of 0. Call `start()` to begin
+   * generating the waveforms.
+   *
+   * @param p_pins - output pin for each channel
+   * @param p_timer - timer used to time the edges
+   * @param p_clock - clock the edge deadlines are measured with
+   * @param p_frequency - initial frequency of every channel
+   */
+  soft_pwm(std::span<hal::output_pin* const, Count> p_pins,
+           hal::timer& p_timer,
+           hal::steady_clock& p_clock,
+           hertz p_frequency = 1.0_kHz)
+    : m_timer(&p_timer)
+    , m_clock(&p_clock)
+    , m_ticks_per_second(static_cast<std::uint64_t>(
+        p_clock.frequency().operating_frequency + 0.5f))
+  {
+    for (std::size_t i = 0; i < Count; i++) {
+      m_pins[i] = p_pins[i];
+      m_channels[i].m_engine = this;
+      m_channels[i].m_index = i;
+    }
+    std::iota(m_order.begin(), m_order.end(), std::size_t{ 0 });
+    set_frequency(p_frequency);
+  }
+
+  soft_pwm(const soft_pwm&) = delete;
+  soft_pwm& operator=(const soft_pwm&) = delete;
+  soft_pwm(soft_pwm&&) = delete;
+  soft_pwm& operator=(soft_pwm&&) = delete;
+
+  /**
+   * @brief Get a channel
+   *
+   * @param p_index - channel number, must be less than Count
+   * @return hal::pwm& - the channel
+   */
+  [[nodiscard]] hal::pwm& operator[](std::size_t p_index)
+  {
+    return m_channels[p_index];
+  }
+
+  /**
+   * @brief Start generating the waveforms
+   *
+   * @return status - success or failure
+   */
+  [[nodiscard]] status start()
+  {
+    m_running = true;
+    m_period_start = m_clock->uptime().ticks;
+    return start_period();
+  }
+
+  /**
+   * @brief Stop generating the waveforms
+   *
+   * The pins are left at their current level.
+   *
+   * @return status - success or failure
+   */
+  [[nodiscard]] status stop()
+  {
+    m_running = false;
+    HAL_CHECK(m_timer->cancel());
+    return success();
+  }
+
+  /**
+   * @brief Get the number of pin writes that failed
+   *
+   * @return std::uint32_t - number of failed writes since construction
+   */
+  [[nodiscard]] std::uint32_t pin_errors() const
+  {
+    return m_pin_errors.load(std::memory_order_relaxed);
+  }
+
+private:
+  void set_frequency(hertz p_frequency)
+  {
+    const auto period =
+      static_cast<float>(m_ticks_per_second) / p_frequency + 0.5f;
+    m_pending_period = std::max(static_cast<std::uint32_t>(period), 1U);
+    m_any_changed.store(true, std::memory_order_release);
+  }
+
+  void set_duty_cycle(std::size_t p_index, q16 p_duty_cycle)
+  {
+    m_pending[p_index] = p_duty_cycle;
+    m_changed[p_index] = true;
+    m_any_changed.store(true, std::memory_order_release);
+  }
+
+  /// Move a channel whose LOW time changed to its place in the schedule
+  void reschedule(std::size_t p_channel)
+  {
+    auto position = static_cast<std::size_t>(
+      std::find(m_order.begin(), m_order.end(), p_channel) - m_order.begin());
+    const auto off_time = m_off_time[p_channel];
+    while (position > 0 && m_off_time[m_order[position - 1]] > off_time) {
+      std::swap(m_order[position - 1], m_order[position]);
+      position--;
+    }
+    while (position + 1 < Count &&
+           m_off_time[m_order[position + 1]] < off_time) {
+      std::swap(m_order[position + 1], m_order[position]);
+      position++;
+    }
+  }
+
+  void apply_changes()
+  {
+    // The callback preempts the writer, so no change can be published between
+    // the load and the store, and load and store suffice on cores without
+    // atomic exchange
+    if (!m_any_changed.load(std::memory_order_acquire)) {
+      return;
+    }
+    m_any_changed.store(false, std::memory_order_relaxed);
+
+    if (m_pending_period != m_period) {
+      // Every LOW time scales with the period, which keeps their order
+      m_period = m_pending_period;
+      for (std::size_t i = 0; i < Count; i++) {
+        m_off_time[i] = m_duty_cycle[i].scale(m_period);
+      }
+    }
+
+    for (std::size_t i = 0; i < Count; i++) {
+      if (m_changed[i]) {
+        m_changed[i] = false;
+        m_duty_cycle[i] = m_pending[i];
+        m_off_time[i] = m_duty_cycle[i].scale(m_period);
+        reschedule(i);
+      }
+    }
+  }
+
+  void set_level(std::size_t p_index, bool p_high)
+  {
+    // Only the timer's context writes the count, so load and store suffice
+    // on cores without atomic increments
+    if (!m_pins[p_index]->level(p_high)) {
+      m_pin_errors.store(m_pin_errors.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+    }
+  }
+
+  status start_period()
+  {
+    apply_changes();
+    m_next_edge = 0;
+    for (const auto index : m_order) {
+      const bool active = m_off_time[index] > 0;
+      set_level(index, active);
+      if (!active) {
+        m_next_edge++;
+      }
+    }
+    return schedule_next();
+  }
+
+  void next_period()
+  {
+    // Advance by the period that just ended, before changes are applied
+    m_period_start += m_period;
+    if (!start_period()) {
+      m_running = false;
+    }
+  }
+
+  void end_edge()
+  {
+    const auto off_time = m_off_time[m_order[m_next_edge]];
+    while (m_next_edge < Count &&
+           m_off_time[m_order[m_next_edge]] == off_time) {
+      set_level(m_order[m_next_edge], false);
+      m_next_edge++;
+    }
+    if (!schedule_next()) {
+      m_running = false;
+    }
+  }
+
+  /// Schedule the next LOW edge, or the start of the next period
+  status schedule_next()
+  {
+    if (!m_running) {
+      return success();
+    }
+
+    const bool edge_pending = m_next_edge < Count &&
+                              m_off_time[m_order[m_next_edge]] < m_period;
+    const auto deadline =
+      m_period_start +
+      (edge_pending ? m_off_time[m_order[m_next_edge]] : m_period);
+    const auto now = m_clock->uptime().ticks;
+    const auto remaining = deadline > now ? deadline - now : 0;
+    const auto delay = hal::time_duration(
+      static_cast<hal::time_duration::rep>(remaining * 1'000'000'000U /
+                                           m_ticks_per_second));
+
+    if (edge_pending) {
+      HAL_CHECK(m_timer->schedule([this]() { end_edge(); }, delay));
+    } else {
+      HAL_CHECK(m_timer->schedule([this]() { next_period(); }, delay));
+    }
+    return success();
+  }
+
+  hal::timer* m_timer;
+  hal::steady_clock* m_clock;
+  std::uint64_t m_ticks_per_second;
+  std::array<hal::output_pin*, Count> m_pins{};
+  std::array<channel, Count> m_channels{};
+  std::array<q16, Count> m_duty_cycle{};
+  std::array<q16, Count> m_pending{};
+  std::array<bool, Count> m_changed{};
+  /// Clock ticks into the period at which each channel goes LOW
+  std::array<std::uint32_t, Count> m_off_time{};
+  /// Channel numbers sorted by LOW time
+  std::array<std::size_t, Count> m_order{};
+  std::size_t m_next_edge = 0;
+  /// Clock ticks at which the current period started
+  std::uint64_t m_period_start = 0;
+  std::uint32_t m_period = 0;
+  std::uint32_t m_pending_period = 0;
+  std::atomic<std::uint32_t> m_pin_errors = 0;
+  /// Set after the pending values are written, cleared by the callback
+  std::atomic<bool> m_any_changed = false;
+  bool m_running = false;
+};
+}  // namespace hal
@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <span>
@@ -51,6 +53,12 @@ public:
      *
      */
     bool data_valid_on_trailing_edge = false;
+
+    /**
+     * @brief Compare settings, used to skip redundant reconfiguration
+     *
+     */
+    bool operator==(const settings&) const = default;
   };
 
   /**
@@ -62,6 +70,20 @@ public:
   struct transfer_t
   {};
 
+  /**
+   * @brief One part of a scatter-gather transfer
+   *
+   * Each segment behaves like a call to `transfer()` with the same data_out
+   * and data_in.
+   */
+  struct transfer_segment
+  {
+    /// Bytes to write, see p_data_out of `transfer()`
+    std::span<const hal::byte> data_out{};
+    /// Buffer for the bytes read, see p_data_in of `transfer()`
+    std::span<hal::byte> data_in{};
+  };
+
   /// Default filler data placed on the bus in place of actual write data when
   /// the write buffer has been exhausted.
   static constexpr hal::byte default_filler = hal::byte{ 0xFF };
@@ -93,6 +115,9 @@ public:
    * @param p_filler - filler data placed on the bus in place of actual write
    * data when p_data_out has been exhausted.
    * @return result<transfer_t> - success or failure
+   *
+   * p_data_out and p_data_in must not overlap. Use `transfer_in_place()` to
+   * transmit and receive using a single buffer.
    */
   [[nodiscard]] result<transfer_t> transfer(
     std::span<const hal::byte> p_data_out,
@@ -102,6 +127,49 @@ public:
     return driver_transfer(p_data_out, p_data_in, p_filler);
   }
 
+  /**
+   * @brief Perform a sequence of transfers as a single transaction
+   *
+   * Sends a command, address and payload held in separate buffers without
+   * copying them into one buffer first. Implementations that manage a chip
+   * select, such as `hal::spi_device`, keep the device selected for all of
+   * the segments.
+   *
+   * @param p_segments - segments to transfer in order
+   * @param p_filler - filler data placed on the bus in place of actual write
+   * data when the data_out of a segment has been exhausted.
+   * @return result<transfer_t> - success or failure. On failure the remaining
+   * segments are not transferred.
+   */
+  [[nodiscard]] result<transfer_t> transfer(
+    std::span<const transfer_segment> p_segments,
+    hal::byte p_filler = default_filler)
+  {
+    return driver_transfer_segments(p_segments, p_filler);
+  }
+
+  /**
+   * @brief Full duplex transfer using a single buffer for both directions
+   *
+   * Each byte of p_data is written to the bus and then replaced by the byte
+   * received while it was being written. This function will block until the
+   * entire transfer is finished.
+   *
+   * Drivers that cannot transmit from and receive into the same memory use a
+   * default implementation that copies the outgoing data through a small
+   * stack buffer and performs the transfer in chunks. The bytes are sent in
+   * order, but the clock may pause between chunks.
+   *
+   * @param p_data - data to write to the bus, overwritten with the data read
+   * from the bus.
+   * @return result<transfer_t> - success or failure
+   */
+  [[nodiscard]] result<transfer_t> transfer_in_place(
+    std::span<hal::byte> p_data)
+  {
+    return driver_transfer_in_place(p_data);
+  }
+
   virtual ~spi() = default;
 
 private:
@@ -110,5 +178,50 @@ private:
     std::span<const hal::byte> p_data_out,
     std::span<hal::byte> p_data_in,
     hal::byte p_filler) = 0;
+
+  /**
+   * @brief Implementation of the scatter-gather `transfer()`
+   *
+   * Drivers with DMA descriptor chaining can override this to perform the
+   * segments back to back.
+   *
+   * @param p_segments - segments to transfer in order
+   * @param p_filler - filler byte for each segment
+   * @return result<transfer_t> - success or failure
+   */
+  virtual result<transfer_t> driver_transfer_segments(
+    std::span<const transfer_segment> p_segments,
+    hal::byte p_filler)
+  {
+    for (const auto& segment : p_segments) {
+      HAL_CHECK(driver_transfer(segment.data_out, segment.data_in, p_filler));
+    }
+    return transfer_t{};
+  }
+
+  /**
+   * @brief Implementation of `transfer_in_place()`
+   *
+   * Drivers whose hardware reads each outgoing byte before storing the
+   * incoming byte, such as FIFO or DMA based peripherals, should override
+   * this to transfer directly from and into p_data.
+   *
+   * @param p_data - data to write and buffer to read into
+   * @return result<transfer_t> - success or failure
+   */
+  virtual result<transfer_t> driver_transfer_in_place(
+    std::span<hal::byte> p_data)
+  {
+    std::array<hal::byte, 32> chunk{};
+    while (!p_data.empty()) {
+      const auto length = std::min(p_data.size(), chunk.size());
+      const auto data_out = std::span(chunk).first(length);
+      std::copy_n(p_data.begin(), length, data_out.begin());
+      HAL_CHECK(
+        driver_transfer(data_out, p_data.first(length), default_filler));
+      p_data = p_data.subspan(length);
+    }
+    return transfer_t{};
+  }
 };
 }  // namespace hal
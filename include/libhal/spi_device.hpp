@@ -0,0 +1,277 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <optional>
+#include <span>
+
+#include "error.hpp"
+#include "output_pin.hpp"
+#include "spi.hpp"
+#include "units.hpp"
+
+namespace hal {
+class spi_device;
+
+/**
+ * @brief A single transfer to a device, executed as part of a queue
+ *
+ */
+struct spi_transfer_descriptor
+{
+  /// Device to select for the transfer
+  spi_device* device;
+  /// Bytes to write, see `hal::spi::transfer()`
+  std::span<const hal::byte> data_out{};
+  /// Buffer for the bytes read, see `hal::spi::transfer()`
+  std::span<hal::byte> data_in{};
+  /// Byte written once data_out has been exhausted
+  hal::byte filler = hal::spi::default_filler;
+  /// Keep the chip select asserted when the next descriptor is for a device
+  /// with the same chip select, for example to send a command and its data as
+  /// separate descriptors in a single chip select frame. The frame is still
+  /// broken if the next device uses different settings.
+  bool keep_selected = false;
+};
+
+/**
+ * @brief An spi bus shared by devices that each have a chip select line
+ *
+ * The bus remembers the settings that were last applied to the spi and only
+ * reconfigures it when the next device to be selected uses different
+ * settings.
+ */
+class spi_bus
+{
+public:
+  /**
+   * @brief Construct a new spi bus
+   *
+   * @param p_spi - spi to share between devices
+   */
+  explicit spi_bus(hal::spi& p_spi)
+    : m_spi(&p_spi)
+  {
+  }
+
+  spi_bus(const spi_bus&) = delete;
+  spi_bus& operator=(const spi_bus&) = delete;
+  spi_bus(spi_bus&&) = delete;
+  spi_bus& operator=(spi_bus&&) = delete;
+
+  /**
+   * @brief Execute a queue of transfers back to back
+   *
+   * Each transfer is framed by its device's chip select unless it requests
+   * to keep the device selected for the following transfer. The chip select
+   * of the last selected device is always released before returning.
+   *
+   * @param p_queue - transfers to perform in order
+   * @return status - success or failure. On failure the remaining transfers
+   * in the queue are not performed.
+   */
+  [[nodiscard]] status execute(
+    std::span<const spi_transfer_descriptor> p_queue);
+
+private:
+  friend class spi_device;
+
+  status select(hal::output_pin& p_chip_select,
+                const spi::settings& p_settings)
+  {
+    // Stay within the current frame only if the bus does not need to be
+    // reconfigured, which must not happen while a device is selected
+    if (m_selected == &p_chip_select && m_applied_settings == p_settings) {
+      return success();
+    }
+    HAL_CHECK(deselect());
+    if (m_applied_settings != p_settings) {
+      HAL_CHECK(m_spi->configure(p_settings));
+      m_applied_settings = p_settings;
+    }
+    HAL_CHECK(p_chip_select.level(false));
+    m_selected = &p_chip_select;
+    return success();
+  }
+
+  status deselect()
+  {
+    if (m_selected == nullptr) {
+      return success();
+    }
+    auto* chip_select = m_selected;
+    m_selected = nullptr;
+    HAL_CHECK(chip_select->level(true));
+    return success();
+  }
+
+  hal::spi* m_spi;
+  hal::output_pin* m_selected = nullptr;
+  std::optional<spi::settings> m_applied_settings{};
+};
+
+/**
+ * @brief An spi device on a shared bus with its own chip select and settings
+ *
+ * Implements `hal::spi`, so drivers can use it without toggling a chip
+ * select pin around each transfer. Each transfer is framed by the device's
+ * active LOW chip select. Settings passed to `configure()` are stored and
+ * applied to the bus when the device is next selected, so any error applying
+ * them is reported by that transfer.
+ */
+class spi_device : public hal::spi
+{
+public:
+  /**
+   * @brief Create a new spi device
+   *
+   * Drives the chip select pin HIGH so the device starts deselected.
+   *
+   * @param p_bus - bus the device is on
+   * @param p_chip_select - active LOW chip select pin of the device
+   * @param p_settings - settings to use when communicating with the device
+   * @return result<spi_device> - the device or an error
+   */
+  static result<spi_device> create(spi_bus& p_bus,
+                                   hal::output_pin& p_chip_select,
+                                   const settings& p_settings = {})
+  {
+    HAL_CHECK(p_chip_select.level(true));
+    return spi_device(p_bus, p_chip_select, p_settings);
+  }
+
+  /**
+   * @brief Get the settings used when communicating with the device
+   *
+   * @return const settings& - settings of this device
+   */
+  [[nodiscard]] const settings& device_settings() const
+  {
+    return m_settings;
+  }
+
+  /**
+   * @brief Perform several transfers within a single chip select frame
+   *
+   * Selects the device, calls p_transfer with the bus's spi and then
+   * deselects the device, even if p_transfer failed. Use this when later
+   * transfers in a frame depend on data read earlier in it, for example to
+   * poll a status register. The spi must not be used after p_transfer
+   * returns.
+   *
+   * @param p_transfer - callable taking a `hal::spi&` and returning a status
+   * or result
+   * @return status - success or failure
+   */
+  [[nodiscard]] status within_frame(auto p_transfer)
+  {
+    auto transfer_result = [&]() -> status {
+      HAL_CHECK(m_bus->select(*m_chip_select, m_settings));
+      HAL_CHECK(p_transfer(*m_bus->m_spi));
+      return success();
+    }();
+    auto deselect_result = m_bus->deselect();
+    HAL_CHECK(transfer_result);
+    HAL_CHECK(deselect_result);
+    return success();
+  }
+
+private:
+  friend class spi_bus;
+
+  spi_device(spi_bus& p_bus,
+             hal::output_pin& p_chip_select,
+             const settings& p_settings)
+    : m_bus(&p_bus)
+    , m_chip_select(&p_chip_select)
+    , m_settings(p_settings)
+  {
+  }
+
+  status driver_configure(const settings& p_settings) override
+  {
+    m_settings = p_settings;
+    return success();
+  }
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte> p_data_out,
+                                     std::span<hal::byte> p_data_in,
+                                     hal::byte p_filler) override
+  {
+    const std::array<spi_transfer_descriptor, 1> queue{
+      spi_transfer_descriptor{ .device = this,
+                               .data_out = p_data_out,
+                               .data_in = p_data_in,
+                               .filler = p_filler },
+    };
+    HAL_CHECK(m_bus->execute(queue));
+    return transfer_t{};
+  }
+
+  // The overrides below perform the whole operation within a single chip
+  // select frame, which the default implementations would split into one
+  // frame per segment or chunk.
+
+  result<transfer_t> driver_transfer_segments(
+    std::span<const transfer_segment> p_segments,
+    hal::byte p_filler) override
+  {
+    HAL_CHECK(within_frame(
+      [&](hal::spi& p_spi) { return p_spi.transfer(p_segments, p_filler); }));
+    return transfer_t{};
+  }
+
+  result<transfer_t> driver_transfer_in_place(
+    std::span<hal::byte> p_data) override
+  {
+    HAL_CHECK(within_frame(
+      [&](hal::spi& p_spi) { return p_spi.transfer_in_place(p_data); }));
+    return transfer_t{};
+  }
+
+  spi_bus* m_bus;
+  hal::output_pin* m_chip_select;
+  settings m_settings;
+};
+
+inline status spi_bus::execute(std::span<const spi_transfer_descriptor> p_queue)
+{
+  for (std::size_t i = 0; i < p_queue.size(); i++) {
+    const auto& descriptor = p_queue[i];
+    auto& device = *descriptor.device;
+
+    auto transfer_result = [&]() -> status {
+      HAL_CHECK(select(*device.m_chip_select, device.m_settings));
+      HAL_CHECK(m_spi->transfer(
+        descriptor.data_out, descriptor.data_in, descriptor.filler));
+      return success();
+    }();
+
+    if (!transfer_result) {
+      (void)deselect();
+      return transfer_result;
+    }
+
+    const bool next_shares_chip_select =
+      i + 1 < p_queue.size() &&
+      p_queue[i + 1].device->m_chip_select == device.m_chip_select;
+    if (!descriptor.keep_selected || !next_shares_chip_select) {
+      HAL_CHECK(deselect());
+    }
+  }
+  return success();
+}
+}  // namespace hal
@@ -0,0 +1,395 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+#include "error.hpp"
+#include "functional.hpp"
+#include "spi.hpp"
+#include "spi_device.hpp"
+#include "timeout.hpp"
+#include "units.hpp"
+
+namespace hal {
+/**
+ * @brief Driver for JEDEC compatible spi NOR flash memories
+ *
+ * Supports the common command set shared by most serial NOR flash devices
+ * with 24-bit addressing (up to 16 MiB).
+ *
+ * Program and erase operations return as soon as the command has been sent.
+ * Waiting for the device to finish is deferred until the next operation
+ * needs the device, so the caller can prepare the next data while the flash
+ * is busy. Call `wait()` to block until the last operation has finished.
+ * When waiting, the status register is read continuously within a single
+ * chip select frame rather than re-issuing the status command for each
+ * poll.
+ *
+ * The flash is accessed through a `hal::spi_device`, which owns the chip
+ * select and the bus settings of the flash.
+ *
+ * As with any NOR flash, programming can only change bits from 1 to 0. The
+ * region written must have been erased beforehand.
+ */
+class spi_flash
+{
+public:
+  /// JEDEC command opcodes used by the driver
+  struct command
+  {
+    static constexpr hal::byte write_enable = 0x06;
+    static constexpr hal::byte read_status = 0x05;
+    static constexpr hal::byte page_program = 0x02;
+    static constexpr hal::byte read = 0x03;
+    static constexpr hal::byte fast_read = 0x0B;
+    static constexpr hal::byte sector_erase = 0x20;
+    static constexpr hal::byte block_erase = 0xD8;
+    static constexpr hal::byte chip_erase = 0xC7;
+    static constexpr hal::byte read_jedec_id = 0x9F;
+  };
+
+  /// Status register bit set while a program or erase is in progress
+  static constexpr hal::byte status_busy = 1 << 0;
+  /// Status register bit set while writes are enabled
+  static constexpr hal::byte status_write_enabled = 1 << 1;
+
+  /**
+   * @brief Geometry of the flash memory
+   *
+   */
+  struct settings
+  {
+    /// Largest number of bytes a single page program can write
+    std::uint32_t page_size = 256;
+    /// Size of the region erased by `erase_sector()`
+    std::uint32_t sector_size = 4 * 1024;
+    /// Size of the region erased by `erase_block()`
+    std::uint32_t block_size = 64 * 1024;
+  };
+
+  /**
+   * @brief Manufacturer and device identification
+   *
+   */
+  struct jedec_id_t
+  {
+    hal::byte manufacturer;
+    hal::byte memory_type;
+    /// Capacity of the memory as a power of 2 in bytes
+    hal::byte capacity;
+  };
+
+  /**
+   * @brief Create a new spi flash driver
+   *
+   * Reads the JEDEC id of the device to determine its capacity.
+   *
+   * @param p_device - spi device of the flash
+   * @param p_settings - geometry of the flash memory
+   * @return result<spi_flash> - the flash driver
+   * @throws std::errc::invalid_argument - if the page size is 0
+   * @throws std::errc::no_such_device - if no device responded
+   * @throws std::errc::not_supported - if the capacity of the device cannot
+   * be addressed with 24-bit addresses
+   */
+  [[nodiscard]] static result<spi_flash> create(hal::spi_device& p_device,
+                                                const settings& p_settings)
+  {
+    if (p_settings.page_size == 0) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    spi_flash flash(p_device, p_settings);
+
+    const std::array<hal::byte, 1> id_command{ command::read_jedec_id };
+    std::array<hal::byte, 3> id{};
+    HAL_CHECK(flash.frame(id_command, std::span<const hal::byte>{}, id));
+    flash.m_id = jedec_id_t{
+      .manufacturer = id[0],
+      .memory_type = id[1],
+      .capacity = id[2],
+    };
+
+    if (id[0] == 0x00 || id[0] == 0xFF) {
+      return hal::new_error(std::errc::no_such_device);
+    }
+    if (id[2] > 24 || (1UL << id[2]) < p_settings.block_size) {
+      return hal::new_error(std::errc::not_supported);
+    }
+    return flash;
+  }
+
+  /**
+   * @brief Create a new spi flash driver with the most common geometry
+   *
+   * @param p_device - spi device of the flash
+   * @return result<spi_flash> - the flash driver
+   */
+  [[nodiscard]] static result<spi_flash> create(hal::spi_device& p_device)
+  {
+    return create(p_device, settings{});
+  }
+
+  /**
+   * @brief Get the JEDEC id read from the device
+   *
+   * @return jedec_id_t - manufacturer and device identification
+   */
+  [[nodiscard]] jedec_id_t id() const
+  {
+    return m_id;
+  }
+
+  /**
+   * @brief Get the capacity of the device
+   *
+   * @return std::uint32_t - capacity in bytes
+   */
+  [[nodiscard]] std::uint32_t capacity() const
+  {
+    return std::uint32_t{ 1 } << m_id.capacity;
+  }
+
+  /**
+   * @brief Read data from the flash
+   *
+   * Uses the fast read command and reads straight into p_data within a
+   * single chip select frame.
+   *
+   * @param p_address - address of the first byte to read
+   * @param p_data - buffer to fill with data from the flash
+   * @param p_timeout - timeout for waiting on a previous program or erase
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument - if the range is outside the flash
+   */
+  [[nodiscard]] status read(std::uint32_t p_address,
+                            std::span<hal::byte> p_data,
+                            hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(check_range(p_address, p_data.size()));
+    HAL_CHECK(wait(p_timeout));
+    const auto header = address_command<5>(command::fast_read, p_address);
+    HAL_CHECK(frame(header, std::span<const hal::byte>{}, p_data));
+    return success();
+  }
+
+  /**
+   * @brief Write data to the flash
+   *
+   * The data is split at page boundaries into page program operations.
+   * Returns once the last page program has been started.
+   *
+   * @param p_address - address of the first byte to write
+   * @param p_data - data to write, of any length
+   * @param p_timeout - timeout for waiting on each previous operation
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument - if the range is outside the flash
+   */
+  [[nodiscard]] status write(std::uint32_t p_address,
+                             std::span<const hal::byte> p_data,
+                             hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(check_range(p_address, p_data.size()));
+    while (!p_data.empty()) {
+      const auto page_remaining =
+        m_settings.page_size - (p_address % m_settings.page_size);
+      const auto length =
+        std::min(p_data.size(), static_cast<std::size_t>(page_remaining));
+
+      HAL_CHECK(start_write(p_timeout));
+      const auto header = address_command<4>(command::page_program, p_address);
+      HAL_CHECK(frame(header, p_data.first(length), std::span<hal::byte>{}));
+      m_busy = true;
+
+      p_address += static_cast<std::uint32_t>(length);
+      p_data = p_data.subspan(length);
+    }
+    return success();
+  }
+
+  /**
+   * @brief Erase the sector containing an address
+   *
+   * Returns once the erase has been started.
+   *
+   * @param p_address - any address within the sector
+   * @param p_timeout - timeout for waiting on a previous operation
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument - if the address is outside the flash
+   */
+  [[nodiscard]] status erase_sector(
+    std::uint32_t p_address,
+    hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    return erase(command::sector_erase, p_address, p_timeout);
+  }
+
+  /**
+   * @brief Erase the block containing an address
+   *
+   * Returns once the erase has been started.
+   *
+   * @param p_address - any address within the block
+   * @param p_timeout - timeout for waiting on a previous operation
+   * @return status - success or failure
+   * @throws std::errc::invalid_argument - if the address is outside the flash
+   */
+  [[nodiscard]] status erase_block(
+    std::uint32_t p_address,
+    hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    return erase(command::block_erase, p_address, p_timeout);
+  }
+
+  /**
+   * @brief Erase the whole flash
+   *
+   * Returns once the erase has been started.
+   *
+   * @param p_timeout - timeout for waiting on a previous operation
+   * @return status - success or failure
+   */
+  [[nodiscard]] status erase_chip(
+    hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(start_write(p_timeout));
+    const std::array<hal::byte, 1> erase_command{ command::chip_erase };
+    HAL_CHECK(frame(
+      erase_command, std::span<const hal::byte>{}, std::span<hal::byte>{}));
+    m_busy = true;
+    return success();
+  }
+
+  /**
+   * @brief Wait for the last program or erase operation to finish
+   *
+   * @param p_timeout - timeout for the wait
+   * @return status - success or failure
+   */
+  [[nodiscard]] status wait(hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    if (!m_busy) {
+      return success();
+    }
+
+    HAL_CHECK(m_device->within_frame([&p_timeout](hal::spi& p_spi) -> status {
+      const std::array<hal::byte, 1> status_command{ command::read_status };
+      HAL_CHECK(p_spi.transfer(status_command, std::span<hal::byte>{}));
+      std::array<hal::byte, 1> status_register{};
+      while (true) {
+        HAL_CHECK(
+          p_spi.transfer(std::span<const hal::byte>{}, status_register));
+        if ((status_register[0] & status_busy) == 0) {
+          return success();
+        }
+        HAL_CHECK(p_timeout());
+      }
+    }));
+
+    m_busy = false;
+    return success();
+  }
+
+  /**
+   * @brief Determine if a program or erase may still be in progress
+   *
+   * @return true - if `wait()` has not been called since the last program or
+   * erase was started
+   */
+  [[nodiscard]] bool pending() const
+  {
+    return m_busy;
+  }
+
+private:
+  spi_flash(hal::spi_device& p_device, const settings& p_settings)
+    : m_device(&p_device)
+    , m_settings(p_settings)
+  {
+  }
+
+  template<std::size_t Length>
+  static std::array<hal::byte, Length> address_command(hal::byte p_command,
+                                                       std::uint32_t p_address)
+  {
+    // Any bytes after the address are dummy bytes
+    std::array<hal::byte, Length> header{};
+    header[0] = p_command;
+    header[1] = static_cast<hal::byte>(p_address >> 16);
+    header[2] = static_cast<hal::byte>(p_address >> 8);
+    header[3] = static_cast<hal::byte>(p_address);
+    return header;
+  }
+
+  status check_range(std::uint32_t p_address, std::size_t p_length) const
+  {
+    if (p_address > capacity() || p_length > capacity() - p_address) {
+      return hal::new_error(std::errc::invalid_argument);
+    }
+    return success();
+  }
+
+  status start_write(hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(wait(p_timeout));
+    const std::array<hal::byte, 1> enable{ command::write_enable };
+    HAL_CHECK(
+      frame(enable, std::span<const hal::byte>{}, std::span<hal::byte>{}));
+    return success();
+  }
+
+  status erase(hal::byte p_command,
+               std::uint32_t p_address,
+               hal::function_ref<hal::timeout_function> p_timeout)
+  {
+    HAL_CHECK(check_range(p_address, 1));
+    HAL_CHECK(start_write(p_timeout));
+    const auto header = address_command<4>(p_command, p_address);
+    HAL_CHECK(
+      frame(header, std::span<const hal::byte>{}, std::span<hal::byte>{}));
+    m_busy = true;
+    return success();
+  }
+
+  /**
+   * @brief Send a command header followed by a write or read data phase in a
+   * single chip select frame
+   *
+   */
+  status frame(std::span<const hal::byte> p_header,
+               std::span<const hal::byte> p_data_out,
+               std::span<hal::byte> p_data_in)
+  {
+    const std::array<spi::transfer_segment, 3> segments{
+      spi::transfer_segment{ .data_out = p_header },
+      spi::transfer_segment{ .data_out = p_data_out },
+      spi::transfer_segment{ .data_in = p_data_in },
+    };
+    // spi_device transfers a list of segments within one chip select frame
+    HAL_CHECK(m_device->transfer(segments));
+    return success();
+  }
+
+  hal::spi_device* m_device;
+  settings m_settings;
+  jedec_id_t m_id{};
+  bool m_busy = false;
+};
+}  // namespace hal
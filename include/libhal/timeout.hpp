@@ -117,6 +117,43 @@ concept worker = std::convertible_to<T, hal::function_ref<work_function>>;
   return {};
 }
 
+/**
+ * @ingroup TimeoutCore
+ * @brief Determine if a work_state is a terminal state
+ *
+ * @param p_state - the work state to check
+ * @return true - if the state is either finished or failed
+ * @return false - if the work is still in progress
+ */
+[[nodiscard]] constexpr bool terminated(work_state p_state)
+{
+  return p_state == work_state::finished || p_state == work_state::failed;
+}
+
+/**
+ * @ingroup TimeoutCore
+ * @brief Repeatedly call a worker until it reaches a terminal state or the
+ * timeout expires.
+ *
+ * @param p_worker - worker function to call repeatedly
+ * @param p_timeout - callable timeout object checked between each call to the
+ * worker.
+ * @return result<work_state> - the terminal state of the worker
+ * @throws std::errc::timed_out - if p_timeout expired before the worker
+ * reached a terminal state. Errors from the worker are also propagated.
+ */
+[[nodiscard]] inline result<work_state> try_until(worker auto& p_worker,
+                                                  timeout auto p_timeout)
+{
+  while (true) {
+    auto state = HAL_CHECK(p_worker());
+    if (hal::terminated(state)) {
+      return state;
+    }
+    HAL_CHECK(p_timeout());
+  }
+}
+
 /**
  * @ingroup TimeoutCore
  * @brief Create a timeout that will never time out
@@ -0,0 +1,814 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file trace.hpp
+ * @brief Record bus activity into a ring buffer and export it for viewing in
+ * a trace viewer.
+ *
+ * The `traced_*` decorators wrap an i2c, spi, serial or can driver and record
+ * a `hal::trace_event` per operation into a `hal::trace_buffer`. Nothing is
+ * allocated, the events are stored in caller supplied memory.
+ *
+ * Each decorator takes a bool template parameter that enables it. The
+ * disabled specialisations only hold the wrapped driver and are constructed
+ * from it alone, so no trace buffer, event storage or clock has to exist.
+ * Their `get()` returns the wrapped driver, so callers talk to the hardware
+ * directly. Drivers take the bus from `get()` in both cases:
+ *
+ *     #if defined(APP_TRACING)
+ *     hal::trace_buffer buffer(events, clock);
+ *     hal::traced_i2c<true> traced(i2c, buffer);
+ *     #else
+ *     hal::traced_i2c<false> traced(i2c);
+ *     #endif
+ *     auto sensor = sensor::create(traced.get());
+ *
+ * The events can be copied out with `trace_buffer::dump()`, sent to a host
+ * as raw bytes and converted to the Chrome trace event JSON format with
+ * `hal::write_chrome_trace()` for viewing in chrome://tracing or Perfetto.
+ */
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#include "can.hpp"
+#include "error.hpp"
+#include "functional.hpp"
+#include "i2c.hpp"
+#include "serial.hpp"
+#include "spi.hpp"
+#include "steady_clock.hpp"
+#include "timeout.hpp"
+#include "units.hpp"
+
+namespace hal {
+/// Event error value used for errors that are not a `std::errc`
+constexpr hal::byte trace_unknown_error = 0xFF;
+
+/**
+ * @brief Kind of operation recorded in a trace event
+ *
+ */
+enum class trace_operation : hal::byte
+{
+  i2c_transaction,
+  spi_transfer,
+  serial_write,
+  serial_read,
+  serial_flush,
+  can_send,
+  can_receive,
+  user,
+};
+
+/**
+ * @brief Get a printable name for a trace operation
+ *
+ * @param p_operation - the operation
+ * @return std::string_view - name of the operation
+ */
+[[nodiscard]] constexpr std::string_view to_string(
+  trace_operation p_operation)
+{
+  switch (p_operation) {
+    case trace_operation::i2c_transaction:
+      return "i2c_transaction";
+    case trace_operation::spi_transfer:
+      return "spi_transfer";
+    case trace_operation::serial_write:
+      return "serial_write";
+    case trace_operation::serial_read:
+      return "serial_read";
+    case trace_operation::serial_flush:
+      return "serial_flush";
+    case trace_operation::can_send:
+      return "can_send";
+    case trace_operation::can_receive:
+      return "can_receive";
+    default:
+      return "user";
+  }
+}
+
+/**
+ * @brief A single recorded operation
+ *
+ * Plain data with a fixed layout, so events can be transferred to a host as
+ * raw bytes.
+ */
+struct trace_event
+{
+  /// Steady clock ticks when the operation started
+  std::uint64_t start = 0;
+  /// Steady clock ticks when the operation ended
+  std::uint64_t end = 0;
+  /// Number of bytes moved, 0 if the operation failed
+  std::uint32_t bytes = 0;
+  /// Kind of operation
+  trace_operation operation = trace_operation::user;
+  /// Caller assigned number to tell buses apart
+  hal::byte channel = 0;
+  /// 0 on success, otherwise the `std::errc` value or `trace_unknown_error`
+  hal::byte error = 0;
+};
+
+/**
+ * @brief Fixed size ring buffer of trace events
+ *
+ * When full, the oldest event is overwritten by the newest. The buffer holds
+ * the clock used to timestamp events, so all events in a buffer share the
+ * same time base. Not safe to record into from multiple threads or from
+ * interrupts that preempt each other.
+ */
+class trace_buffer
+{
+public:
+  /**
+   * @brief Construct a new trace buffer
+   *
+   * @param p_events - storage for the events
+   * @param p_clock - steady clock used to timestamp the events
+   */
+  trace_buffer(std::span<trace_event> p_events, hal::steady_clock& p_clock)
+    : m_events(p_events)
+    , m_clock(&p_clock)
+  {
+  }
+
+  /**
+   * @brief Append an event, overwriting the oldest event if full
+   *
+   * @param p_event - event to append
+   */
+  void record(const trace_event& p_event)
+  {
+    if (m_events.empty()) {
+      m_dropped++;
+      return;
+    }
+    if (m_size == m_events.size()) {
+      m_dropped++;
+    } else {
+      m_size++;
+    }
+    m_events[m_next] = p_event;
+    m_next = (m_next + 1) % m_events.size();
+  }
+
+  /**
+   * @brief Call a function and record its duration and outcome
+   *
+   * @param p_operation - kind of operation to record
+   * @param p_channel - channel to record
+   * @param p_call - function returning a `hal::result`
+   * @param p_bytes_moved - function returning the number of bytes moved, given
+   * the value of a successful result
+   * @return the result of p_call
+   */
+  template<class Call, class BytesMoved>
+  auto trace(trace_operation p_operation,
+             hal::byte p_channel,
+             Call&& p_call,
+             BytesMoved&& p_bytes_moved) -> decltype(p_call())
+  {
+    using result_t = decltype(p_call());
+    trace_event event{
+      .start = m_clock->uptime().ticks,
+      .operation = p_operation,
+      .channel = p_channel,
+    };
+
+    result_t call_result = capture_error(event, p_call);
+    event.end = m_clock->uptime().ticks;
+    if (call_result) {
+      const auto bytes = p_bytes_moved(call_result.value());
+      event.bytes = static_cast<std::uint32_t>(bytes);
+    }
+    record(event);
+    return call_result;
+  }
+
+  /**
+   * @brief Call a function and store the error it fails with in an event
+   *
+   * For operations that span several calls and are recorded once they
+   * complete, such as non-blocking transactions.
+   *
+   * @param p_event - event whose error is set if p_call fails
+   * @param p_call - function returning a `hal::result`
+   * @return the result of p_call
+   */
+  template<class Call>
+  static auto capture_error(trace_event& p_event, Call&& p_call)
+    -> decltype(p_call())
+  {
+    using result_t = decltype(p_call());
+    result_t call_result = hal::attempt(
+      [&p_call]() -> result_t { return p_call(); },
+      [&p_event](std::errc p_errc) -> result_t {
+        p_event.error = static_cast<hal::byte>(p_errc);
+        return hal::new_error(p_errc);
+      });
+    if (!call_result && p_event.error == 0) {
+      p_event.error = trace_unknown_error;
+    }
+    return call_result;
+  }
+
+  /**
+   * @brief Get the number of events held
+   *
+   * @return std::size_t - number of events, at most the storage size
+   */
+  [[nodiscard]] std::size_t size() const
+  {
+    return m_size;
+  }
+
+  /**
+   * @brief Get an event, 0 being the oldest held
+   *
+   * @param p_index - index of the event, must be less than `size()`
+   * @return const trace_event& - the event
+   */
+  [[nodiscard]] const trace_event& operator[](std::size_t p_index) const
+  {
+    const auto oldest = m_next + m_events.size() - m_size;
+    return m_events[(oldest + p_index) % m_events.size()];
+  }
+
+  /**
+   * @brief Get the number of events overwritten or not stored
+   *
+   * @return std::uint32_t - number of events lost
+   */
+  [[nodiscard]] std::uint32_t dropped() const
+  {
+    return m_dropped;
+  }
+
+  /**
+   * @brief Copy the events held, oldest first
+   *
+   * @param p_destination - buffer to copy the events into
+   * @return std::span<trace_event> - the portion of p_destination filled
+   */
+  std::span<trace_event> dump(std::span<trace_event> p_destination) const
+  {
+    const auto count = std::min(m_size, p_destination.size());
+    for (std::size_t i = 0; i < count; i++) {
+      p_destination[i] = (*this)[i];
+    }
+    return p_destination.first(count);
+  }
+
+  /**
+   * @brief Get the clock used to timestamp events
+   *
+   * @return hal::steady_clock& - the clock
+   */
+  [[nodiscard]] hal::steady_clock& clock()
+  {
+    return *m_clock;
+  }
+
+  /**
+   * @brief Discard all events and reset the dropped count
+   *
+   */
+  void clear()
+  {
+    m_size = 0;
+    m_next = 0;
+    m_dropped = 0;
+  }
+
+private:
+  std::span<trace_event> m_events;
+  hal::steady_clock* m_clock;
+  std::size_t m_size = 0;
+  std::size_t m_next = 0;
+  std::uint32_t m_dropped = 0;
+};
+
+/**
+ * @brief Write events in the Chrome trace event JSON format
+ *
+ * Each event becomes a complete ("X") event named after its operation, with
+ * the channel as the thread id and the bytes and error as arguments. The JSON
+ * is produced in small pieces passed to p_sink, so this can run on the device
+ * to stream over a serial port or on a host from a dump of the events.
+ *
+ * @param p_events - events to write, typically from `trace_buffer::dump()`
+ * @param p_tick_frequency - frequency of the clock that timestamped the
+ * events
+ * @param p_sink - called with each piece of the JSON text, in order
+ */
+inline void write_chrome_trace(
+  std::span<const trace_event> p_events,
+  hertz p_tick_frequency,
+  hal::function_ref<void(std::string_view)> p_sink)
+{
+  const double microseconds_per_tick = 1.0e6 / p_tick_frequency;
+
+  auto write_number = [&p_sink](auto p_value) {
+    char buffer[32];
+    std::to_chars_result number{};
+    if constexpr (std::is_floating_point_v<decltype(p_value)>) {
+      number = std::to_chars(
+        buffer, buffer + sizeof(buffer), p_value, std::chars_format::fixed, 3);
+    } else {
+      number = std::to_chars(buffer, buffer + sizeof(buffer), p_value);
+    }
+    p_sink(std::string_view(buffer, number.ptr));
+  };
+
+  p_sink(R"({"traceEvents":[)");
+  for (std::size_t i = 0; i < p_events.size(); i++) {
+    const auto& event = p_events[i];
+    const auto duration = event.end - event.start;
+
+    p_sink(i == 0 ? R"({"name":")" : R"(,{"name":")");
+    p_sink(to_string(event.operation));
+    p_sink(R"(","cat":"hal","ph":"X","pid":0,"tid":)");
+    write_number(static_cast<unsigned>(event.channel));
+    p_sink(R"(,"ts":)");
+    write_number(static_cast<double>(event.start) * microseconds_per_tick);
+    p_sink(R"(,"dur":)");
+    write_number(static_cast<double>(duration) * microseconds_per_tick);
+    p_sink(R"(,"args":{"bytes":)");
+    write_number(event.bytes);
+    p_sink(R"(,"error":)");
+    write_number(static_cast<unsigned>(event.error));
+    p_sink("}}");
+  }
+  p_sink(R"(],"displayTimeUnit":"ns"})");
+}
+
+/**
+ * @brief i2c decorator that traces every transaction
+ *
+ * A transaction list is forwarded as a list, so the wrapped i2c keeps its
+ * batching, and is recorded as a single event. A non-blocking transaction is
+ * recorded once `transaction_state()` reports that it has ended, spanning
+ * from its start to that call.
+ *
+ * @tparam Enabled - when false, see `traced_i2c<false>`
+ */
+template<bool Enabled = true>
+class traced_i2c : public hal::i2c
+{
+public:
+  /**
+   * @brief Construct a new traced i2c
+   *
+   * @param p_i2c - i2c bus to forward transactions to
+   * @param p_buffer - buffer to record events into
+   * @param p_channel - channel number recorded with each event
+   */
+  traced_i2c(hal::i2c& p_i2c, trace_buffer& p_buffer, hal::byte p_channel = 0)
+    : m_i2c(&p_i2c)
+    , m_buffer(&p_buffer)
+    , m_channel(p_channel)
+  {
+  }
+
+  /**
+   * @brief Get the i2c that drivers should use
+   *
+   * @return hal::i2c& - this decorator
+   */
+  [[nodiscard]] hal::i2c& get()
+  {
+    return *this;
+  }
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    return m_i2c->configure(p_settings);
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    return m_buffer->trace(
+      trace_operation::i2c_transaction,
+      m_channel,
+      [&]() {
+        return m_i2c->transaction(p_address, p_data_out, p_data_in, p_timeout);
+      },
+      [&](const transaction_t&) {
+        return p_data_out.size() + p_data_in.size();
+      });
+  }
+
+  result<transaction_t> driver_transactions(
+    std::span<const transaction_descriptor> p_transactions,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    return m_buffer->trace(
+      trace_operation::i2c_transaction,
+      m_channel,
+      [&]() { return m_i2c->transactions(p_transactions, p_timeout); },
+      [&](const transaction_t&) {
+        std::size_t bytes = 0;
+        for (const auto& transaction : p_transactions) {
+          bytes += transaction.data_out.size() + transaction.data_in.size();
+        }
+        return bytes;
+      });
+  }
+
+  status driver_start_transaction(hal::byte p_address,
+                                  std::span<const hal::byte> p_data_out,
+                                  std::span<hal::byte> p_data_in) override
+  {
+    trace_event event{
+      .start = m_buffer->clock().uptime().ticks,
+      .operation = trace_operation::i2c_transaction,
+      .channel = m_channel,
+    };
+    auto start_result = trace_buffer::capture_error(event, [&]() {
+      return m_i2c->start_transaction(p_address, p_data_out, p_data_in);
+    });
+    if (!start_result) {
+      event.end = m_buffer->clock().uptime().ticks;
+      m_buffer->record(event);
+      return start_result;
+    }
+    m_pending = event;
+    m_pending_bytes = p_data_out.size() + p_data_in.size();
+    return success();
+  }
+
+  result<work_state> driver_transaction_state() override
+  {
+    trace_event event = m_pending.value_or(trace_event{});
+    auto state_result = trace_buffer::capture_error(
+      event, [this]() { return m_i2c->transaction_state(); });
+
+    if (m_pending && (!state_result || hal::terminated(state_result.value()))) {
+      event.end = m_buffer->clock().uptime().ticks;
+      if (state_result && state_result.value() == work_state::finished) {
+        event.bytes = static_cast<std::uint32_t>(m_pending_bytes);
+      } else if (event.error == 0) {
+        event.error = trace_unknown_error;
+      }
+      m_buffer->record(event);
+      m_pending.reset();
+    }
+    return state_result;
+  }
+
+  hal::i2c* m_i2c;
+  trace_buffer* m_buffer;
+  std::optional<trace_event> m_pending{};
+  std::size_t m_pending_bytes = 0;
+  hal::byte m_channel;
+};
+
+/**
+ * @brief spi decorator that traces every transfer
+ *
+ * Scatter-gather and in-place transfers are forwarded as such, so the wrapped
+ * spi keeps its framing, and are each recorded as a single event.
+ *
+ * @tparam Enabled - when false, see `traced_spi<false>`
+ */
+template<bool Enabled = true>
+class traced_spi : public hal::spi
+{
+public:
+  /**
+   * @brief Construct a new traced spi
+   *
+   * @param p_spi - spi bus to forward transfers to
+   * @param p_buffer - buffer to record events into
+   * @param p_channel - channel number recorded with each event
+   */
+  traced_spi(hal::spi& p_spi, trace_buffer& p_buffer, hal::byte p_channel = 0)
+    : m_spi(&p_spi)
+    , m_buffer(&p_buffer)
+    , m_channel(p_channel)
+  {
+  }
+
+  /**
+   * @brief Get the spi that drivers should use
+   *
+   * @return hal::spi& - this decorator
+   */
+  [[nodiscard]] hal::spi& get()
+  {
+    return *this;
+  }
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    return m_spi->configure(p_settings);
+  }
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte> p_data_out,
+                                     std::span<hal::byte> p_data_in,
+                                     hal::byte p_filler) override
+  {
+    const auto length = std::max(p_data_out.size(), p_data_in.size());
+    return traced(length, [&]() {
+      return m_spi->transfer(p_data_out, p_data_in, p_filler);
+    });
+  }
+
+  result<transfer_t> driver_transfer_segments(
+    std::span<const transfer_segment> p_segments,
+    hal::byte p_filler) override
+  {
+    std::size_t length = 0;
+    for (const auto& segment : p_segments) {
+      length += std::max(segment.data_out.size(), segment.data_in.size());
+    }
+    return traced(length,
+                  [&]() { return m_spi->transfer(p_segments, p_filler); });
+  }
+
+  result<transfer_t> driver_transfer_in_place(
+    std::span<hal::byte> p_data) override
+  {
+    return traced(p_data.size(),
+                  [&]() { return m_spi->transfer_in_place(p_data); });
+  }
+
+  template<class Transfer>
+  result<transfer_t> traced(std::size_t p_length, Transfer p_transfer)
+  {
+    auto bytes_moved = [p_length](const transfer_t&) { return p_length; };
+    return m_buffer->trace(
+      trace_operation::spi_transfer, m_channel, p_transfer, bytes_moved);
+  }
+
+  hal::spi* m_spi;
+  trace_buffer* m_buffer;
+  hal::byte m_channel;
+};
+
+/**
+ * @brief serial decorator that traces every write, read and flush
+ *
+ * Reads are recorded even when no data was available, with 0 bytes moved.
+ *
+ * @tparam Enabled - when false, see `traced_serial<false>`
+ */
+template<bool Enabled = true>
+class traced_serial : public hal::serial
+{
+public:
+  /**
+   * @brief Construct a new traced serial
+   *
+   * @param p_serial - serial port to forward operations to
+   * @param p_buffer - buffer to record events into
+   * @param p_channel - channel number recorded with each event
+   */
+  traced_serial(hal::serial& p_serial,
+                trace_buffer& p_buffer,
+                hal::byte p_channel = 0)
+    : m_serial(&p_serial)
+    , m_buffer(&p_buffer)
+    , m_channel(p_channel)
+  {
+  }
+
+  /**
+   * @brief Get the serial port that drivers should use
+   *
+   * @return hal::serial& - this decorator
+   */
+  [[nodiscard]] hal::serial& get()
+  {
+    return *this;
+  }
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    return m_serial->configure(p_settings);
+  }
+
+  result<write_t> driver_write(std::span<const hal::byte> p_data) override
+  {
+    return m_buffer->trace(
+      trace_operation::serial_write,
+      m_channel,
+      [&]() { return m_serial->write(p_data); },
+      [](const write_t& p_write) { return p_write.data.size(); });
+  }
+
+  result<read_t> driver_read(std::span<hal::byte> p_data) override
+  {
+    return m_buffer->trace(
+      trace_operation::serial_read,
+      m_channel,
+      [&]() { return m_serial->read(p_data); },
+      [](const read_t& p_read) { return p_read.data.size(); });
+  }
+
+  result<flush_t> driver_flush() override
+  {
+    return m_buffer->trace(
+      trace_operation::serial_flush,
+      m_channel,
+      [&]() { return m_serial->flush(); },
+      [](const flush_t&) { return 0U; });
+  }
+
+  hal::serial* m_serial;
+  trace_buffer* m_buffer;
+  hal::byte m_channel;
+};
+
+/**
+ * @brief can decorator that traces every message sent and received
+ *
+ * Received messages are recorded as events with no duration, at the time the
+ * receive handler is called.
+ *
+ * @tparam Enabled - when false, see `traced_can<false>`
+ */
+template<bool Enabled = true>
+class traced_can : public hal::can
+{
+public:
+  /**
+   * @brief Construct a new traced can
+   *
+   * @param p_can - can bus to forward operations to
+   * @param p_buffer - buffer to record events into
+   * @param p_channel - channel number recorded with each event
+   */
+  traced_can(hal::can& p_can, trace_buffer& p_buffer, hal::byte p_channel = 0)
+    : m_can(&p_can)
+    , m_buffer(&p_buffer)
+    , m_channel(p_channel)
+  {
+  }
+
+  traced_can(const traced_can&) = delete;
+  traced_can& operator=(const traced_can&) = delete;
+  traced_can(traced_can&&) = delete;
+  traced_can& operator=(traced_can&&) = delete;
+
+  /**
+   * @brief Get the can bus that drivers should use
+   *
+   * @return hal::can& - this decorator
+   */
+  [[nodiscard]] hal::can& get()
+  {
+    return *this;
+  }
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    return m_can->configure(p_settings);
+  }
+
+  status driver_bus_on() override
+  {
+    return m_can->bus_on();
+  }
+
+  result<send_t> driver_send(const message_t& p_message) override
+  {
+    return m_buffer->trace(
+      trace_operation::can_send,
+      m_channel,
+      [&]() { return m_can->send(p_message); },
+      [&](const send_t&) { return p_message.length; });
+  }
+
+  void driver_on_receive(hal::callback<handler> p_handler) override
+  {
+    // The handler is kept here as the callback does not have room for both
+    // it and this decorator.
+    m_handler = p_handler;
+    m_can->on_receive([this](const message_t& p_message) {
+      const auto now = m_buffer->clock().uptime().ticks;
+      m_buffer->record(trace_event{
+        .start = now,
+        .end = now,
+        .bytes = p_message.length,
+        .operation = trace_operation::can_receive,
+        .channel = m_channel,
+      });
+      m_handler(p_message);
+    });
+  }
+
+  hal::can* m_can;
+  trace_buffer* m_buffer;
+  hal::callback<handler> m_handler = [](const message_t&) {};
+  hal::byte m_channel;
+};
+
+/**
+ * @brief Base of the disabled decorators, holds the wrapped driver only
+ *
+ * @tparam Driver - interface of the wrapped driver
+ */
+template<class Driver>
+class trace_bypass
+{
+public:
+  /**
+   * @brief Construct a disabled decorator
+   *
+   * @param p_driver - driver that callers should use directly
+   */
+  explicit trace_bypass(Driver& p_driver)
+    : m_driver(&p_driver)
+  {
+  }
+
+  /**
+   * @brief Get the driver that drivers should use
+   *
+   * @return Driver& - the wrapped driver
+   */
+  [[nodiscard]] Driver& get()
+  {
+    return *m_driver;
+  }
+
+private:
+  Driver* m_driver;
+};
+
+/**
+ * @brief Disabled i2c decorator, `get()` returns the wrapped i2c
+ *
+ */
+template<>
+class traced_i2c<false> : public trace_bypass<hal::i2c>
+{
+public:
+  using trace_bypass::trace_bypass;
+};
+
+/**
+ * @brief Disabled spi decorator, `get()` returns the wrapped spi
+ *
+ */
+template<>
+class traced_spi<false> : public trace_bypass<hal::spi>
+{
+public:
+  using trace_bypass::trace_bypass;
+};
+
+/**
+ * @brief Disabled serial decorator, `get()` returns the wrapped serial
+ *
+ */
+template<>
+class traced_serial<false> : public trace_bypass<hal::serial>
+{
+public:
+  using trace_bypass::trace_bypass;
+};
+
+/**
+ * @brief Disabled can decorator, `get()` returns the wrapped can
+ *
+ */
+template<>
+class traced_can<false> : public trace_bypass<hal::can>
+{
+public:
+  using trace_bypass::trace_bypass;
+};
+}  // namespace hal
@@ -0,0 +1,133 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file waveform.hpp
+ * @brief Compile time generation of one period of a waveform, for playback
+ * through a `hal::dac_stream`.
+ *
+ * Tables are generated with constexpr functions, so they can be placed in
+ * read only memory:
+ *
+ *     static constexpr auto sine = hal::sine_table<64>();
+ *
+ * Samples are `hal::q16` proportions of the dac's output range, so playing
+ * them needs no float arithmetic. Values outside of 0.0 to 1.0 saturate.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+#include "q16.hpp"
+
+namespace hal {
+/**
+ * @brief Generate one period of an arbitrary waveform
+ *
+ * @tparam Length - number of samples in the period
+ * @param p_function - constexpr callable taking the phase, from 0.0 up to but
+ * not including 1.0, and returning the sample for it, from 0.0 to 1.0
+ * @return constexpr std::array<q16, Length> - the samples, rounded to the
+ * nearest q16
+ */
+template<std::size_t Length, class Function>
+[[nodiscard]] constexpr std::array<q16, Length> waveform_table(
+  Function p_function)
+{
+  std::array<q16, Length> table{};
+  for (std::size_t i = 0; i < Length; i++) {
+    const auto phase = static_cast<double>(i) / static_cast<double>(Length);
+    const double value = p_function(phase);
+    if (value > 0.0) {
+      const auto raw = value * static_cast<double>(q16::raw_one) + 0.5;
+      table[i] = value >= 1.0 ? q16::from_raw(q16::raw_one)
+                              : q16::from_raw(static_cast<std::uint32_t>(raw));
+    }
+  }
+  return table;
+}
+
+/**
+ * @brief Sine of an angle, usable in constant expressions
+ *
+ * `std::sin` is not constexpr in C++20. Accurate to within 1e-9 for any
+ * angle.
+ *
+ * @param p_radians - the angle
+ * @return constexpr double - the sine of the angle
+ */
+[[nodiscard]] constexpr double constexpr_sin(double p_radians)
+{
+  constexpr auto pi = std::numbers::pi;
+  // Reduce to [-pi, pi], where the series below converges quickly
+  const auto turns = static_cast<long long>(p_radians / (2.0 * pi));
+  auto x = p_radians - static_cast<double>(turns) * 2.0 * pi;
+  if (x > pi) {
+    x -= 2.0 * pi;
+  } else if (x < -pi) {
+    x += 2.0 * pi;
+  }
+
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 16; n++) {
+    term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+    sum += term;
+  }
+  return sum;
+}
+
+/**
+ * @brief Generate one period of a sine wave
+ *
+ * @tparam Length - number of samples in the period
+ * @param p_amplitude - peak deviation from p_offset
+ * @param p_offset - value at phase 0
+ * @return constexpr std::array<q16, Length> - the samples
+ */
+template<std::size_t Length>
+[[nodiscard]] constexpr std::array<q16, Length> sine_table(
+  double p_amplitude = 0.5,
+  double p_offset = 0.5)
+{
+  return waveform_table<Length>([=](double p_phase) {
+    const auto angle = 2.0 * std::numbers::pi * p_phase;
+    return p_offset + p_amplitude * constexpr_sin(angle);
+  });
+}
+
+/**
+ * @brief Generate one period of a triangle wave
+ *
+ * Rises from p_low at phase 0 to p_high at phase 0.5 and falls back.
+ *
+ * @tparam Length - number of samples in the period
+ * @param p_low - lowest value
+ * @param p_high - highest value
+ * @return constexpr std::array<q16, Length> - the samples
+ */
+template<std::size_t Length>
+[[nodiscard]] constexpr std::array<q16, Length> triangle_table(
+  double p_low = 0.0,
+  double p_high = 1.0)
+{
+  return waveform_table<Length>([=](double p_phase) {
+    const auto rise = p_phase < 0.5 ? p_phase * 2.0 : (1.0 - p_phase) * 2.0;
+    return p_low + (p_high - p_low) * rise;
+  });
+}
+}  // namespace hal
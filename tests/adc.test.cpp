@@ -14,6 +14,8 @@
 
 #include <libhal/adc.hpp>
 
+#include <array>
+
 #include <boost/ut.hpp>
 
 namespace hal {
@@ -37,6 +39,49 @@ private:
     return read_t{ .sample = m_returned_position };
   }
 };
+
+/// 12 bit adc that reads integer codes from its hardware
+class test_raw_adc : public hal::adc
+{
+public:
+  std::uint32_t m_code = 0x800;
+
+private:
+  result<read_t> driver_read() override
+  {
+    return read_t{ .sample = static_cast<float>(m_code) / 4095.0f };
+  }
+
+  result<read_raw_t> driver_read_raw() override
+  {
+    return read_raw_t{ .code = m_code, .resolution = 12 };
+  }
+};
+
+/// adc that captures into a FIFO holding the samples 0.1, 0.2, ... 0.8
+class test_fifo_adc : public hal::adc
+{
+public:
+  std::uint32_t m_overruns = 3;
+
+private:
+  result<read_t> driver_read() override
+  {
+    return read_t{ .sample = 0.0f };
+  }
+
+  result<read_block_t> driver_read_block(std::span<float> p_samples) override
+  {
+    const auto count = std::min(p_samples.size(), std::size_t{ 8 });
+    for (std::size_t i = 0; i < count; i++) {
+      p_samples[i] = static_cast<float>(i + 1) / 10.0f;
+    }
+    const auto dropped = m_overruns;
+    m_overruns = 0;
+    return read_block_t{ .samples = p_samples.first(count),
+                         .dropped = dropped };
+  }
+};
 }  // namespace
 
 void adc_test()
@@ -65,5 +110,90 @@ void adc_test()
     // Verify
     expect(!bool{ result });
   };
+
+  "adc::read_raw() default scales the sample"_test = []() {
+    // Setup
+    test_adc test;
+
+    // Exercise
+    auto result = test.read_raw();
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 16 == result.value().resolution);
+    expect(that % 32768U == result.value().code);
+  };
+
+  "adc::read_raw() default propagates errors"_test = []() {
+    // Setup
+    test_adc test;
+    test.m_return_error_status = true;
+
+    // Exercise
+    auto result = test.read_raw();
+
+    // Verify
+    expect(!bool{ result });
+  };
+
+  "adc::read_raw() returns the driver's code"_test = []() {
+    // Setup
+    test_raw_adc test;
+
+    // Exercise
+    auto result = test.read_raw();
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 12 == result.value().resolution);
+    expect(that % 0x800U == result.value().code);
+  };
+
+  "adc::read_block() default reads each sample"_test = []() {
+    // Setup
+    test_adc test;
+    std::array<float, 4> samples{};
+
+    // Exercise
+    auto result = test.read_block(samples);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 4U == result.value().samples.size());
+    expect(that % 0U == result.value().dropped);
+    expect(that % expected_value == samples[3]);
+  };
+
+  "adc::read_block() default propagates errors"_test = []() {
+    // Setup
+    test_adc test;
+    test.m_return_error_status = true;
+    std::array<float, 4> samples{};
+
+    // Exercise
+    auto result = test.read_block(samples);
+
+    // Verify
+    expect(!bool{ result });
+  };
+
+  "adc::read_block() reports partial blocks and drops"_test = []() {
+    // Setup
+    test_fifo_adc test;
+    std::array<float, 16> samples{};
+
+    // Exercise
+    auto first = test.read_block(samples);
+    auto second = test.read_block(std::span(samples).first(2));
+
+    // Verify
+    expect(bool{ first });
+    expect(bool{ second });
+    expect(that % 8U == first.value().samples.size());
+    expect(that % 3U == first.value().dropped);
+    expect(that % 0.8f == samples[7]);
+    expect(that % 2U == second.value().samples.size());
+    expect(that % 0U == second.value().dropped);
+  };
 }
 }  // namespace hal
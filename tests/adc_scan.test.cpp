@@ -0,0 +1,113 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/adc_scan.hpp>
+
+#include <array>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+class test_adc : public hal::adc
+{
+public:
+  explicit test_adc(float p_sample)
+    : m_sample(p_sample)
+  {
+  }
+
+  float m_sample;
+  bool m_return_error_status = false;
+  int m_reads = 0;
+
+private:
+  result<read_t> driver_read() override
+  {
+    m_reads++;
+    if (m_return_error_status) {
+      return hal::new_error(std::errc::io_error);
+    }
+    return read_t{ .sample = m_sample };
+  }
+};
+}  // namespace
+
+void adc_scan_test()
+{
+  using namespace boost::ut;
+
+  "sequential_adc_scan reads each channel in order"_test = []() {
+    // Setup
+    test_adc phase_a(0.25f);
+    test_adc phase_b(0.5f);
+    test_adc phase_c(0.75f);
+    const std::array<hal::adc*, 3> channels{ &phase_a, &phase_b, &phase_c };
+    sequential_adc_scan scan(channels);
+    std::array<float, 3> samples{};
+
+    // Exercise
+    auto result = scan.read(samples);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 3U == scan.channels());
+    expect(that % 3U == result.value().samples.size());
+    expect(that % 0.25f == samples[0]);
+    expect(that % 0.5f == samples[1]);
+    expect(that % 0.75f == samples[2]);
+    expect(!result.value().timestamp.has_value());
+  };
+
+  "sequential_adc_scan timestamps the scan"_test = []() {
+    // Setup
+    test_adc channel(0.5f);
+    const std::array<hal::adc*, 1> channels{ &channel };
+    test_steady_clock clock;
+    clock.m_ticks = 1234;
+    sequential_adc_scan scan(channels, clock);
+    std::array<float, 1> samples{};
+
+    // Exercise
+    auto result = scan.read(samples);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 1234U == result.value().timestamp.value_or(0));
+  };
+
+  "sequential_adc_scan short buffer and errors"_test = []() {
+    // Setup
+    test_adc first(0.1f);
+    test_adc second(0.2f);
+    const std::array<hal::adc*, 2> channels{ &first, &second };
+    sequential_adc_scan scan(channels);
+    std::array<float, 1> short_buffer{};
+    std::array<float, 2> samples{};
+
+    // Exercise
+    auto short_result = scan.read(short_buffer);
+    second.m_return_error_status = true;
+    auto error_result = scan.read(samples);
+
+    // Verify
+    expect(bool{ short_result });
+    expect(that % 1U == short_result.value().samples.size());
+    expect(that % 1 == second.m_reads);
+    expect(!bool{ error_result });
+  };
+};
+}  // namespace hal
@@ -0,0 +1,505 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/bit_bang_i2c.hpp>
+
+#include <array>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+/**
+ * @brief Open drain i2c bus with a bit level model of a register based device
+ *
+ * The device decodes START, STOP, address and data bits from the line changes
+ * made by the controller, acknowledges its own address and drives SDA for ACK
+ * bits and read data. Writes set a register pointer with the first byte and
+ * store the rest at auto incrementing registers.
+ *
+ * The device answers to both a 7-bit and a 10-bit address. It is selected by
+ * a 10-bit write header followed by the low address byte, after which a read
+ * header alone selects it for reading.
+ */
+class wired_bus
+{
+public:
+  static constexpr hal::byte device_address = 0x3C;
+  static constexpr std::uint16_t ten_bit_address = 0x2A5;
+
+  std::array<hal::byte, 8> m_registers{};
+  int m_stretch_reads = 0;
+  int m_sda_reads = 0;
+  int m_foreign_low_on_read = -1;
+  int m_scl_stretched = 0;
+  int m_starts = 0;
+  int m_stops = 0;
+  hal::byte m_address_byte = 0;
+
+  bool scl()
+  {
+    if (m_controller_scl && m_stretch_remaining > 0) {
+      m_stretch_remaining--;
+      m_scl_stretched++;
+      return false;
+    }
+    return m_controller_scl;
+  }
+
+  bool sda()
+  {
+    // Simulates another controller pulling SDA LOW while this controller
+    // is releasing it
+    if (++m_sda_reads == m_foreign_low_on_read) {
+      return false;
+    }
+    return m_controller_sda && !m_device_sda_low;
+  }
+
+  void set_scl(bool p_level)
+  {
+    const bool previous = m_controller_scl;
+    m_controller_scl = p_level;
+    if (!previous && p_level) {
+      m_stretch_remaining = m_stretch_reads;
+      on_scl_rising();
+    } else if (previous && !p_level) {
+      on_scl_falling();
+    }
+  }
+
+  void set_sda(bool p_level)
+  {
+    const bool previous = m_controller_sda;
+    m_controller_sda = p_level;
+    if (m_controller_scl && previous && !p_level) {
+      m_starts++;
+      m_state = state::receiving;
+      m_bits = 0;
+      m_shift = 0;
+      m_address_phase = true;
+      m_device_sda_low = false;
+    } else if (m_controller_scl && !previous && p_level) {
+      m_stops++;
+      m_state = state::idle;
+      m_device_sda_low = false;
+    }
+  }
+
+private:
+  enum class state
+  {
+    idle,
+    receiving,
+    acknowledging,
+    transmitting,
+    waiting_for_ack,
+  };
+
+  void on_scl_rising()
+  {
+    if (m_state == state::receiving) {
+      m_shift = static_cast<hal::byte>((m_shift << 1) | (m_controller_sda));
+      m_bits++;
+    } else if (m_state == state::waiting_for_ack) {
+      m_controller_acked = !m_controller_sda;
+    }
+  }
+
+  void on_scl_falling()
+  {
+    switch (m_state) {
+      case state::receiving:
+        if (m_bits == 8) {
+          receive_byte();
+        }
+        break;
+      case state::acknowledging:
+        m_device_sda_low = false;
+        if (m_reading) {
+          start_transmit();
+        } else {
+          m_state = state::receiving;
+          m_bits = 0;
+          m_shift = 0;
+        }
+        break;
+      case state::transmitting:
+        m_bits++;
+        if (m_bits == 8) {
+          m_device_sda_low = false;
+          m_state = state::waiting_for_ack;
+        } else {
+          drive_bit();
+        }
+        break;
+      case state::waiting_for_ack:
+        if (m_controller_acked) {
+          start_transmit();
+        } else {
+          m_state = state::idle;
+        }
+        break;
+      case state::idle:
+        break;
+    }
+  }
+
+  void receive_byte()
+  {
+    if (m_address_phase) {
+      m_address_byte = m_shift;
+      m_address_phase = false;
+      m_pointer_loaded = false;
+      m_reading = m_shift & 1;
+      const bool ten_bit_header = (m_shift & 0b1111'1000) == 0b1111'0000;
+      const bool header_matches =
+        ten_bit_header && ((m_shift >> 1) & 0b11) == (ten_bit_address >> 8);
+      if (header_matches && !m_reading) {
+        m_ten_bit_selected = false;
+        m_awaiting_low_address = true;
+      } else if (!(header_matches && m_ten_bit_selected) &&
+                 (m_shift >> 1) != device_address) {
+        m_state = state::idle;
+        return;
+      }
+    } else if (m_awaiting_low_address) {
+      m_awaiting_low_address = false;
+      if (m_shift != (ten_bit_address & 0xFF)) {
+        m_state = state::idle;
+        return;
+      }
+      m_ten_bit_selected = true;
+    } else if (!m_pointer_loaded) {
+      m_pointer = m_shift;
+      m_pointer_loaded = true;
+    } else {
+      m_registers[m_pointer++ % m_registers.size()] = m_shift;
+    }
+    m_device_sda_low = true;
+    m_state = state::acknowledging;
+  }
+
+  void start_transmit()
+  {
+    m_state = state::transmitting;
+    m_bits = 0;
+    m_shift = m_registers[m_pointer++ % m_registers.size()];
+    drive_bit();
+  }
+
+  void drive_bit()
+  {
+    m_device_sda_low = ((m_shift >> (7 - m_bits)) & 1) == 0;
+  }
+
+  bool m_controller_scl = true;
+  bool m_controller_sda = true;
+  bool m_device_sda_low = false;
+  bool m_address_phase = false;
+  bool m_pointer_loaded = false;
+  bool m_reading = false;
+  bool m_controller_acked = false;
+  bool m_awaiting_low_address = false;
+  bool m_ten_bit_selected = false;
+  int m_stretch_remaining = 0;
+  int m_bits = 0;
+  hal::byte m_shift = 0;
+  std::size_t m_pointer = 0;
+  state m_state = state::idle;
+};
+
+class test_scl_pin final : public hal::output_pin
+{
+public:
+  explicit test_scl_pin(wired_bus& p_bus)
+    : m_bus(&p_bus)
+  {
+  }
+  settings m_settings{};
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    m_settings = p_settings;
+    return success();
+  }
+  result<set_level_t> driver_level(bool p_high) override
+  {
+    m_bus->set_scl(p_high);
+    return set_level_t{};
+  }
+  result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_bus->scl() };
+  }
+  wired_bus* m_bus;
+};
+
+class test_sda_pin final : public hal::output_pin
+{
+public:
+  explicit test_sda_pin(wired_bus& p_bus)
+    : m_bus(&p_bus)
+  {
+  }
+  settings m_settings{};
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    m_settings = p_settings;
+    return success();
+  }
+  result<set_level_t> driver_level(bool p_high) override
+  {
+    m_bus->set_sda(p_high);
+    return set_level_t{};
+  }
+  result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_bus->sda() };
+  }
+  wired_bus* m_bus;
+};
+
+using static_bit_bang_i2c =
+  bit_bang_i2c<test_scl_pin, test_sda_pin, test_steady_clock>;
+}  // namespace
+
+void bit_bang_i2c_test()
+{
+  using namespace boost::ut;
+
+  "bit_bang_i2c::create() configures pins as open drain"_test = []() {
+    // Setup
+    wired_bus bus;
+    test_scl_pin scl(bus);
+    test_sda_pin sda(bus);
+    test_steady_clock clock(1);
+
+    // Exercise
+    auto controller = static_bit_bang_i2c::create(scl, sda, clock);
+    auto invalid = bit_bang_i2c<>::create(
+      scl, sda, clock, hal::i2c::settings{ .clock_rate = 0.0f });
+
+    // Verify
+    expect(bool{ controller });
+    expect(!bool{ invalid });
+    expect(that % true == scl.m_settings.open_drain);
+    expect(that % true == sda.m_settings.open_drain);
+  };
+
+  "bit_bang_i2c write then read"_test = []() {
+    // Setup
+    wired_bus bus;
+    test_scl_pin scl(bus);
+    test_sda_pin sda(bus);
+    test_steady_clock clock(1);
+    auto controller = static_bit_bang_i2c::create(scl, sda, clock).value();
+    const std::array<hal::byte, 3> write_data{ 2, 0xA5, 0x5A };
+    const std::array<hal::byte, 1> register_2{ 2 };
+    std::array<hal::byte, 2> read_data{};
+
+    // Exercise
+    auto write_result = controller.transaction(wired_bus::device_address,
+                                        write_data,
+                                        std::span<hal::byte>{},
+                                        hal::never_timeout());
+    auto read_result = controller.transaction(
+      wired_bus::device_address, register_2, read_data, hal::never_timeout());
+
+    // Verify
+    expect(bool{ write_result });
+    expect(bool{ read_result });
+    expect(that % 0xA5 == bus.m_registers[2]);
+    expect(that % 0x5A == bus.m_registers[3]);
+    expect(that % 0xA5 == read_data[0]);
+    expect(that % 0x5A == read_data[1]);
+    // Two STARTs for the write-then-read due to the repeated start
+    expect(that % 3 == bus.m_starts);
+    expect(that % 2 == bus.m_stops);
+  };
+
+  "bit_bang_i2c NACK on unknown address"_test = []() {
+    // Setup
+    wired_bus bus;
+    test_scl_pin scl(bus);
+    test_sda_pin sda(bus);
+    test_steady_clock clock(1);
+    auto controller = bit_bang_i2c<>::create(scl, sda, clock).value();
+    const std::array<hal::byte, 1> data{ 0 };
+    bool caught_errc = false;
+
+    // Exercise
+    auto result = hal::attempt(
+      [&]() -> status {
+        HAL_CHECK(controller.transaction(
+          0x11, data, std::span<hal::byte>{}, hal::never_timeout()));
+        return success();
+      },
+      [&caught_errc](
+        hal::match<std::errc, std::errc::no_such_device_or_address>) -> status {
+        caught_errc = true;
+        return success();
+      });
+
+    // Verify
+    expect(bool{ result });
+    expect(that % true == caught_errc);
+    expect(that % 1 == bus.m_stops);
+  };
+
+  "bit_bang_i2c rejects addresses wider than 7 bits"_test = []() {
+    // Setup
+    wired_bus bus;
+    test_scl_pin scl(bus);
+    test_sda_pin sda(bus);
+    test_steady_clock clock(1);
+    auto controller = static_bit_bang_i2c::create(scl, sda, clock).value();
+    const std::array<hal::byte, 1> data{ 0 };
+    bool caught_errc = false;
+
+    // Exercise
+    auto result = hal::attempt(
+      [&]() -> status {
+        HAL_CHECK(controller.transaction(
+          0x80, data, std::span<hal::byte>{}, hal::never_timeout()));
+        return success();
+      },
+      [&caught_errc](
+        hal::match<std::errc, std::errc::invalid_argument>) -> status {
+        caught_errc = true;
+        return success();
+      });
+
+    // Verify
+    expect(bool{ result });
+    expect(that % true == caught_errc);
+    expect(that % 0 == bus.m_starts);
+  };
+
+  "bit_bang_i2c reaches 10-bit addresses"_test = []() {
+    // Setup
+    wired_bus bus;
+    test_scl_pin scl(bus);
+    test_sda_pin sda(bus);
+    test_steady_clock clock(1);
+    auto controller = static_bit_bang_i2c::create(scl, sda, clock).value();
+    // Upper address bits OR'd with 0b1111'0000, as hal::i2c specifies, and
+    // the low address byte leading the data
+    constexpr auto address =
+      static_cast<hal::byte>(0b1111'0000 | (wired_bus::ten_bit_address >> 8));
+    constexpr auto low_byte =
+      static_cast<hal::byte>(wired_bus::ten_bit_address & 0xFF);
+    const std::array<hal::byte, 4> write_data{ low_byte, 2, 0x12, 0x34 };
+    const std::array<hal::byte, 2> register_2{ low_byte, 2 };
+    std::array<hal::byte, 2> read_data{};
+
+    // Exercise
+    auto write_result = controller.transaction(
+      address, write_data, std::span<hal::byte>{}, hal::never_timeout());
+    auto read_result = controller.transaction(
+      address, register_2, read_data, hal::never_timeout());
+    auto missing_low_byte = controller.transaction(
+      address, std::span<const hal::byte>{}, read_data, hal::never_timeout());
+
+    // Verify
+    expect(bool{ write_result });
+    expect(bool{ read_result });
+    expect(!bool{ missing_low_byte });
+    expect(that % 0x12 == bus.m_registers[2]);
+    expect(that % 0x34 == bus.m_registers[3]);
+    expect(that % 0x12 == read_data[0]);
+    expect(that % 0x34 == read_data[1]);
+    // The repeated start is followed by the read header 0b11110 10 1
+    expect(that % 0b1111'0101 == bus.m_address_byte);
+    expect(that % 3 == bus.m_starts);
+  };
+
+  "bit_bang_i2c waits for clock stretching"_test = []() {
+    // Setup
+    wired_bus bus;
+    test_scl_pin scl(bus);
+    test_sda_pin sda(bus);
+    test_steady_clock clock(1);
+    auto controller = bit_bang_i2c<>::create(scl, sda, clock).value();
+    const std::array<hal::byte, 2> data{ 0, 0x77 };
+    bus.m_stretch_reads = 3;
+
+    // Exercise
+    auto result = controller.transaction(wired_bus::device_address,
+                                  data,
+                                  std::span<hal::byte>{},
+                                  hal::never_timeout());
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 0x77 == bus.m_registers[0]);
+    expect(that % 0 < bus.m_scl_stretched);
+  };
+
+  "bit_bang_i2c clock stretching respects timeout"_test = []() {
+    // Setup
+    wired_bus bus;
+    test_scl_pin scl(bus);
+    test_sda_pin sda(bus);
+    test_steady_clock clock(1);
+    auto controller = bit_bang_i2c<>::create(scl, sda, clock).value();
+    const std::array<hal::byte, 1> data{ 0 };
+    int timeout_calls = 0;
+    auto limited_timeout = [&timeout_calls]() -> status {
+      if (++timeout_calls > 5) {
+        return hal::new_error(std::errc::timed_out);
+      }
+      return success();
+    };
+    bus.m_stretch_reads = 1000;
+
+    // Exercise
+    auto result = controller.transaction(
+      wired_bus::device_address, data, std::span<hal::byte>{}, limited_timeout);
+
+    // Verify
+    expect(!bool{ result });
+  };
+
+  "bit_bang_i2c retries after arbitration loss"_test = []() {
+    // Setup
+    wired_bus bus;
+    test_scl_pin scl(bus);
+    test_sda_pin sda(bus);
+    test_steady_clock clock(1);
+    auto controller = bit_bang_i2c<>::create(scl, sda, clock).value();
+    const std::array<hal::byte, 2> data{ 1, 0x42 };
+    // The 1st and 2nd reads of SDA check that the bus is free, the 3rd is the
+    // first "1" bit of the address, which another controller wins.
+    bus.m_foreign_low_on_read = 3;
+
+    // Exercise
+    auto result = controller.transaction(wired_bus::device_address,
+                                  data,
+                                  std::span<hal::byte>{},
+                                  hal::never_timeout());
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 0x42 == bus.m_registers[1]);
+    expect(that % 2 == bus.m_starts);
+    expect(that % 1 == bus.m_stops);
+  };
+};
+}  // namespace hal
@@ -0,0 +1,314 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/bit_bang_spi.hpp>
+
+#include <array>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+/**
+ * @brief Bit level model of an spi device wired to the controller's pins
+ *
+ * Samples MOSI and shifts out MISO on the clock edges defined by its spi mode
+ * and records every byte received. It transmits the bytes in m_transmit.
+ */
+class wired_device
+{
+public:
+  wired_device(bool p_clock_idles_high, bool p_data_valid_on_trailing_edge)
+    : m_clock_idles_high(p_clock_idles_high)
+    , m_data_valid_on_trailing_edge(p_data_valid_on_trailing_edge)
+    , m_sck(p_clock_idles_high)
+    , m_transmit_bit(p_data_valid_on_trailing_edge ? -1 : 0)
+  {
+  }
+
+  std::vector<hal::byte> m_transmit{};
+  std::vector<hal::byte> m_received{};
+
+  bool sck() const
+  {
+    return m_sck;
+  }
+
+  bool miso() const
+  {
+    const auto byte_index = static_cast<std::size_t>(m_transmit_bit / 8);
+    if (m_transmit_bit < 0 || byte_index >= m_transmit.size()) {
+      return true;
+    }
+    return (m_transmit[byte_index] >> (7 - m_transmit_bit % 8)) & 1;
+  }
+
+  void set_mosi(bool p_level)
+  {
+    m_mosi = p_level;
+  }
+
+  void set_sck(bool p_level)
+  {
+    if (p_level == m_sck) {
+      return;
+    }
+    const bool leading = m_sck == m_clock_idles_high;
+    m_sck = p_level;
+
+    const bool sample_edge = leading != m_data_valid_on_trailing_edge;
+    if (sample_edge) {
+      m_shift = static_cast<hal::byte>((m_shift << 1) | (m_mosi ? 1 : 0));
+      if (++m_bits == 8) {
+        m_received.push_back(m_shift);
+        m_bits = 0;
+      }
+    } else {
+      m_transmit_bit++;
+    }
+  }
+
+private:
+  bool m_clock_idles_high;
+  bool m_data_valid_on_trailing_edge;
+  bool m_sck;
+  bool m_mosi = false;
+  int m_transmit_bit;
+  int m_bits = 0;
+  hal::byte m_shift = 0;
+};
+
+class test_sck_pin final : public hal::output_pin
+{
+public:
+  explicit test_sck_pin(wired_device& p_device)
+    : m_device(&p_device)
+  {
+  }
+  settings m_settings{ .open_drain = true };
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    m_settings = p_settings;
+    return success();
+  }
+  result<set_level_t> driver_level(bool p_high) override
+  {
+    m_device->set_sck(p_high);
+    return set_level_t{};
+  }
+  result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_device->sck() };
+  }
+  wired_device* m_device;
+};
+
+class test_mosi_pin final : public hal::output_pin
+{
+public:
+  explicit test_mosi_pin(wired_device& p_device)
+    : m_device(&p_device)
+  {
+  }
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+  result<set_level_t> driver_level(bool p_high) override
+  {
+    m_device->set_mosi(p_high);
+    return set_level_t{};
+  }
+  result<level_t> driver_level() override
+  {
+    return level_t{ .state = false };
+  }
+  wired_device* m_device;
+};
+
+class test_miso_pin final : public hal::input_pin
+{
+public:
+  explicit test_miso_pin(wired_device& p_device)
+    : m_device(&p_device)
+  {
+  }
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+  result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_device->miso() };
+  }
+  wired_device* m_device;
+};
+
+template<bool ClockIdlesHigh, bool DataValidOnTrailingEdge>
+using concrete_static_bit_bang_spi =
+  static_bit_bang_spi<ClockIdlesHigh,
+                      DataValidOnTrailingEdge,
+                      test_sck_pin,
+                      test_mosi_pin,
+                      test_miso_pin,
+                      test_steady_clock>;
+
+/// Full duplex transfer of 2 bytes through a device in the given mode
+void check_mode(bool p_clock_idles_high, bool p_data_valid_on_trailing_edge)
+{
+  using namespace boost::ut;
+
+  // Setup
+  wired_device device(p_clock_idles_high, p_data_valid_on_trailing_edge);
+  device.m_transmit = { 0xC3, 0x5A };
+  test_sck_pin sck(device);
+  test_mosi_pin mosi(device);
+  test_miso_pin miso(device);
+  test_steady_clock clock(1);
+  const hal::spi::settings mode{
+    .clock_rate = 100.0_kHz,
+    .clock_idles_high = p_clock_idles_high,
+    .data_valid_on_trailing_edge = p_data_valid_on_trailing_edge,
+  };
+  auto controller = bit_bang_spi<>::create(sck, mosi, miso, clock, mode);
+  const std::array<hal::byte, 2> data_out{ 0xA1, 0x7E };
+  std::array<hal::byte, 2> data_in{};
+
+  // Exercise
+  auto result = controller.value().transfer(data_out, data_in);
+
+  // Verify
+  expect(bool{ result });
+  expect(that % false == sck.m_settings.open_drain);
+  expect(that % p_clock_idles_high == device.sck());
+  expect(device.m_received == std::vector<hal::byte>{ 0xA1, 0x7E });
+  expect(that % 0xC3 == data_in[0]);
+  expect(that % 0x5A == data_in[1]);
+}
+}  // namespace
+
+void bit_bang_spi_test()
+{
+  using namespace boost::ut;
+
+  "bit_bang_spi mode 0"_test = []() { check_mode(false, false); };
+  "bit_bang_spi mode 1"_test = []() { check_mode(false, true); };
+  "bit_bang_spi mode 2"_test = []() { check_mode(true, false); };
+  "bit_bang_spi mode 3"_test = []() { check_mode(true, true); };
+
+  "bit_bang_spi filler and write only transfers"_test = []() {
+    // Setup
+    wired_device device(false, false);
+    device.m_transmit = { 0x11, 0x22, 0x33 };
+    test_sck_pin sck(device);
+    test_mosi_pin mosi(device);
+    test_miso_pin miso(device);
+    test_steady_clock clock(1);
+    auto controller = bit_bang_spi<>::create(sck, mosi, miso, clock).value();
+    const std::array<hal::byte, 1> data_out{ 0x9F };
+    std::array<hal::byte, 2> data_in{};
+
+    // Exercise
+    auto read_result = controller.transfer(data_out, data_in, 0x00);
+    auto write_result = controller.transfer(data_out, std::span<hal::byte>{});
+
+    // Verify
+    expect(bool{ read_result });
+    expect(bool{ write_result });
+    expect(device.m_received == std::vector<hal::byte>{ 0x9F, 0x00, 0x9F });
+    expect(that % 0x11 == data_in[0]);
+    expect(that % 0x22 == data_in[1]);
+  };
+
+  "bit_bang_spi::configure() switches mode at runtime"_test = []() {
+    // Setup
+    wired_device device(false, false);
+    test_sck_pin sck(device);
+    test_mosi_pin mosi(device);
+    test_miso_pin miso(device);
+    test_steady_clock clock(1);
+    auto controller = bit_bang_spi<>::create(sck, mosi, miso, clock).value();
+    std::array<hal::byte, 1> data_in{};
+
+    // Exercise
+    auto configure_result = controller.configure(hal::spi::settings{
+      .clock_idles_high = true, .data_valid_on_trailing_edge = true });
+    // Equivalent to selecting a mode 3 device once SCK has changed polarity
+    device = wired_device(true, true);
+    device.m_transmit = { 0x81 };
+    auto transfer_result = controller.transfer(std::span<hal::byte>{}, data_in);
+    auto invalid = controller.configure(hal::spi::settings{ .clock_rate = 0 });
+
+    // Verify
+    expect(bool{ configure_result });
+    expect(bool{ transfer_result });
+    expect(!bool{ invalid });
+    expect(that % 0x81 == data_in[0]);
+  };
+
+  "static_bit_bang_spi transfers with fixed mode"_test = []() {
+    // Setup
+    wired_device device(true, false);
+    device.m_transmit = { 0xF0 };
+    test_sck_pin sck(device);
+    test_mosi_pin mosi(device);
+    test_miso_pin miso(device);
+    test_steady_clock clock(1);
+    auto controller = concrete_static_bit_bang_spi<true, false>::create(
+                        sck, mosi, miso, clock, 1.0_MHz)
+                        .value();
+    std::array<hal::byte, 1> data{ 0x0F };
+
+    // Exercise
+    auto result = controller.transfer_in_place(data);
+
+    // Verify
+    expect(bool{ result });
+    expect(device.m_received == std::vector<hal::byte>{ 0x0F });
+    expect(that % 0xF0 == data[0]);
+    expect(that % true == device.sck());
+  };
+
+  "static_bit_bang_spi::configure() rejects other modes"_test = []() {
+    // Setup
+    wired_device device(false, false);
+    test_sck_pin sck(device);
+    test_mosi_pin mosi(device);
+    test_miso_pin miso(device);
+    test_steady_clock clock(1);
+    auto controller =
+      concrete_static_bit_bang_spi<false, false>::create(sck, mosi, miso, clock)
+        .value();
+
+    // Exercise
+    auto same_mode = controller.configure(
+      hal::spi::settings{ .clock_rate = 1.0_MHz });
+    auto other_mode = controller.configure(
+      hal::spi::settings{ .clock_idles_high = true });
+
+    // Verify
+    expect(bool{ same_mode });
+    expect(!bool{ other_mode });
+  };
+};
+}  // namespace hal
@@ -0,0 +1,147 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/cic_decimator.hpp>
+
+#include <array>
+#include <cmath>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+/// 12 bit adc that alternates between two codes
+class test_raw_adc : public hal::adc
+{
+public:
+  std::array<std::uint32_t, 2> m_codes{ 2000, 2001 };
+  int m_reads = 0;
+
+private:
+  result<read_t> driver_read() override
+  {
+    return read_t{ .sample = 0.0f };
+  }
+
+  result<read_raw_t> driver_read_raw() override
+  {
+    const auto code = m_codes[static_cast<std::size_t>(m_reads++ % 2)];
+    return read_raw_t{ .code = code, .resolution = 12 };
+  }
+};
+}  // namespace
+
+void cic_decimator_test()
+{
+  using namespace boost::ut;
+
+  "cic_decimator::create() checks the output fits"_test = []() {
+    // Exercise
+    auto valid = cic_decimator<3>::create(64, 12);
+    auto zero_ratio = cic_decimator<3>::create(0, 12);
+    auto too_wide = cic_decimator<3>::create(1024, 16);
+
+    // Verify
+    expect(bool{ valid });
+    expect(!bool{ zero_ratio });
+    expect(!bool{ too_wide });
+    expect(that % (4095U * 64U * 64U * 64U) == valid.value().max_code());
+    expect(that % 30 == valid.value().output_resolution());
+  };
+
+  "cic_decimator decimates a constant input"_test = []() {
+    // Setup
+    auto decimator = cic_decimator<3>::create(4, 12).value();
+    std::array<std::uint32_t, 20> input{};
+    input.fill(100);
+    std::array<std::uint32_t, 6> output{};
+
+    // Exercise
+    auto filled = decimator.process(input, output);
+
+    // Verify
+    expect(that % 5U == filled.size());
+    // Step response, then the steady state gain of 4^3
+    expect(that % 2000U == filled[0]);
+    expect(that % 6400U == filled[3]);
+    expect(that % 6400U == filled[4]);
+  };
+
+  "cic_decimator keeps its phase across blocks"_test = []() {
+    // Setup
+    auto whole = cic_decimator<2>::create(3, 8).value();
+    auto split = cic_decimator<2>::create(3, 8).value();
+    const std::array<std::uint32_t, 9> input{ 1, 5, 9, 2, 200, 7, 3, 0, 255 };
+    std::array<std::uint32_t, 4> expected{};
+    std::array<std::uint32_t, 4> output{};
+
+    // Exercise
+    const auto expected_count = whole.process(input, expected).size();
+    const auto first = split.process(std::span(input).first(4), output);
+    const auto second =
+      split.process(std::span(input).subspan(4), std::span(output).subspan(1));
+
+    // Verify
+    expect(that % 3U == expected_count);
+    expect(that % 1U == first.size());
+    expect(that % 2U == second.size());
+    expect(that % expected[0] == output[0]);
+    expect(that % expected[1] == output[1]);
+    expect(that % expected[2] == output[2]);
+  };
+
+  "cic_adc oversamples another adc"_test = []() {
+    // Setup
+    test_raw_adc source;
+    auto oversampled = cic_adc<3>::create(source, 8).value();
+    const auto reads_after_create = source.m_reads;
+
+    // Exercise
+    auto raw = oversampled.read_raw();
+    auto sample = oversampled.read();
+
+    // Verify
+    expect(bool{ raw });
+    expect(bool{ sample });
+    expect(that % (1 + 3 * 8) == reads_after_create);
+    expect(that % (1 + 5 * 8) == source.m_reads);
+    // Average of 2000 and 2001 with a gain of 8^3, rescaled from the full
+    // scale output of 4095 * 8^3 to the full scale code of 21 bits
+    constexpr std::uint64_t output = 2000U * 512U + 256U;
+    constexpr std::uint64_t max_code = 4095U * 512U;
+    constexpr std::uint64_t full_scale = (1U << 21) - 1U;
+    constexpr auto code = (output * full_scale + max_code / 2) / max_code;
+    expect(that % code == raw.value().code);
+    expect(that % 21 == raw.value().resolution);
+    expect(std::abs(2000.5f / 4095.0f - sample.value().sample) < 1e-6f);
+  };
+
+  "cic_adc reads a full scale input as full scale"_test = []() {
+    // Setup
+    test_raw_adc source;
+    source.m_codes = { 4095, 4095 };
+    auto oversampled = cic_adc<3>::create(source, 3).value();
+
+    // Exercise
+    auto raw = oversampled.read_raw();
+    auto sample = oversampled.read();
+
+    // Verify
+    // 4095 * 3^3 = 110565 needs 17 bits but is not the 17 bit full scale
+    expect(that % 17 == raw.value().resolution);
+    expect(that % ((1U << 17) - 1U) == raw.value().code);
+    expect(that % 1.0f == sample.value().sample);
+  };
+};
+}  // namespace hal
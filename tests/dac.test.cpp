@@ -37,6 +37,27 @@ private:
     return write_t{};
   }
 };
+
+/// 12 bit dac that writes codes to its register without float arithmetic
+class test_code_dac : public hal::dac
+{
+public:
+  std::uint32_t m_code{};
+  int m_float_writes{};
+
+private:
+  result<write_t> driver_write(float) override
+  {
+    m_float_writes++;
+    return write_t{};
+  }
+
+  result<write_t> driver_write_fraction(q16 p_proportion) override
+  {
+    m_code = p_proportion.scale(4095);
+    return write_t{};
+  }
+};
 }  // namespace
 
 void dac_test()
@@ -67,5 +88,30 @@ void dac_test()
     // Verify
     expect(!bool{ result });
   };
+
+  "dac::write(q16) defaults to the float implementation"_test = []() {
+    // Setup
+    test_dac test;
+
+    // Exercise
+    auto result = test.write(q16::from_ratio(1, 4));
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 0.25f == test.m_passed_value);
+  };
+
+  "dac::write(q16) reaches integer drivers"_test = []() {
+    // Setup
+    test_code_dac test;
+
+    // Exercise
+    auto result = test.write(q16::from_raw(q16::raw_one));
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 4095U == test.m_code);
+    expect(that % 0 == test.m_float_writes);
+  };
 };
 }  // namespace hal
@@ -0,0 +1,107 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/dac_stream.hpp>
+
+#include <array>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class test_dac_stream : public hal::dac_stream
+{
+public:
+  std::span<const q16> m_submitted{};
+  hal::callback<complete_handler> m_handler = [](std::span<const q16>) {};
+  hertz m_sample_rate{};
+  bool m_running = false;
+
+private:
+  bool driver_submit(std::span<const q16> p_samples) override
+  {
+    m_submitted = p_samples;
+    return true;
+  }
+  void driver_on_complete(hal::callback<complete_handler> p_handler) override
+  {
+    m_handler = p_handler;
+  }
+  status driver_start(hertz p_sample_rate) override
+  {
+    m_sample_rate = p_sample_rate;
+    m_running = true;
+    return success();
+  }
+  status driver_stop() override
+  {
+    m_running = false;
+    return success();
+  }
+  std::size_t driver_queued() override
+  {
+    return m_submitted.empty() ? 0 : 1;
+  }
+  std::uint32_t driver_underruns() override
+  {
+    return 7;
+  }
+};
+}  // namespace
+
+void dac_stream_test()
+{
+  using namespace boost::ut;
+
+  "dac_stream interface test"_test = []() {
+    // Setup
+    test_dac_stream test;
+    const std::array<q16, 2> samples{ q16::from_raw(1), q16::from_raw(2) };
+    std::size_t completed = 0;
+    test.on_complete([&completed](std::span<const q16> p_samples) {
+      completed = p_samples.size();
+    });
+
+    // Exercise
+    const bool queued = test.submit(samples);
+    auto start_result = test.start(8.0_kHz);
+    test.m_handler(test.m_submitted);
+    auto stop_result = test.stop();
+
+    // Verify
+    expect(that % true == queued);
+    expect(bool{ start_result });
+    expect(bool{ stop_result });
+    expect(that % 8000.0f == test.m_sample_rate);
+    expect(that % false == test.m_running);
+    expect(that % 2U == completed);
+    expect(that % 1U == test.queued());
+    expect(that % 7U == test.underruns());
+  };
+
+  "dac_stream::start() rejects invalid sample rates"_test = []() {
+    // Setup
+    test_dac_stream test;
+
+    // Exercise
+    auto zero_result = test.start(0.0_Hz);
+    auto negative_result = test.start(-1.0_kHz);
+
+    // Verify
+    expect(!bool{ zero_result });
+    expect(!bool{ negative_result });
+    expect(that % false == test.m_running);
+  };
+};
+}  // namespace hal
@@ -0,0 +1,306 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/debouncer.hpp>
+
+#include <vector>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+using namespace std::chrono_literals;
+
+class test_interrupt_pin : public hal::interrupt_pin
+{
+public:
+  settings m_settings{};
+  hal::callback<handler> m_handler = [](bool) {};
+
+  void edge(bool p_state)
+  {
+    m_handler(p_state);
+  }
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    m_settings = p_settings;
+    return success();
+  }
+  void driver_on_trigger(hal::callback<handler> p_callback) override
+  {
+    m_handler = p_callback;
+  }
+};
+
+struct event
+{
+  std::int64_t time;
+  bool state;
+};
+
+constexpr std::int64_t ms = 1'000'000;
+constexpr hal::interrupt_pin::settings both_edges{
+  .trigger = hal::interrupt_pin::trigger_edge::both,
+};
+
+/// Bounce p_pin at each of p_times, alternating from p_first_state
+void bounce(simulated_timer& p_timer,
+            test_interrupt_pin& p_pin,
+            std::vector<std::int64_t> p_times,
+            bool p_first_state)
+{
+  bool state = p_first_state;
+  for (const auto time : p_times) {
+    p_timer.advance_to(time);
+    p_pin.edge(state);
+    state = !state;
+  }
+}
+}  // namespace
+
+void debouncer_test()
+{
+  using namespace boost::ut;
+
+  "debounced_pin configures both edges on the wrapped pin"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    test_interrupt_pin raw;
+    hal::debouncer debouncer(timer, clock, 10ms);
+    hal::debounced_pin pin(debouncer, raw);
+
+    // Exercise
+    auto result = pin.configure({
+      .resistor = pin_resistor::pull_down,
+      .trigger = interrupt_pin::trigger_edge::falling,
+    });
+
+    // Verify
+    expect(bool{ result });
+    expect(interrupt_pin::trigger_edge::both == raw.m_settings.trigger);
+    expect(pin_resistor::pull_down == raw.m_settings.resistor);
+  };
+
+  "debounced_pin reports one edge per bouncy transition"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    test_interrupt_pin raw;
+    hal::debouncer debouncer(timer, clock, 10ms);
+    hal::debounced_pin pin(debouncer, raw, true);
+    std::vector<event> events;
+    (void)pin.configure(both_edges);
+    pin.on_trigger([&events, &timer](bool p_state) {
+      events.push_back({ .time = timer.m_now, .state = p_state });
+    });
+
+    // Exercise
+    // Press: 5 bounces ending LOW, then release: 3 bounces ending HIGH
+    bounce(timer, raw, { 0, 1 * ms, 2 * ms, 4 * ms, 7 * ms }, false);
+    timer.advance_to(50 * ms);
+    bounce(timer, raw, { 50 * ms, 51 * ms, 53 * ms }, true);
+    timer.advance_to(100 * ms);
+
+    // Verify
+    expect(that % 2U == events.size());
+    expect(that % (17 * ms) == events[0].time);
+    expect(that % false == events[0].state);
+    expect(that % (63 * ms) == events[1].time);
+    expect(that % true == events[1].state);
+    expect(that % true == pin.stable_state());
+    expect(!timer.m_is_running);
+  };
+
+  "debounced_pin ignores glitches back to the stable state"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    test_interrupt_pin raw;
+    hal::debouncer debouncer(timer, clock, 10ms);
+    hal::debounced_pin pin(debouncer, raw, true);
+    int calls = 0;
+    (void)pin.configure(both_edges);
+    pin.on_trigger([&calls](bool) { calls++; });
+
+    // Exercise
+    bounce(timer, raw, { 0, 1 * ms, 2 * ms, 3 * ms }, false);
+    timer.advance_to(100 * ms);
+
+    // Verify
+    expect(that % 0 == calls);
+    expect(that % true == pin.stable_state());
+  };
+
+  "debounced_pin filters by the configured trigger edge"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    test_interrupt_pin raw;
+    hal::debouncer debouncer(timer, clock, 10ms);
+    hal::debounced_pin pin(debouncer, raw, true);
+    std::vector<bool> states;
+    (void)pin.configure({ .trigger = interrupt_pin::trigger_edge::rising });
+    pin.on_trigger([&states](bool p_state) { states.push_back(p_state); });
+
+    // Exercise
+    bounce(timer, raw, { 0, 1 * ms, 2 * ms }, false);
+    timer.advance_to(50 * ms);
+    bounce(timer, raw, { 50 * ms, 51 * ms, 52 * ms }, true);
+    timer.advance_to(100 * ms);
+
+    // Verify
+    expect(that % 1U == states.size());
+    expect(that % true == states[0]);
+    expect(that % true == pin.stable_state());
+  };
+
+  "debouncer shares one timer between pins"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    test_interrupt_pin raw_a;
+    test_interrupt_pin raw_b;
+    hal::debouncer debouncer(timer, clock, 10ms);
+    hal::debounced_pin pin_a(debouncer, raw_a, true);
+    hal::debounced_pin pin_b(debouncer, raw_b, true);
+    std::vector<event> events_a;
+    std::vector<event> events_b;
+    (void)pin_a.configure(both_edges);
+    (void)pin_b.configure(both_edges);
+    pin_a.on_trigger([&events_a, &timer](bool p_state) {
+      events_a.push_back({ .time = timer.m_now, .state = p_state });
+    });
+    pin_b.on_trigger([&events_b, &timer](bool p_state) {
+      events_b.push_back({ .time = timer.m_now, .state = p_state });
+    });
+
+    // Exercise
+    // A bounces from 0ms to 6ms, B from 2ms to 4ms, so B settles first
+    timer.advance_to(0);
+    raw_a.edge(false);
+    timer.advance_to(2 * ms);
+    raw_b.edge(false);
+    timer.advance_to(3 * ms);
+    raw_b.edge(true);
+    timer.advance_to(4 * ms);
+    raw_b.edge(false);
+    timer.advance_to(5 * ms);
+    raw_a.edge(true);
+    timer.advance_to(6 * ms);
+    raw_a.edge(false);
+    timer.advance_to(100 * ms);
+
+    // Verify
+    expect(that % 1U == events_a.size());
+    expect(that % 1U == events_b.size());
+    expect(that % (16 * ms) == events_a[0].time);
+    expect(that % false == events_a[0].state);
+    expect(that % (14 * ms) == events_b[0].time);
+    expect(that % false == events_b[0].state);
+    // Due at 10ms for A's first edge, then 14ms for B and 16ms for A
+    expect(that % 3 == timer.m_callbacks);
+  };
+
+  "debouncer counts failed schedules and retries on the next edge"_test =
+    []() {
+      // Setup
+      simulated_timer timer;
+      simulated_clock clock(timer);
+      test_interrupt_pin raw;
+      hal::debouncer debouncer(timer, clock, 10ms);
+      hal::debounced_pin pin(debouncer, raw, true);
+      std::vector<event> events;
+      (void)pin.configure(both_edges);
+      pin.on_trigger([&events, &timer](bool p_state) {
+        events.push_back({ .time = timer.m_now, .state = p_state });
+      });
+
+      // Exercise
+      // The callback for the edge at 0 finds the edge at 5ms and fails to
+      // reschedule, then the edge at 20ms fails to schedule
+      bounce(timer, raw, { 0, 5 * ms }, false);
+      timer.m_return_error_status = true;
+      timer.advance_to(20 * ms);
+      raw.edge(false);
+      timer.advance_to(50 * ms);
+      const auto events_while_failing = events.size();
+      const auto errors_while_failing = debouncer.schedule_errors();
+      timer.m_return_error_status = false;
+      raw.edge(false);
+      timer.advance_to(100 * ms);
+
+      // Verify
+      expect(that % 0U == events_while_failing);
+      expect(that % 2U == errors_while_failing);
+      expect(that % 2U == debouncer.schedule_errors());
+      expect(that % 1U == events.size());
+      expect(that % (60 * ms) == events[0].time);
+      expect(that % false == events[0].state);
+      expect(!timer.m_is_running);
+    };
+
+  "debounced_pin leaves the queue when destroyed"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    test_interrupt_pin raw_a;
+    test_interrupt_pin raw_b;
+    hal::debouncer debouncer(timer, clock, 10ms);
+    hal::debounced_pin pin_a(debouncer, raw_a, true);
+    int calls = 0;
+    (void)pin_a.configure(both_edges);
+    pin_a.on_trigger([&calls](bool) { calls++; });
+
+    // Exercise
+    {
+      hal::debounced_pin pin_b(debouncer, raw_b, true);
+      raw_b.edge(false);
+      timer.advance_to(1 * ms);
+      raw_a.edge(false);
+    }
+    timer.advance_to(100 * ms);
+
+    // Verify
+    expect(that % 1 == calls);
+  };
+
+  "debounced_pin detaches from the wrapped pin when destroyed"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    test_interrupt_pin raw;
+    hal::debouncer debouncer(timer, clock, 10ms);
+    int calls = 0;
+    {
+      hal::debounced_pin pin(debouncer, raw, true);
+      (void)pin.configure(both_edges);
+      pin.on_trigger([&calls](bool) { calls++; });
+    }
+
+    // Exercise
+    raw.edge(false);
+    timer.advance_to(100 * ms);
+
+    // Verify
+    expect(that % 0 == calls);
+    expect(that % 0 == timer.m_callbacks);
+    expect(!timer.m_is_running);
+  };
+};
+}  // namespace hal
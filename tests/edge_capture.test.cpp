@@ -0,0 +1,175 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/edge_capture.hpp>
+
+#include <array>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+class test_interrupt_pin : public hal::interrupt_pin
+{
+public:
+  hal::callback<handler> m_handler = [](bool) {};
+
+  void edge(bool p_state)
+  {
+    m_handler(p_state);
+  }
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+  void driver_on_trigger(hal::callback<handler> p_callback) override
+  {
+    m_handler = p_callback;
+  }
+};
+}  // namespace
+
+void edge_capture_test()
+{
+  using namespace boost::ut;
+
+  "edge_capture records state and ticks of each edge"_test = []() {
+    // Setup
+    test_interrupt_pin pin;
+    test_steady_clock clock;
+    hal::edge_capture<8> capture(pin, clock);
+    std::array<edge_event, 8> buffer{};
+
+    // Exercise
+    clock.m_ticks = 100;
+    pin.edge(true);
+    clock.m_ticks = 250;
+    pin.edge(false);
+    clock.m_ticks = 400;
+    pin.edge(true);
+    const auto queued = capture.size();
+    auto events = capture.drain(buffer);
+
+    // Verify
+    expect(that % 3U == queued);
+    expect(that % 3U == events.size());
+    expect(that % 100U == events[0].ticks);
+    expect(that % true == events[0].state);
+    expect(that % 250U == events[1].ticks);
+    expect(that % false == events[1].state);
+    expect(that % 400U == events[2].ticks);
+    expect(that % true == events[2].state);
+    expect(that % 0U == capture.size());
+    expect(that % 0U == capture.overflows());
+  };
+
+  "edge_capture drains in batches"_test = []() {
+    // Setup
+    test_interrupt_pin pin;
+    test_steady_clock clock;
+    hal::edge_capture<8> capture(pin, clock);
+    std::array<edge_event, 2> buffer{};
+    for (std::uint64_t i = 0; i < 5; i++) {
+      clock.m_ticks = i;
+      pin.edge(i % 2 == 0);
+    }
+
+    // Exercise
+    auto first = capture.drain(buffer);
+    const auto first_ticks = first[0].ticks;
+    auto second = capture.drain(buffer);
+    const auto second_ticks = second[0].ticks;
+    auto third = capture.drain(buffer);
+    const auto third_ticks = third[0].ticks;
+    auto fourth = capture.drain(buffer);
+
+    // Verify
+    expect(that % 2U == first.size());
+    expect(that % 0U == first_ticks);
+    expect(that % 2U == second.size());
+    expect(that % 2U == second_ticks);
+    expect(that % 1U == third.size());
+    expect(that % 4U == third_ticks);
+    expect(fourth.empty());
+  };
+
+  "edge_capture counts overflows and keeps the oldest edges"_test = []() {
+    // Setup
+    test_interrupt_pin pin;
+    test_steady_clock clock;
+    hal::edge_capture<4> capture(pin, clock);
+    std::array<edge_event, 8> buffer{};
+
+    // Exercise
+    for (std::uint64_t i = 0; i < 7; i++) {
+      clock.m_ticks = i;
+      pin.edge(true);
+    }
+    auto events = capture.drain(buffer);
+
+    // Verify
+    expect(that % 4U == events.size());
+    expect(that % 0U == events[0].ticks);
+    expect(that % 3U == events[3].ticks);
+    expect(that % 3U == capture.overflows());
+  };
+
+  "edge_capture wraps around the queue"_test = []() {
+    // Setup
+    test_interrupt_pin pin;
+    test_steady_clock clock;
+    hal::edge_capture<4> capture(pin, clock);
+    std::array<edge_event, 4> buffer{};
+    std::uint64_t expected = 0;
+    bool in_order = true;
+
+    // Exercise
+    for (std::uint64_t i = 0; i < 30; i++) {
+      clock.m_ticks = i;
+      pin.edge(true);
+      if (i % 3 == 2) {
+        for (const auto& event : capture.drain(buffer)) {
+          in_order = in_order && event.ticks == expected++;
+        }
+      }
+    }
+
+    // Verify
+    expect(in_order);
+    expect(that % 30U == expected);
+    expect(that % 0U == capture.overflows());
+  };
+
+  "edge_capture detaches from the pin when destroyed"_test = []() {
+    // Setup
+    test_interrupt_pin pin;
+    test_steady_clock clock(1);
+    {
+      hal::edge_capture<4> capture(pin, clock);
+      pin.edge(true);
+    }
+
+    // Exercise
+    pin.edge(false);
+
+    // Verify
+    // Only the edge captured while alive read the clock
+    expect(that % 1U == clock.m_ticks);
+  };
+};
+}  // namespace hal
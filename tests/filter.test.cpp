@@ -0,0 +1,177 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/filter.hpp>
+
+#include <array>
+#include <cmath>
+#include <span>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+void filter_test()
+{
+  using namespace boost::ut;
+
+  "moving_average averages the last samples"_test = []() {
+    // Setup
+    moving_average<4> filter;
+    std::array<float, 6> output{};
+
+    // Exercise
+    for (std::size_t i = 0; i < output.size(); i++) {
+      output[i] = filter.process(4.0f);
+    }
+
+    // Verify
+    expect(that % 1.0f == output[0]);
+    expect(that % 3.0f == output[2]);
+    expect(that % 4.0f == output[3]);
+    expect(that % 4.0f == output[5]);
+  };
+
+  "moving_average does not drift after large samples"_test = []() {
+    // Setup
+    moving_average<4> filter;
+    float output = 0.0f;
+
+    // Exercise
+    // 0.5 is lost when added to 1e8, so a running sum alone would be left
+    // with the wrong total once 1e8 leaves the window
+    (void)filter.process(1.0e8f);
+    for (int i = 0; i < 7; i++) {
+      output = filter.process(0.5f);
+    }
+
+    // Verify
+    expect(that % 0.5f == output);
+  };
+
+  "median_filter rejects impulses"_test = []() {
+    // Setup
+    median_filter<3> filter;
+    const std::array<float, 5> input{ 1.0f, 100.0f, 2.0f, 3.0f, -50.0f };
+    std::array<float, 5> output{};
+
+    // Exercise
+    filter.process(input, output);
+
+    // Verify
+    expect(that % 0.0f == output[0]);
+    expect(that % 1.0f == output[1]);
+    expect(that % 2.0f == output[2]);
+    expect(that % 3.0f == output[3]);
+    expect(that % 2.0f == output[4]);
+  };
+
+  "biquad low pass passes DC and blocks Nyquist"_test = []() {
+    // Setup
+    const auto coefficients = biquad::low_pass(100.0_Hz, 8.0_kHz);
+    biquad dc_filter(coefficients);
+    biquad nyquist_filter(coefficients);
+    float dc = 0.0f;
+    float nyquist = 0.0f;
+
+    // Exercise
+    for (int i = 0; i < 1000; i++) {
+      dc = dc_filter.process(1.0f);
+      nyquist = nyquist_filter.process(i % 2 == 0 ? 1.0f : -1.0f);
+    }
+
+    // Verify
+    expect(std::abs(dc - 1.0f) < 0.001f);
+    expect(std::abs(nyquist) < 0.001f);
+  };
+
+  "biquad block output matches per sample output"_test = []() {
+    // Setup
+    const auto coefficients = biquad::high_pass(1.0_kHz, 48.0_kHz);
+    biquad per_sample(coefficients);
+    biquad block(coefficients);
+    std::array<float, 16> samples{};
+    for (std::size_t i = 0; i < samples.size(); i++) {
+      samples[i] = std::sin(static_cast<float>(i));
+    }
+    std::array<float, 16> expected{};
+
+    // Exercise
+    for (std::size_t i = 0; i < samples.size(); i++) {
+      expected[i] = per_sample.process(samples[i]);
+    }
+    block.process(samples, samples);
+
+    // Verify
+    expect(expected == samples);
+  };
+
+  "fir_filter applies the impulse response"_test = []() {
+    // Setup
+    fir_filter<3> filter({ 0.5f, 0.25f, 0.125f });
+    std::array<float, 5> samples{ 1.0f, 0.0f, 0.0f, 0.0f, 2.0f };
+
+    // Exercise
+    filter.process(samples, samples);
+
+    // Verify
+    expect(that % 0.5f == samples[0]);
+    expect(that % 0.25f == samples[1]);
+    expect(that % 0.125f == samples[2]);
+    expect(that % 0.0f == samples[3]);
+    expect(that % 1.0f == samples[4]);
+  };
+
+  "fir_filter block output matches per sample output"_test = []() {
+    // Setup
+    const std::array<float, 5> coefficients{ 0.1f, -0.3f, 0.7f, 0.2f, 0.05f };
+    fir_filter<5> per_sample(coefficients);
+    fir_filter<5> block(coefficients);
+    // Longer than fir_filter<5>::block_chunk to cover chunk boundaries
+    std::array<float, 75> samples{};
+    for (std::size_t i = 0; i < samples.size(); i++) {
+      samples[i] = std::sin(static_cast<float>(i));
+    }
+    std::array<float, 75> expected{};
+    const auto input = std::span<float>(samples);
+
+    // Exercise
+    for (std::size_t i = 0; i < samples.size(); i++) {
+      expected[i] = per_sample.process(samples[i]);
+    }
+    // Blocks shorter than the number of taps as well as longer ones
+    block.process(input.first(3), input.first(3));
+    block.process(input.subspan(3, 1), input.subspan(3, 1));
+    block.process(input.subspan(4), input.subspan(4));
+
+    // Verify
+    expect(expected == samples);
+  };
+
+  "filters reset their history"_test = []() {
+    // Setup
+    fir_filter<2> fir({ 1.0f, 1.0f });
+    moving_average<2> average;
+    (void)fir.process(5.0f);
+    (void)average.process(5.0f);
+
+    // Exercise
+    fir.reset();
+    average.reset();
+
+    // Verify
+    expect(that % 1.0f == fir.process(1.0f));
+    expect(that % 0.5f == average.process(1.0f));
+  };
+};
+}  // namespace hal
@@ -14,7 +14,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <libhal/functional.hpp>
+#include <libhal/output_pin.hpp>
+#include <libhal/steady_clock.hpp>
+#include <libhal/timer.hpp>
+#include <libhal/units.hpp>
 
 /**
  * @brief Compares two single floating point values, with in a given error
@@ -27,4 +36,169 @@
  */
 bool compare_floats(float p_first,
                     float p_second,
-                    float p_error_margin = 0.0001f);
\ No newline at end of file
+                    float p_error_margin = 0.0001f);
+
+namespace hal {
+/**
+ * @brief Steady clock that moves forward by a fixed step on every read
+ *
+ * Set `m_ticks` directly to control time from a test.
+ */
+class test_steady_clock : public hal::steady_clock
+{
+public:
+  /**
+   * @brief Construct a new test steady clock
+   *
+   * @param p_step - ticks added to the uptime before each read
+   */
+  explicit test_steady_clock(std::uint64_t p_step = 0)
+    : m_step(p_step)
+  {
+  }
+
+  hertz m_frequency = 1.0_MHz;
+  std::uint64_t m_ticks = 0;
+  std::uint64_t m_step;
+
+private:
+  frequency_t driver_frequency() override
+  {
+    return frequency_t{ .operating_frequency = m_frequency };
+  }
+  uptime_t driver_uptime() override
+  {
+    m_ticks += m_step;
+    return uptime_t{ .ticks = m_ticks };
+  }
+};
+
+/**
+ * @brief Timer that runs its callback in virtual time
+ *
+ * Virtual time is kept in nanoseconds in `m_now` and only moves when the test
+ * fires the callback. `m_latency` is added to the time each callback runs at,
+ * to model the delay between a timer expiring and its interrupt running.
+ * Setting `m_return_error_status` makes scheduling fail.
+ */
+class simulated_timer : public hal::timer
+{
+public:
+  hal::callback<void(void)> m_callback = []() {};
+  hal::time_duration m_delay{};
+  std::int64_t m_now = 0;
+  std::int64_t m_due = 0;
+  std::int64_t m_latency = 0;
+  bool m_is_running = false;
+  bool m_return_error_status = false;
+  int m_callbacks = 0;
+
+  /// Move time to the due time plus latency and run the callback
+  void fire(int p_times = 1)
+  {
+    for (int i = 0; i < p_times && m_is_running; i++) {
+      m_is_running = false;
+      m_now = m_due + m_latency;
+      m_callbacks++;
+      m_callback();
+    }
+  }
+
+  /// Fire every callback due up to and including p_time
+  void run_until(std::int64_t p_time)
+  {
+    while (m_is_running && m_due <= p_time) {
+      fire();
+    }
+  }
+
+  /// Fire every callback due up to p_time, then move time to p_time
+  void advance_to(std::int64_t p_time)
+  {
+    run_until(p_time);
+    m_now = std::max(m_now, p_time);
+  }
+
+private:
+  result<is_running_t> driver_is_running() override
+  {
+    return is_running_t{ .is_running = m_is_running };
+  }
+  result<cancel_t> driver_cancel() override
+  {
+    m_is_running = false;
+    return cancel_t{};
+  }
+  result<schedule_t> driver_schedule(hal::callback<void(void)> p_callback,
+                                     hal::time_duration p_delay) override
+  {
+    if (m_return_error_status) {
+      return hal::new_error();
+    }
+    m_is_running = true;
+    m_callback = p_callback;
+    m_delay = p_delay;
+    m_due = m_now + p_delay.count();
+    return schedule_t{};
+  }
+};
+
+/**
+ * @brief 1 GHz steady clock reading a simulated timer's virtual time
+ *
+ */
+class simulated_clock : public hal::steady_clock
+{
+public:
+  explicit simulated_clock(simulated_timer& p_timer)
+    : m_timer(&p_timer)
+  {
+  }
+
+private:
+  frequency_t driver_frequency() override
+  {
+    return frequency_t{ .operating_frequency = 1.0_GHz };
+  }
+  uptime_t driver_uptime() override
+  {
+    return uptime_t{ .ticks = static_cast<std::uint64_t>(m_timer->m_now) };
+  }
+
+  simulated_timer* m_timer;
+};
+
+/**
+ * @brief Output pin that records every level it is set to
+ *
+ */
+class test_output_pin : public hal::output_pin
+{
+public:
+  settings m_settings{};
+  std::vector<bool> m_levels{};
+  bool m_return_error_status = false;
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    m_settings = p_settings;
+    return success();
+  }
+  result<set_level_t> driver_level(bool p_high) override
+  {
+    if (m_return_error_status) {
+      return hal::new_error();
+    }
+    m_levels.push_back(p_high);
+    return set_level_t{};
+  }
+  result<level_t> driver_level() override
+  {
+    if (m_return_error_status) {
+      return hal::new_error();
+    }
+    return level_t{ .state = m_levels.empty() || m_levels.back() };
+  }
+};
+}  // namespace hal
@@ -36,6 +36,7 @@ public:
   std::span<const hal::byte> m_data_out{};
   std::span<hal::byte> m_data_in{};
   bool m_return_error_status{ false };
+  int m_transaction_count{ 0 };
   std::function<hal::timeout_function> m_timeout = []() -> hal::status {
     return hal::success();
   };
@@ -58,6 +59,7 @@ private:
     hal::function_ref<hal::timeout_function> p_timeout) override
   {
     HAL_CHECK(p_timeout());
+    m_transaction_count++;
     m_address = p_address;
     m_data_out = p_data_out;
     m_data_in = p_data_in;
@@ -68,6 +70,98 @@ private:
     return transaction_t{};
   };
 };
+
+/**
+ * @brief Reference non-blocking i2c implementation on a simulated bus
+ *
+ * Emulates a peripheral that moves one byte per call to
+ * `transaction_state()`, like an interrupt driven driver would move one byte
+ * per interrupt. The simulated device at `device_address` has a register
+ * space addressed by the first byte written to it.
+ */
+class nonblocking_test_i2c : public hal::i2c
+{
+public:
+  static constexpr hal::byte device_address = 0x42;
+  std::array<hal::byte, 16> m_registers{};
+  int m_blocking_transactions{ 0 };
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    m_blocking_transactions++;
+    HAL_CHECK(driver_start_transaction(p_address, p_data_out, p_data_in));
+    while (HAL_CHECK(driver_transaction_state()) == work_state::in_progress) {
+      HAL_CHECK(p_timeout());
+    }
+    return transaction_t{};
+  }
+
+  status driver_start_transaction(hal::byte p_address,
+                                  std::span<const hal::byte> p_data_out,
+                                  std::span<hal::byte> p_data_in) override
+  {
+    if (m_busy) {
+      return hal::new_error(std::errc::device_or_resource_busy);
+    }
+    m_address = p_address;
+    m_data_out = p_data_out;
+    m_data_in = p_data_in;
+    m_address_sent = false;
+    m_busy = true;
+    return success();
+  }
+
+  result<work_state> driver_transaction_state() override
+  {
+    if (!m_busy) {
+      return work_state::finished;
+    }
+
+    if (!m_address_sent) {
+      m_address_sent = true;
+      if (m_address != device_address) {
+        m_busy = false;
+        return hal::new_error(std::errc::no_such_device_or_address);
+      }
+    } else if (!m_data_out.empty()) {
+      if (m_pointer_loaded) {
+        m_registers[m_pointer++ % m_registers.size()] = m_data_out[0];
+      } else {
+        m_pointer = m_data_out[0];
+        m_pointer_loaded = true;
+      }
+      m_data_out = m_data_out.subspan(1);
+    } else if (!m_data_in.empty()) {
+      m_data_in[0] = m_registers[m_pointer++ % m_registers.size()];
+      m_data_in = m_data_in.subspan(1);
+    }
+
+    if (m_address_sent && m_data_out.empty() && m_data_in.empty()) {
+      m_busy = false;
+      m_pointer_loaded = false;
+      return work_state::finished;
+    }
+    return work_state::in_progress;
+  }
+
+  hal::byte m_address{};
+  std::span<const hal::byte> m_data_out{};
+  std::span<hal::byte> m_data_in{};
+  std::size_t m_pointer{ 0 };
+  bool m_pointer_loaded{ false };
+  bool m_address_sent{ false };
+  bool m_busy{ false };
+};
 }  // namespace
 
 void i2c_test()
@@ -105,5 +199,157 @@ void i2c_test()
     expect(!bool{ result1 });
     expect(!bool{ result2 });
   };
+
+  "i2c transactions() default performs each transaction"_test = []() {
+    // Setup
+    test_i2c test;
+    std::array<hal::byte, 2> last_data_in{};
+    const std::array<hal::i2c::transaction_descriptor, 3> list{ {
+      { .address = 0x10, .data_out = expected_data_out },
+      { .address = 0x11,
+        .data_out = expected_data_out,
+        .data_in = expected_data_in,
+        .repeated_start = true },
+      { .address = expected_address, .data_in = last_data_in },
+    } };
+    int timeout_calls = 0;
+    auto counting_timeout = [&timeout_calls]() -> status {
+      timeout_calls++;
+      return success();
+    };
+
+    // Exercise
+    auto result = test.transactions(list, counting_timeout);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 3 == test.m_transaction_count);
+    expect(that % 3 == timeout_calls);
+    expect(that % expected_address == test.m_address);
+    expect(that % last_data_in.data() == test.m_data_in.data());
+    expect(test.m_data_out.empty());
+  };
+
+  "i2c transactions() stops on first error"_test = []() {
+    // Setup
+    test_i2c test;
+    test.m_return_error_status = true;
+    const std::array<hal::i2c::transaction_descriptor, 2> list{ {
+      { .address = 0x10, .data_out = expected_data_out },
+      { .address = 0x11, .data_out = expected_data_out },
+    } };
+
+    // Exercise
+    auto result = test.transactions(list, expected_timeout);
+
+    // Verify
+    expect(!bool{ result });
+    expect(that % 1 == test.m_transaction_count);
+    expect(that % 0x10 == test.m_address);
+  };
+
+  "i2c start_transaction() default is not supported"_test = []() {
+    // Setup
+    test_i2c test;
+    auto worker = test.transaction_worker(
+      expected_address, expected_data_out, expected_data_in);
+
+    // Exercise
+    bool caught_errc = false;
+    auto result1 = hal::attempt(
+      [&worker]() -> status {
+        HAL_CHECK(worker());
+        return success();
+      },
+      [&caught_errc](
+        hal::match<std::errc, std::errc::operation_not_supported>) -> status {
+        caught_errc = true;
+        return success();
+      });
+    auto result2 = worker();
+
+    // Verify
+    expect(bool{ result1 });
+    expect(that % true == caught_errc);
+    expect(bool{ result2 });
+    expect(work_state::failed == result2.value());
+    expect(that % 0 == test.m_transaction_count);
+  };
+
+  "i2c transaction_worker() reports failure once"_test = []() {
+    // Setup
+    nonblocking_test_i2c test;
+    auto worker = test.transaction_worker(
+      0x01, expected_data_out, std::span<hal::byte>{});
+
+    // Exercise
+    auto result1 = worker();
+    auto result2 = worker();
+
+    // Verify
+    expect(!bool{ result1 });
+    expect(bool{ result2 });
+    expect(work_state::failed == result2.value());
+  };
+
+  "i2c transaction_worker() interleaves multiple buses"_test = []() {
+    // Setup
+    nonblocking_test_i2c bus_a;
+    nonblocking_test_i2c bus_b;
+    bus_a.m_registers[4] = 0xAA;
+    bus_a.m_registers[5] = 0xBB;
+    bus_b.m_registers[0] = 0x11;
+    const std::array<hal::byte, 1> register_4{ 4 };
+    const std::array<hal::byte, 3> write_b{ 8, 0x55, 0x66 };
+    std::array<hal::byte, 2> data_in_a{};
+    auto worker_a = bus_a.transaction_worker(
+      nonblocking_test_i2c::device_address, register_4, data_in_a);
+    auto worker_b = bus_b.transaction_worker(
+      nonblocking_test_i2c::device_address, write_b, std::span<hal::byte>{});
+    int polls = 0;
+
+    // Exercise
+    bool a_done = false;
+    bool b_done = false;
+    while (!a_done || !b_done) {
+      polls++;
+      a_done = hal::terminated(worker_a().value());
+      b_done = hal::terminated(worker_b().value());
+    }
+
+    // Verify
+    expect(work_state::finished == worker_a().value());
+    expect(work_state::finished == worker_b().value());
+    expect(that % 0xAA == data_in_a[0]);
+    expect(that % 0xBB == data_in_a[1]);
+    expect(that % 0x55 == bus_b.m_registers[8]);
+    expect(that % 0x66 == bus_b.m_registers[9]);
+    // address + 3 bytes on bus b is the longest of the two transactions
+    expect(that % 4 == polls);
+    expect(that % 0 == bus_a.m_blocking_transactions);
+    expect(that % 0 == bus_b.m_blocking_transactions);
+  };
+
+  "i2c transaction_worker() with hal::try_until()"_test = []() {
+    // Setup
+    nonblocking_test_i2c test;
+    test.m_registers[0] = 0x12;
+    const std::array<hal::byte, 1> register_0{ 0 };
+    std::array<hal::byte, 1> data_in{};
+    auto worker = test.transaction_worker(
+      nonblocking_test_i2c::device_address, register_0, data_in);
+    auto missing_device = test.transaction_worker(
+      0x01, register_0, std::span<hal::byte>{});
+
+    // Exercise
+    auto result = hal::try_until(worker, hal::never_timeout());
+    auto missing_result = hal::try_until(missing_device, hal::never_timeout());
+
+    // Verify
+    expect(bool{ result });
+    expect(work_state::finished == result.value());
+    expect(that % 0x12 == data_in[0]);
+    expect(!bool{ missing_result });
+  };
 };
 }  // namespace hal
@@ -0,0 +1,400 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/i2c_recording.hpp>
+
+#include <array>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+constexpr hal::byte sensor_address = 0x48;
+
+/**
+ * @brief Temperature sensor like device that returns an incrementing counter
+ *
+ * Non-blocking transactions take one extra call to `transaction_state()`.
+ */
+class sensor_i2c : public hal::i2c
+{
+public:
+  hal::byte m_counter = 0;
+  int m_transactions = 0;
+  int m_lists = 0;
+  int m_started = 0;
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte>,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function>) override
+  {
+    m_transactions++;
+    if (p_address != sensor_address) {
+      return hal::new_error(std::errc::no_such_device_or_address);
+    }
+    for (auto& value : p_data_in) {
+      value = m_counter++;
+    }
+    return transaction_t{};
+  }
+
+  result<transaction_t> driver_transactions(
+    std::span<const transaction_descriptor> p_transactions,
+    hal::function_ref<hal::timeout_function> p_timeout) override
+  {
+    m_lists++;
+    for (const auto& transaction : p_transactions) {
+      HAL_CHECK(driver_transaction(transaction.address,
+                                   transaction.data_out,
+                                   transaction.data_in,
+                                   p_timeout));
+    }
+    return transaction_t{};
+  }
+
+  status driver_start_transaction(hal::byte p_address,
+                                  std::span<const hal::byte>,
+                                  std::span<hal::byte> p_data_in) override
+  {
+    m_started++;
+    m_address = p_address;
+    m_data_in = p_data_in;
+    m_polls = 0;
+    return success();
+  }
+
+  result<work_state> driver_transaction_state() override
+  {
+    if (++m_polls < 2) {
+      return work_state::in_progress;
+    }
+    HAL_CHECK(driver_transaction(
+      m_address, {}, m_data_in, hal::never_timeout()));
+    return work_state::finished;
+  }
+
+  hal::byte m_address = 0;
+  std::span<hal::byte> m_data_in{};
+  int m_polls = 0;
+};
+
+/// Reads a two byte temperature register, like a device driver would
+result<hal::byte> read_sensor(hal::i2c& p_i2c)
+{
+  const std::array<hal::byte, 1> temperature_register{ 0x00 };
+  std::array<hal::byte, 2> data{};
+  HAL_CHECK(p_i2c.transaction(
+    sensor_address, temperature_register, data, hal::never_timeout()));
+  return static_cast<hal::byte>(data[0] + data[1]);
+}
+}  // namespace
+
+void i2c_recording_test()
+{
+  using namespace boost::ut;
+
+  "i2c_recorder records transactions in compact format"_test = []() {
+    // Setup
+    sensor_i2c sensor;
+    test_steady_clock clock(200);
+    std::array<hal::byte, 64> log{};
+    i2c_recorder recorder(sensor, clock, log);
+
+    // Exercise
+    auto result = read_sensor(recorder);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 1 == result.value());
+    constexpr std::array<hal::byte, 10> expected{
+      sensor_address, 0, 1, 2, 0xC8, 0x01, 0x00, 0x00, 0x01,
+    };
+    const auto recording = recorder.recording();
+    expect(that % 9U == recording.size());
+    expect(std::equal(recording.begin(), recording.end(), expected.begin()));
+    expect(that % false == recorder.overflow());
+  };
+
+  "i2c_replay reproduces recorded transactions"_test = []() {
+    // Setup
+    sensor_i2c sensor;
+    test_steady_clock clock(200);
+    std::array<hal::byte, 128> log{};
+    i2c_recorder recorder(sensor, clock, log);
+    std::array<hal::byte, 3> recorded_values{};
+    for (auto& value : recorded_values) {
+      value = read_sensor(recorder).value();
+    }
+    i2c_replay replay(recorder.recording());
+
+    // Exercise
+    std::array<hal::byte, 3> replayed_values{};
+    for (auto& value : replayed_values) {
+      value = read_sensor(replay).value();
+    }
+    const bool finished = replay.finished();
+    auto exhausted = read_sensor(replay);
+    replay.rewind();
+    auto after_rewind = read_sensor(replay);
+
+    // Verify
+    expect(recorded_values == replayed_values);
+    expect(that % true == finished);
+    expect(!bool{ exhausted });
+    expect(that % recorded_values[0] == after_rewind.value());
+    expect(that % 1U == replay.replayed());
+    expect(that % 3 == sensor.m_transactions);
+  };
+
+  "i2c_replay reproduces recorded errors"_test = []() {
+    // Setup
+    sensor_i2c sensor;
+    test_steady_clock clock(200);
+    std::array<hal::byte, 64> log{};
+    i2c_recorder recorder(sensor, clock, log);
+    const std::array<hal::byte, 1> data{ 0 };
+    (void)recorder.transaction(
+      0x10, data, std::span<hal::byte>{}, hal::never_timeout());
+    i2c_replay replay(recorder.recording());
+    bool caught_errc = false;
+
+    // Exercise
+    auto result = hal::attempt(
+      [&replay, &data]() -> status {
+        HAL_CHECK(replay.transaction(
+          0x10, data, std::span<hal::byte>{}, hal::never_timeout()));
+        return success();
+      },
+      [&caught_errc](
+        hal::match<std::errc, std::errc::no_such_device_or_address>) -> status {
+        caught_errc = true;
+        return success();
+      });
+
+    // Verify
+    expect(bool{ result });
+    expect(that % true == caught_errc);
+    expect(that % 1U == replay.replayed());
+  };
+
+  "i2c_replay rejects mismatched transactions"_test = []() {
+    // Setup
+    sensor_i2c sensor;
+    test_steady_clock clock(200);
+    std::array<hal::byte, 64> log{};
+    i2c_recorder recorder(sensor, clock, log);
+    (void)read_sensor(recorder);
+    i2c_replay replay(recorder.recording());
+    const std::array<hal::byte, 1> other_register{ 0x01 };
+    std::array<hal::byte, 2> data{};
+
+    // Exercise
+    auto wrong_address = replay.transaction(
+      0x49, other_register, data, hal::never_timeout());
+    auto wrong_data = replay.transaction(
+      sensor_address, other_register, data, hal::never_timeout());
+
+    // Verify
+    expect(!bool{ wrong_address });
+    expect(!bool{ wrong_data });
+    expect(that % 0U == replay.replayed());
+  };
+
+  "i2c_recorder stops recording when log is full"_test = []() {
+    // Setup
+    sensor_i2c sensor;
+    test_steady_clock clock(200);
+    std::array<hal::byte, 12> log{};
+    i2c_recorder recorder(sensor, clock, log);
+
+    // Exercise
+    auto result1 = read_sensor(recorder);
+    auto result2 = read_sensor(recorder);
+
+    // Verify
+    expect(bool{ result1 });
+    expect(bool{ result2 });
+    expect(that % true == recorder.overflow());
+    expect(that % 9U == recorder.recording().size());
+    expect(that % 2 == sensor.m_transactions);
+  };
+
+  "i2c_recorder forwards and records transaction lists"_test = []() {
+    // Setup
+    sensor_i2c sensor;
+    test_steady_clock clock(200);
+    std::array<hal::byte, 64> log{};
+    i2c_recorder recorder(sensor, clock, log);
+    const std::array<hal::byte, 1> register_0{ 0x00 };
+    std::array<hal::byte, 1> first{};
+    std::array<hal::byte, 2> second{};
+    const std::array<i2c::transaction_descriptor, 2> list{ {
+      { .address = sensor_address,
+        .data_out = register_0,
+        .data_in = first,
+        .repeated_start = true },
+      { .address = sensor_address, .data_in = second },
+    } };
+
+    // Exercise
+    auto record_result = recorder.transactions(list, hal::never_timeout());
+    const std::array<hal::byte, 3> recorded{ first[0], second[0], second[1] };
+    first = {};
+    second = {};
+    i2c_replay replay(recorder.recording());
+    auto replay_result = replay.transactions(list, hal::never_timeout());
+
+    // Verify
+    expect(bool{ record_result });
+    expect(bool{ replay_result });
+    expect(that % 1 == sensor.m_lists);
+    expect(that % 2U == replay.replayed());
+    expect(that % recorded[0] == first[0]);
+    expect(that % recorded[1] == second[0]);
+    expect(that % recorded[2] == second[1]);
+    expect(that % true == replay.finished());
+  };
+
+  "i2c_recorder records a failed list as one list record"_test = []() {
+    // Setup
+    sensor_i2c sensor;
+    test_steady_clock clock(200);
+    std::array<hal::byte, 64> log{};
+    i2c_recorder recorder(sensor, clock, log);
+    const std::array<hal::byte, 1> register_0{ 0x00 };
+    std::array<hal::byte, 1> first{};
+    std::array<hal::byte, 1> third{ 0xAA };
+    // The second transaction addresses a missing device, so the third never
+    // reaches the bus
+    const std::array<i2c::transaction_descriptor, 3> list{ {
+      { .address = sensor_address, .data_out = register_0 },
+      { .address = 0x10, .data_out = register_0 },
+      { .address = sensor_address, .data_in = third },
+    } };
+    const std::array<i2c::transaction_descriptor, 3> replayed_list{ {
+      list[0],
+      list[1],
+      { .address = sensor_address, .data_in = first },
+    } };
+    bool caught_errc = false;
+
+    // Exercise
+    auto record_result = recorder.transactions(list, hal::never_timeout());
+    i2c_replay replay(recorder.recording());
+    auto replay_result = hal::attempt(
+      [&replay, &replayed_list]() -> status {
+        HAL_CHECK(replay.transactions(replayed_list, hal::never_timeout()));
+        return success();
+      },
+      [&caught_errc](
+        hal::match<std::errc, std::errc::no_such_device_or_address>) -> status {
+        caught_errc = true;
+        return success();
+      });
+
+    // Verify
+    expect(!bool{ record_result });
+    expect(that % 2 == sensor.m_transactions);
+    constexpr auto no_device =
+      static_cast<hal::byte>(std::errc::no_such_device_or_address);
+    // List header with a duration of 200 ticks, then three entries
+    constexpr std::array<hal::byte, 17> expected{
+      0x00, i2c_record_list, 3, no_device, 0xC8, 0x01,
+      sensor_address, 1, 0, 0x00,
+      0x10, 1, 0, 0x00,
+      sensor_address, 0, 1,
+    };
+    const auto recording = recorder.recording();
+    expect(that % 17U == recording.size());
+    expect(std::equal(recording.begin(), recording.end(), expected.begin()));
+    expect(bool{ replay_result });
+    expect(that % true == caught_errc);
+    expect(that % 3U == replay.replayed());
+    expect(that % 0 == first[0]);
+    expect(that % true == replay.finished());
+  };
+
+  "i2c_replay rejects a failed list that does not match"_test = []() {
+    // Setup
+    sensor_i2c sensor;
+    test_steady_clock clock(200);
+    std::array<hal::byte, 64> log{};
+    i2c_recorder recorder(sensor, clock, log);
+    const std::array<hal::byte, 1> register_0{ 0x00 };
+    const std::array<i2c::transaction_descriptor, 2> list{ {
+      { .address = 0x10, .data_out = register_0 },
+      { .address = sensor_address, .data_out = register_0 },
+    } };
+    (void)recorder.transactions(list, hal::never_timeout());
+    i2c_replay replay(recorder.recording());
+
+    // Exercise
+    auto shorter = replay.transactions(std::span(list).first(1),
+                                       hal::never_timeout());
+    auto single = replay.transaction(
+      0x10, register_0, std::span<hal::byte>{}, hal::never_timeout());
+
+    // Verify
+    expect(!bool{ shorter });
+    expect(!bool{ single });
+    expect(that % 0U == replay.replayed());
+  };
+
+  "i2c_recorder forwards and records non-blocking transactions"_test = []() {
+    // Setup
+    sensor_i2c sensor;
+    sensor.m_counter = 0x40;
+    test_steady_clock clock(200);
+    std::array<hal::byte, 64> log{};
+    i2c_recorder recorder(sensor, clock, log);
+    std::array<hal::byte, 1> data{};
+    auto worker = recorder.transaction_worker(sensor_address, {}, data);
+
+    // Exercise
+    auto in_progress = worker();
+    const auto size_in_progress = recorder.recording().size();
+    auto finished = worker();
+    data[0] = 0;
+    i2c_replay replay(recorder.recording());
+    auto replay_worker = replay.transaction_worker(sensor_address, {}, data);
+    auto replayed = hal::try_until(replay_worker, hal::never_timeout());
+
+    // Verify
+    expect(work_state::in_progress == in_progress.value());
+    expect(work_state::finished == finished.value());
+    expect(that % 0U == size_in_progress);
+    expect(that % 1 == sensor.m_started);
+    expect(that % 1 == sensor.m_transactions);
+    // Started at 200 and recorded at 400, a duration of 200 ticks
+    constexpr std::array<hal::byte, 7> expected{
+      sensor_address, 0, 0, 1, 0xC8, 0x01, 0x40,
+    };
+    const auto recording = recorder.recording();
+    expect(that % 7U == recording.size());
+    expect(std::equal(expected.begin(), expected.end(), recording.begin()));
+    expect(bool{ replayed });
+    expect(that % 0x40 == data[0]);
+  };
+}
+}  // namespace hal
@@ -0,0 +1,169 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/input_port.hpp>
+
+#include <array>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class test_input_port : public hal::input_port
+{
+public:
+  settings m_settings{};
+  std::uint32_t m_state = 0b1001'0110;
+  bool m_return_error_status{ false };
+
+  ~test_input_port() override = default;
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    m_settings = p_settings;
+    return success();
+  }
+  std::size_t driver_width() override
+  {
+    return 8;
+  }
+  result<level_t> driver_level() override
+  {
+    if (m_return_error_status) {
+      return hal::new_error();
+    }
+    return level_t{ .state = m_state };
+  }
+};
+
+class test_input_pin : public hal::input_pin
+{
+public:
+  settings m_settings{};
+  bool m_level = false;
+  bool m_return_error_status{ false };
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    m_settings = p_settings;
+    return success();
+  }
+  result<level_t> driver_level() override
+  {
+    if (m_return_error_status) {
+      return hal::new_error();
+    }
+    return level_t{ .state = m_level };
+  }
+};
+}  // namespace
+
+void input_port_test()
+{
+  using namespace boost::ut;
+
+  "input_port interface test"_test = []() {
+    // Setup
+    test_input_port test;
+
+    // Exercise
+    auto configure_result =
+      test.configure({ .resistor = pin_resistor::pull_down });
+    auto width = test.width();
+    auto result = test.level();
+
+    // Verify
+    expect(bool{ configure_result });
+    expect(pin_resistor::pull_down == test.m_settings.resistor);
+    expect(that % std::size_t{ 8 } == width);
+    expect(bool{ result });
+    expect(that % 0b1001'0110U == result.value().state);
+  };
+
+  "input_port errors test"_test = []() {
+    // Setup
+    test_input_port test;
+    test.m_return_error_status = true;
+
+    // Exercise
+    auto result = test.level();
+
+    // Verify
+    expect(!bool{ result });
+  };
+
+  "input_pin_port packs pin levels into bits"_test = []() {
+    // Setup
+    std::array<test_input_pin, 4> pins{};
+    std::array<hal::input_pin*, 4> pointers{
+      &pins[0], &pins[1], &pins[2], &pins[3]
+    };
+    auto port = input_pin_port::create(pointers).value();
+    pins[0].m_level = true;
+    pins[3].m_level = true;
+
+    // Exercise
+    auto result = port.level();
+
+    // Verify
+    expect(that % std::size_t{ 4 } == port.width());
+    expect(bool{ result });
+    expect(that % 0b1001U == result.value().state);
+  };
+
+  "input_pin_port configures every pin"_test = []() {
+    // Setup
+    std::array<test_input_pin, 2> pins{};
+    std::array<hal::input_pin*, 2> pointers{ &pins[0], &pins[1] };
+    auto port = input_pin_port::create(pointers).value();
+
+    // Exercise
+    auto result = port.configure({ .resistor = pin_resistor::none });
+
+    // Verify
+    expect(bool{ result });
+    expect(pin_resistor::none == pins[0].m_settings.resistor);
+    expect(pin_resistor::none == pins[1].m_settings.resistor);
+  };
+
+  "input_pin_port reports pin errors"_test = []() {
+    // Setup
+    std::array<test_input_pin, 2> pins{};
+    std::array<hal::input_pin*, 2> pointers{ &pins[0], &pins[1] };
+    auto port = input_pin_port::create(pointers).value();
+    pins[1].m_return_error_status = true;
+
+    // Exercise
+    auto result = port.level();
+
+    // Verify
+    expect(!bool{ result });
+  };
+
+  "input_pin_port rejects more than 32 pins"_test = []() {
+    // Setup
+    test_input_pin pin;
+    std::array<hal::input_pin*, input_port::max_width + 1> pointers{};
+    pointers.fill(&pin);
+
+    // Exercise
+    auto result = input_pin_port::create(pointers);
+
+    // Verify
+    expect(!bool{ result });
+  };
+};
+}  // namespace hal
@@ -14,17 +14,39 @@
 
 namespace hal {
 extern void adc_test();
+extern void adc_scan_test();
+extern void filter_test();
+extern void cic_decimator_test();
+extern void bit_bang_i2c_test();
 extern void can_test();
 extern void dac_test();
+extern void dac_stream_test();
+extern void soft_dac_stream_test();
+extern void waveform_test();
 extern void error_test();
 extern void i2c_test();
+extern void i2c_recording_test();
 extern void input_pin_test();
+extern void input_port_test();
 extern void interrupt_pin_test();
+extern void debouncer_test();
+extern void edge_capture_test();
 extern void motor_test();
 extern void output_pin_test();
+extern void output_port_test();
 extern void pwm_test();
+extern void pwm_group_test();
+extern void soft_pwm_test();
+extern void q16_test();
+extern void register_cache_test();
 extern void serial_test();
+extern void shared_i2c_test();
+extern void simulated_i2c_test();
 extern void spi_test();
+extern void spi_device_test();
+extern void bit_bang_spi_test();
+extern void spi_flash_test();
+extern void trace_test();
 extern void steady_clock_test();
 extern void timeout_test();
 extern void timer_test();
@@ -38,17 +60,39 @@ extern void current_sensor_test();
 int main()
 {
   hal::adc_test();
+  hal::adc_scan_test();
+  hal::filter_test();
+  hal::cic_decimator_test();
   hal::can_test();
   hal::dac_test();
+  hal::dac_stream_test();
+  hal::soft_dac_stream_test();
+  hal::waveform_test();
   hal::error_test();
   hal::i2c_test();
+  hal::bit_bang_i2c_test();
+  hal::i2c_recording_test();
   hal::input_pin_test();
+  hal::input_port_test();
   hal::interrupt_pin_test();
+  hal::debouncer_test();
+  hal::edge_capture_test();
   hal::motor_test();
   hal::output_pin_test();
+  hal::output_port_test();
   hal::pwm_test();
+  hal::pwm_group_test();
+  hal::soft_pwm_test();
+  hal::q16_test();
+  hal::register_cache_test();
   hal::serial_test();
+  hal::shared_i2c_test();
+  hal::simulated_i2c_test();
   hal::spi_test();
+  hal::spi_device_test();
+  hal::bit_bang_spi_test();
+  hal::spi_flash_test();
+  hal::trace_test();
   hal::steady_clock_test();
   hal::servo_test();
   hal::timeout_test();
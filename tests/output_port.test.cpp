@@ -0,0 +1,209 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/output_port.hpp>
+
+#include <array>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+class test_output_port : public hal::output_port
+{
+public:
+  settings m_settings{};
+  std::uint32_t m_state = 0;
+  int m_level_calls = 0;
+  bool m_return_error_status{ false };
+
+  ~test_output_port() override = default;
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    m_settings = p_settings;
+    return success();
+  }
+  std::size_t driver_width() override
+  {
+    return 8;
+  }
+  result<set_level_t> driver_level(std::uint32_t p_levels,
+                                   std::uint32_t p_mask) override
+  {
+    m_level_calls++;
+    if (m_return_error_status) {
+      return hal::new_error();
+    }
+    m_state = ((m_state & ~p_mask) | (p_levels & p_mask)) & 0xFF;
+    return set_level_t{};
+  }
+  result<level_t> driver_level() override
+  {
+    if (m_return_error_status) {
+      return hal::new_error();
+    }
+    return level_t{ .state = m_state };
+  }
+};
+}  // namespace
+
+void output_port_test()
+{
+  using namespace boost::ut;
+
+  "output_port interface test"_test = []() {
+    // Setup
+    test_output_port test;
+    constexpr output_port::settings expected_settings{
+      .resistor = pin_resistor::pull_up,
+      .open_drain = true,
+    };
+
+    // Exercise
+    auto configure_result = test.configure(expected_settings);
+    auto width = test.width();
+    auto result1 = test.level(0b1010'1010);
+    auto result2 = test.set(0b0000'0101);
+    auto result3 = test.clear(0b1000'0000);
+    auto result4 = test.level(0b0000'0000, 0b0000'1100);
+    auto result5 = test.level();
+
+    // Verify
+    expect(bool{ configure_result });
+    expect(expected_settings.resistor == test.m_settings.resistor);
+    expect(that % true == test.m_settings.open_drain);
+    expect(that % std::size_t{ 8 } == width);
+    expect(bool{ result1 });
+    expect(bool{ result2 });
+    expect(bool{ result3 });
+    expect(bool{ result4 });
+    expect(bool{ result5 });
+    expect(that % 0b0010'0011U == test.m_state);
+    expect(that % 0b0010'0011U == result5.value().state);
+  };
+
+  "output_port default toggle"_test = []() {
+    // Setup
+    test_output_port test;
+    test.m_state = 0b1111'0000;
+
+    // Exercise
+    auto result = test.toggle(0b0011'1100);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 0b1100'1100U == test.m_state);
+    expect(that % 1 == test.m_level_calls);
+  };
+
+  "output_port errors test"_test = []() {
+    // Setup
+    test_output_port test;
+    test.m_return_error_status = true;
+
+    // Exercise
+    auto result1 = test.level(0xFF);
+    auto result2 = test.set(0x01);
+    auto result3 = test.clear(0x01);
+    auto result4 = test.toggle(0x01);
+    auto result5 = test.level();
+
+    // Verify
+    expect(!bool{ result1 });
+    expect(!bool{ result2 });
+    expect(!bool{ result3 });
+    expect(!bool{ result4 });
+    expect(!bool{ result5 });
+    expect(that % 3 == test.m_level_calls);
+  };
+
+  "output_pin_port writes only masked pins"_test = []() {
+    // Setup
+    std::array<test_output_pin, 4> pins{};
+    std::array<hal::output_pin*, 4> pointers{
+      &pins[0], &pins[1], &pins[2], &pins[3]
+    };
+    auto port = output_pin_port::create(pointers).value();
+
+    // Exercise
+    auto result1 = port.level(0b0101);
+    auto result2 = port.toggle(0b0011);
+    auto result3 = port.level();
+
+    // Verify
+    expect(that % std::size_t{ 4 } == port.width());
+    expect(bool{ result1 });
+    expect(bool{ result2 });
+    expect(that % 0b0110U == result3.value().state);
+    expect(pins[0].m_levels == std::vector<bool>{ true, false });
+    expect(pins[1].m_levels == std::vector<bool>{ false, true });
+    expect(pins[2].m_levels == std::vector<bool>{ true });
+    expect(pins[3].m_levels == std::vector<bool>{ false });
+  };
+
+  "output_pin_port configures every pin"_test = []() {
+    // Setup
+    std::array<test_output_pin, 2> pins{};
+    std::array<hal::output_pin*, 2> pointers{ &pins[0], &pins[1] };
+    auto port = output_pin_port::create(pointers).value();
+
+    // Exercise
+    auto result = port.configure({
+      .resistor = pin_resistor::pull_down,
+      .open_drain = true,
+    });
+
+    // Verify
+    expect(bool{ result });
+    for (const auto& pin : pins) {
+      expect(pin_resistor::pull_down == pin.m_settings.resistor);
+      expect(that % true == pin.m_settings.open_drain);
+    }
+  };
+
+  "output_pin_port stops at the first error"_test = []() {
+    // Setup
+    std::array<test_output_pin, 3> pins{};
+    std::array<hal::output_pin*, 3> pointers{ &pins[0], &pins[1], &pins[2] };
+    auto port = output_pin_port::create(pointers).value();
+    pins[1].m_return_error_status = true;
+
+    // Exercise
+    auto result = port.set(0b111);
+
+    // Verify
+    expect(!bool{ result });
+    expect(pins[0].m_levels == std::vector<bool>{ true });
+    expect(that % 0U == pins[2].m_levels.size());
+  };
+
+  "output_pin_port rejects more than 32 pins"_test = []() {
+    // Setup
+    test_output_pin pin;
+    std::array<hal::output_pin*, output_port::max_width + 1> pointers{};
+    pointers.fill(&pin);
+
+    // Exercise
+    auto result = output_pin_port::create(pointers);
+
+    // Verify
+    expect(!bool{ result });
+  };
+};
+}  // namespace hal
@@ -81,5 +81,17 @@ void pwm_test()
     expect(!bool{ result1 });
     expect(!bool{ result2 });
   };
+
+  "pwm::duty_cycle(q16) defaults to the float implementation"_test = []() {
+    // Setup
+    test_pwm test;
+
+    // Exercise
+    auto result = test.duty_cycle(q16::from_float(expected_duty_cycle));
+
+    // Verify
+    expect(bool{ result });
+    expect(that % expected_duty_cycle == test.m_duty_cycle);
+  };
 };
 }  // namespace hal
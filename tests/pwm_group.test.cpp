@@ -0,0 +1,110 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/pwm_group.hpp>
+
+#include <array>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+class test_pwm : public hal::pwm
+{
+public:
+  hertz m_frequency{};
+  float m_duty_cycle{};
+  bool m_return_error_status{ false };
+
+private:
+  result<frequency_t> driver_frequency(hertz p_frequency) override
+  {
+    m_frequency = p_frequency;
+    return frequency_t{};
+  }
+  result<duty_cycle_t> driver_duty_cycle(float p_duty_cycle) override
+  {
+    if (m_return_error_status) {
+      return hal::new_error(std::errc::io_error);
+    }
+    m_duty_cycle = p_duty_cycle;
+    return duty_cycle_t{};
+  }
+};
+}  // namespace
+
+void pwm_group_test()
+{
+  using namespace boost::ut;
+
+  "sequential_pwm_group applies each duty cycle"_test = []() {
+    // Setup
+    std::array<test_pwm, 3> phases{};
+    const std::array<hal::pwm*, 3> channels{ &phases[0],
+                                             &phases[1],
+                                             &phases[2] };
+    sequential_pwm_group group(channels);
+    const std::array<q16, 3> duty_cycles{ q16::from_float(0.25f),
+                                          q16::from_float(0.5f),
+                                          q16::from_float(0.75f) };
+
+    // Exercise
+    auto result = group.update(duty_cycles);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 3U == group.channels());
+    expect(that % 0.25f == phases[0].m_duty_cycle);
+    expect(that % 0.5f == phases[1].m_duty_cycle);
+    expect(that % 0.75f == phases[2].m_duty_cycle);
+    expect(that % 0.0f == phases[0].m_frequency);
+  };
+
+  "sequential_pwm_group applies the frequency to every channel"_test = []() {
+    // Setup
+    std::array<test_pwm, 2> outputs{};
+    const std::array<hal::pwm*, 2> channels{ &outputs[0], &outputs[1] };
+    sequential_pwm_group group(channels);
+    const std::array<q16, 1> duty_cycles{ q16::from_float(0.5f) };
+
+    // Exercise
+    auto result = group.update(duty_cycles, 20.0_kHz);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 20.0_kHz == outputs[0].m_frequency);
+    expect(that % 20.0_kHz == outputs[1].m_frequency);
+    expect(that % 0.5f == outputs[0].m_duty_cycle);
+    expect(that % 0.0f == outputs[1].m_duty_cycle);
+  };
+
+  "sequential_pwm_group rejects extra duty cycles and errors"_test = []() {
+    // Setup
+    std::array<test_pwm, 2> outputs{};
+    const std::array<hal::pwm*, 2> channels{ &outputs[0], &outputs[1] };
+    sequential_pwm_group group(channels);
+    const std::array<q16, 3> too_many{};
+    const std::array<q16, 2> duty_cycles{};
+    outputs[1].m_return_error_status = true;
+
+    // Exercise
+    auto too_many_result = group.update(too_many);
+    auto error_result = group.update(duty_cycles);
+
+    // Verify
+    expect(!bool{ too_many_result });
+    expect(!bool{ error_result });
+  };
+};
+}  // namespace hal
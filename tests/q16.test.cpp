@@ -0,0 +1,65 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/q16.hpp>
+
+#include <limits>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+void q16_test()
+{
+  using namespace boost::ut;
+
+  "q16::from_float() saturates"_test = []() {
+    // Exercise
+    constexpr auto half = q16::from_float(0.5f);
+    constexpr auto negative = q16::from_float(-0.5f);
+    constexpr auto above_one = q16::from_float(2.0f);
+    const auto not_a_number =
+      q16::from_float(std::numeric_limits<float>::quiet_NaN());
+
+    // Verify
+    expect(that % 0x8000U == half.raw());
+    expect(that % 0U == negative.raw());
+    expect(that % q16::raw_one == above_one.raw());
+    expect(that % 0U == not_a_number.raw());
+    expect(that % 0.5f == half.to_float());
+  };
+
+  "q16::from_raw() and q16::from_ratio() saturate"_test = []() {
+    // Exercise
+    constexpr auto raw = q16::from_raw(q16::raw_one + 1);
+    constexpr auto third = q16::from_ratio(1, 3);
+    constexpr auto over = q16::from_ratio(5, 3);
+    constexpr auto divide_by_zero = q16::from_ratio(0, 0);
+
+    // Verify
+    expect(that % q16::raw_one == raw.raw());
+    expect(that % 21845U == third.raw());
+    expect(that % q16::raw_one == over.raw());
+    expect(that % q16::raw_one == divide_by_zero.raw());
+  };
+
+  "q16::scale() converts to a register count"_test = []() {
+    // Exercise + Verify
+    expect(that % 0U == q16().scale(1000));
+    expect(that % 1000U == q16::from_raw(q16::raw_one).scale(1000));
+    expect(that % 333U == q16::from_ratio(1, 3).scale(1000));
+    expect(that % 4095U == q16::from_raw(q16::raw_one).scale(4095));
+    expect(q16::from_ratio(1, 4) < q16::from_ratio(1, 2));
+  };
+};
+}  // namespace hal
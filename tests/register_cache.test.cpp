@@ -0,0 +1,352 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/register_cache.hpp>
+
+#include <vector>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+constexpr hal::byte device_address = 0x68;
+
+constexpr auto test_map = []() {
+  hal::register_map<8> map{};
+  map.fill(register_access::cacheable);
+  map[0] = register_access::volatile_register;
+  map[7] = register_access::write_only;
+  return map;
+}();
+
+/// i2c device with 8 auto incrementing registers
+class register_device_i2c : public hal::i2c
+{
+public:
+  std::array<hal::byte, 8> m_registers{};
+  std::vector<std::vector<hal::byte>> m_writes{};
+  std::vector<std::size_t> m_read_lengths{};
+  int m_transactions = 0;
+  bool m_return_error_status = false;
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte> p_data_out,
+    std::span<hal::byte> p_data_in,
+    hal::function_ref<hal::timeout_function>) override
+  {
+    m_transactions++;
+    if (m_return_error_status || p_address != device_address) {
+      return hal::new_error(std::errc::no_such_device_or_address);
+    }
+    std::size_t pointer = p_data_out[0];
+    if (p_data_in.empty()) {
+      m_writes.emplace_back(p_data_out.begin(), p_data_out.end());
+      for (auto value : p_data_out.subspan(1)) {
+        m_registers[pointer++] = value;
+      }
+    }
+    if (!p_data_in.empty()) {
+      m_read_lengths.push_back(p_data_in.size());
+    }
+    for (auto& value : p_data_in) {
+      value = m_registers[pointer++];
+    }
+    return transaction_t{};
+  }
+};
+
+class test_spi : public hal::spi
+{
+public:
+  std::vector<std::vector<hal::byte>> m_transfers{};
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte> p_data_out,
+                                     std::span<hal::byte> p_data_in,
+                                     hal::byte) override
+  {
+    m_transfers.emplace_back(p_data_out.begin(), p_data_out.end());
+    std::fill(p_data_in.begin(), p_data_in.end(), hal::byte{ 0x5A });
+    return transfer_t{};
+  }
+};
+
+using test_cache = register_cache<test_map, i2c_register_bus>;
+}  // namespace
+
+void register_cache_test()
+{
+  using namespace boost::ut;
+
+  "register_cache serves repeated reads from cache"_test = []() {
+    // Setup
+    register_device_i2c device;
+    device.m_registers[3] = 0x33;
+    test_cache cache(i2c_register_bus(device, device_address));
+
+    // Exercise
+    auto first = cache.read(3);
+    auto second = cache.read(3);
+
+    // Verify
+    expect(that % 0x33 == first.value());
+    expect(that % 0x33 == second.value());
+    expect(that % 1 == device.m_transactions);
+  };
+
+  "register_cache always reads volatile registers"_test = []() {
+    // Setup
+    register_device_i2c device;
+    test_cache cache(i2c_register_bus(device, device_address));
+
+    // Exercise
+    device.m_registers[0] = 1;
+    auto first = cache.read(0);
+    device.m_registers[0] = 2;
+    auto second = cache.read(0);
+
+    // Verify
+    expect(that % 1 == first.value());
+    expect(that % 2 == second.value());
+    expect(that % 2 == device.m_transactions);
+  };
+
+  "register_cache holds writes until flush"_test = []() {
+    // Setup
+    register_device_i2c device;
+    test_cache cache(i2c_register_bus(device, device_address));
+
+    // Exercise
+    auto write_result = cache.write(2, 0x22);
+    auto read_back = cache.read(2);
+    const auto transactions_before_flush = device.m_transactions;
+    auto flush_result = cache.flush();
+
+    // Verify
+    expect(bool{ write_result });
+    expect(bool{ flush_result });
+    expect(that % 0x22 == read_back.value());
+    expect(that % 0 == transactions_before_flush);
+    expect(that % 0x22 == device.m_registers[2]);
+    expect(that % false == cache.dirty());
+  };
+
+  "register_cache coalesces adjacent dirty registers"_test = []() {
+    // Setup
+    register_device_i2c device;
+    test_cache cache(i2c_register_bus(device, device_address));
+
+    // Exercise
+    (void)cache.write(1, 0x11);
+    (void)cache.write(2, 0x22);
+    (void)cache.write(3, 0x33);
+    (void)cache.write(5, 0x55);
+    (void)cache.write(7, 0x77);
+    auto result = cache.flush();
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 3U == device.m_writes.size());
+    expect(device.m_writes[0] == std::vector<hal::byte>{ 1, 0x11, 0x22, 0x33 });
+    expect(device.m_writes[1] == std::vector<hal::byte>{ 5, 0x55 });
+    expect(device.m_writes[2] == std::vector<hal::byte>{ 7, 0x77 });
+  };
+
+  "register_cache writes volatile registers immediately"_test = []() {
+    // Setup
+    register_device_i2c device;
+    test_cache cache(i2c_register_bus(device, device_address));
+
+    // Exercise
+    auto result = cache.write(0, 0x80);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 0x80 == device.m_registers[0]);
+    expect(that % false == cache.dirty());
+  };
+
+  "register_cache drops writes that do not change a register"_test = []() {
+    // Setup
+    register_device_i2c device;
+    device.m_registers[4] = 0x0F;
+    test_cache cache(i2c_register_bus(device, device_address));
+
+    // Exercise
+    auto modify1 = cache.modify(4, 0x0F, 0x0F);
+    auto modify2 = cache.modify(4, 0xF0, 0xA0);
+    auto modify3 = cache.modify(4, 0xF0, 0xA0);
+    auto flush_result = cache.flush();
+
+    // Verify
+    expect(bool{ modify1 });
+    expect(bool{ modify2 });
+    expect(bool{ modify3 });
+    expect(bool{ flush_result });
+    expect(that % 0xAF == device.m_registers[4]);
+    // One read to fill the cache and one write from the flush
+    expect(that % 2 == device.m_transactions);
+  };
+
+  "register_cache write only registers are never read"_test = []() {
+    // Setup
+    register_device_i2c device;
+    device.m_registers[7] = 0xEE;
+    test_cache cache(i2c_register_bus(device, device_address));
+    constexpr std::array<hal::byte, 8> defaults{ 0, 0, 0, 0, 0, 0, 0, 0x01 };
+
+    // Exercise
+    cache.load_defaults(defaults);
+    auto value = cache.read(7);
+
+    // Verify
+    expect(that % 0x01 == value.value());
+    expect(that % 0 == device.m_transactions);
+  };
+
+  "register_cache burst read fills cache"_test = []() {
+    // Setup
+    register_device_i2c device;
+    device.m_registers = { 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7 };
+    test_cache cache(i2c_register_bus(device, device_address));
+    std::array<hal::byte, 3> burst{};
+
+    // Exercise
+    auto burst_result = cache.read(1, burst);
+    auto cached = cache.read(2);
+    auto out_of_range = cache.read(7, burst);
+
+    // Verify
+    expect(bool{ burst_result });
+    expect(!bool{ out_of_range });
+    expect(that % 0xA1 == burst[0]);
+    expect(that % 0xA3 == burst[2]);
+    expect(that % 0xA2 == cached.value());
+    expect(that % 1 == device.m_transactions);
+  };
+
+  "register_cache invalidate() forces a re-read"_test = []() {
+    // Setup
+    register_device_i2c device;
+    test_cache cache(i2c_register_bus(device, device_address));
+    (void)cache.read(3);
+
+    // Exercise
+    device.m_registers[3] = 0x99;
+    cache.invalidate();
+    auto value = cache.read(3);
+
+    // Verify
+    expect(that % 0x99 == value.value());
+    expect(that % 2 == device.m_transactions);
+  };
+
+  "register_cache keeps registers dirty on failed flush"_test = []() {
+    // Setup
+    register_device_i2c device;
+    test_cache cache(i2c_register_bus(device, device_address));
+    (void)cache.write(1, 0x11);
+    device.m_return_error_status = true;
+
+    // Exercise
+    auto result = cache.flush();
+
+    // Verify
+    expect(!bool{ result });
+    expect(that % true == cache.dirty());
+  };
+
+  "register_cache flushes pending writes before volatile writes"_test = []() {
+    // Setup
+    register_device_i2c device;
+    test_cache cache(i2c_register_bus(device, device_address));
+
+    // Exercise
+    (void)cache.write(2, 0x22);
+    (void)cache.write(3, 0x33);
+    (void)cache.write(7, 0x77);
+    auto result = cache.write(0, 0x01);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 3U == device.m_writes.size());
+    expect(device.m_writes[0] == std::vector<hal::byte>{ 2, 0x22, 0x33 });
+    expect(device.m_writes[1] == std::vector<hal::byte>{ 7, 0x77 });
+    expect(device.m_writes[2] == std::vector<hal::byte>{ 0, 0x01 });
+    expect(that % false == cache.dirty());
+  };
+
+  "register_cache range reads do not read write only registers"_test = []() {
+    // Setup
+    register_device_i2c device;
+    test_cache cache(i2c_register_bus(device, device_address));
+    (void)cache.write(7, 0x77);
+    (void)cache.flush();
+    device.m_registers[5] = 0x55;
+    device.m_registers[6] = 0x66;
+    device.m_registers[7] = 0xEE;
+    std::array<hal::byte, 3> burst{};
+
+    // Exercise
+    auto result = cache.read(5, burst);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 0x55 == burst[0]);
+    expect(that % 0x66 == burst[1]);
+    expect(that % 0x77 == burst[2]);
+    expect(device.m_read_lengths == std::vector<std::size_t>{ 2 });
+  };
+
+  "spi_register_bus accesses registers through an spi_device"_test = []() {
+    // Setup
+    test_spi spi;
+    test_output_pin chip_select;
+    spi_bus bus(spi);
+    auto device = spi_device::create(bus, chip_select).value();
+    register_cache<test_map, spi_register_bus> cache{ spi_register_bus(
+      device) };
+
+    // Exercise
+    (void)cache.write(2, 0x22);
+    (void)cache.write(3, 0x33);
+    auto flush_result = cache.flush();
+    auto value = cache.read(0);
+
+    // Verify
+    expect(bool{ flush_result });
+    expect(that % 0x5A == value.value());
+    expect(that % 3U == spi.m_transfers.size());
+    expect(spi.m_transfers[0] == std::vector<hal::byte>{ 2, 0x22, 0x33 });
+    expect(spi.m_transfers[1] == std::vector<hal::byte>{ 0x80 });
+    // HIGH from create(), then one frame per access
+    expect(chip_select.m_levels ==
+           std::vector<bool>{ true, false, true, false, true });
+  };
+}
+}  // namespace hal
@@ -0,0 +1,289 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/shared_i2c.hpp>
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+/// i2c that can hold a transaction open until the test releases it
+class gated_i2c : public hal::i2c
+{
+public:
+  std::atomic<bool> m_hold{ false };
+  std::atomic<bool> m_entered{ false };
+  std::atomic<int> m_concurrent{ 0 };
+  std::atomic<int> m_max_concurrent{ 0 };
+  std::vector<hal::byte> m_addresses{};
+  std::vector<float> m_configured_rates{};
+
+  void wait_until_entered()
+  {
+    while (!m_entered) {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  status driver_configure(const settings& p_settings) override
+  {
+    m_configured_rates.push_back(p_settings.clock_rate);
+    return success();
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte>,
+    std::span<hal::byte>,
+    hal::function_ref<hal::timeout_function>) override
+  {
+    const auto concurrent = ++m_concurrent;
+    m_max_concurrent = std::max(m_max_concurrent.load(), concurrent);
+    m_addresses.push_back(p_address);
+    m_entered = true;
+    while (m_hold) {
+      std::this_thread::yield();
+    }
+    m_concurrent--;
+    return transaction_t{};
+  }
+};
+
+class chrono_clock : public hal::steady_clock
+{
+private:
+  frequency_t driver_frequency() override
+  {
+    return frequency_t{ .operating_frequency = 1.0_GHz };
+  }
+
+  uptime_t driver_uptime() override
+  {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    const auto ticks = std::chrono::nanoseconds(now).count();
+    return uptime_t{ .ticks = static_cast<std::uint64_t>(ticks) };
+  }
+};
+
+void wait_for_waiters(shared_i2c& p_shared, std::size_t p_count)
+{
+  while (p_shared.waiting() != p_count) {
+    std::this_thread::yield();
+  }
+}
+
+status write_address(hal::i2c& p_i2c, hal::byte p_address)
+{
+  const std::array<hal::byte, 1> data{ 0 };
+  HAL_CHECK(p_i2c.transaction(
+    p_address, data, std::span<hal::byte>{}, hal::never_timeout()));
+  return success();
+}
+}  // namespace
+
+void shared_i2c_test()
+{
+  using namespace boost::ut;
+
+  "shared_i2c device forwards transactions and settings"_test = []() {
+    // Setup
+    gated_i2c bus;
+    chrono_clock clock;
+    shared_i2c shared(bus, clock);
+    auto fast = shared.make_device();
+    auto slow = shared.make_device();
+    (void)fast.configure(hal::i2c::settings{ .clock_rate = 400.0_kHz });
+    (void)slow.configure(hal::i2c::settings{ .clock_rate = 100.0_kHz });
+
+    // Exercise
+    auto result1 = write_address(fast, 0x10);
+    auto result2 = write_address(fast, 0x10);
+    auto result3 = write_address(slow, 0x20);
+
+    // Verify
+    expect(bool{ result1 });
+    expect(bool{ result2 });
+    expect(bool{ result3 });
+    expect(bus.m_addresses == std::vector<hal::byte>{ 0x10, 0x10, 0x20 });
+    // Settings are only re-applied when the device using the bus changes
+    expect(that % 2U == bus.m_configured_rates.size());
+    expect(that % 2U == fast.statistics().transactions);
+    expect(that % 1U == slow.statistics().transactions);
+  };
+
+  "shared_i2c serves higher priority devices first"_test = []() {
+    // Setup
+    gated_i2c bus;
+    chrono_clock clock;
+    shared_i2c shared(bus, clock);
+    auto holder = shared.make_device(0);
+    auto eeprom = shared.make_device(0);
+    auto sensor = shared.make_device(5);
+    bus.m_hold = true;
+
+    // Exercise
+    std::thread holder_thread([&]() { (void)write_address(holder, 0x01); });
+    bus.wait_until_entered();
+    std::thread eeprom_thread([&]() { (void)write_address(eeprom, 0x50); });
+    wait_for_waiters(shared, 1);
+    std::thread sensor_thread([&]() { (void)write_address(sensor, 0x68); });
+    wait_for_waiters(shared, 2);
+    bus.m_hold = false;
+    holder_thread.join();
+    eeprom_thread.join();
+    sensor_thread.join();
+
+    // Verify
+    expect(bus.m_addresses == std::vector<hal::byte>{ 0x01, 0x68, 0x50 });
+    expect(that % 0U < eeprom.statistics().max_wait_ticks);
+    expect(that % sensor.statistics().max_wait_ticks <
+           eeprom.statistics().max_wait_ticks);
+  };
+
+  "shared_i2c serves equal priorities in arrival order"_test = []() {
+    // Setup
+    gated_i2c bus;
+    chrono_clock clock;
+    shared_i2c shared(bus, clock);
+    auto holder = shared.make_device();
+    auto first = shared.make_device();
+    auto second = shared.make_device();
+    bus.m_hold = true;
+
+    // Exercise
+    std::thread holder_thread([&]() { (void)write_address(holder, 0x01); });
+    bus.wait_until_entered();
+    std::thread first_thread([&]() { (void)write_address(first, 0x02); });
+    wait_for_waiters(shared, 1);
+    std::thread second_thread([&]() { (void)write_address(second, 0x03); });
+    wait_for_waiters(shared, 2);
+    bus.m_hold = false;
+    holder_thread.join();
+    first_thread.join();
+    second_thread.join();
+
+    // Verify
+    expect(bus.m_addresses == std::vector<hal::byte>{ 0x01, 0x02, 0x03 });
+  };
+
+  "shared_i2c waiting device leaves the queue on timeout"_test = []() {
+    // Setup
+    gated_i2c bus;
+    chrono_clock clock;
+    shared_i2c shared(bus, clock);
+    auto holder = shared.make_device();
+    auto waiter = shared.make_device();
+    const std::array<hal::byte, 1> data{ 0 };
+    int timeout_calls = 0;
+    auto limited_timeout = [&timeout_calls]() -> status {
+      if (++timeout_calls > 3) {
+        return hal::new_error(std::errc::timed_out);
+      }
+      return success();
+    };
+    bus.m_hold = true;
+    std::thread holder_thread([&]() { (void)write_address(holder, 0x01); });
+    bus.wait_until_entered();
+
+    // Exercise
+    auto result =
+      waiter.transaction(0x02, data, std::span<hal::byte>{}, limited_timeout);
+    const auto waiting_after_timeout = shared.waiting();
+    bus.m_hold = false;
+    holder_thread.join();
+    auto after_release = write_address(waiter, 0x03);
+
+    // Verify
+    expect(!bool{ result });
+    expect(bool{ after_release });
+    expect(that % 0U == waiting_after_timeout);
+    expect(bus.m_addresses == std::vector<hal::byte>{ 0x01, 0x03 });
+  };
+
+  "shared_i2c holds the bus for a whole transaction list"_test = []() {
+    // Setup
+    gated_i2c bus;
+    chrono_clock clock;
+    shared_i2c shared(bus, clock);
+    auto batch = shared.make_device();
+    auto other = shared.make_device(1);
+    const std::array<hal::byte, 1> data{ 0 };
+    const std::array<hal::i2c::transaction_descriptor, 2> list{
+      hal::i2c::transaction_descriptor{ .address = 0x01, .data_out = data },
+      hal::i2c::transaction_descriptor{ .address = 0x02, .data_out = data },
+    };
+    bus.m_hold = true;
+
+    // Exercise
+    std::thread batch_thread([&batch, &list]() {
+      (void)batch.transactions(list, hal::never_timeout());
+    });
+    bus.wait_until_entered();
+    std::thread other_thread([&other]() { (void)write_address(other, 0x03); });
+    wait_for_waiters(shared, 1);
+    bus.m_hold = false;
+    batch_thread.join();
+    other_thread.join();
+
+    // Verify
+    expect(bus.m_addresses == std::vector<hal::byte>{ 0x01, 0x02, 0x03 });
+    expect(that % 2U == batch.statistics().transactions);
+    expect(that % 1U == other.statistics().transactions);
+  };
+
+  "shared_i2c serialises transactions under contention"_test = []() {
+    // Setup
+    constexpr int thread_count = 4;
+    constexpr int transactions_per_thread = 200;
+    constexpr auto total_transactions = thread_count * transactions_per_thread;
+    gated_i2c bus;
+    chrono_clock clock;
+    shared_i2c shared(bus, clock);
+    std::vector<shared_i2c::device> devices;
+    for (int i = 0; i < thread_count; i++) {
+      devices.push_back(shared.make_device(i));
+    }
+    std::vector<std::thread> threads;
+
+    // Exercise
+    for (int i = 0; i < thread_count; i++) {
+      threads.emplace_back([&devices, i]() {
+        for (int j = 0; j < transactions_per_thread; j++) {
+          (void)write_address(devices[i], static_cast<hal::byte>(i));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // Verify
+    expect(that % 1 == bus.m_max_concurrent.load());
+    expect(that % total_transactions ==
+           static_cast<int>(bus.m_addresses.size()));
+    for (auto& device : devices) {
+      expect(that % transactions_per_thread ==
+             static_cast<int>(device.statistics().transactions));
+      expect(device.statistics().max_wait_ticks <=
+             device.statistics().total_wait_ticks);
+    }
+  };
+};
+}  // namespace hal
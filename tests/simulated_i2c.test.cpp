@@ -0,0 +1,203 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/simulated_i2c.hpp>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+void simulated_i2c_test()
+{
+  using namespace boost::ut;
+  using namespace std::chrono_literals;
+
+  "simulated_i2c register model auto increments"_test = []() {
+    // Setup
+    std::array<hal::byte, 4> registers{};
+    i2c_register_model model(registers);
+    simulated_i2c bus;
+    (void)bus.mount(0x48, model);
+    const std::array<hal::byte, 4> write_data{ 2, 0xA2, 0xA3, 0xA0 };
+    const std::array<hal::byte, 1> register_3{ 3 };
+    std::array<hal::byte, 2> read_data{};
+
+    // Exercise
+    auto write_result = bus.transaction(
+      0x48, write_data, std::span<hal::byte>{}, hal::never_timeout());
+    auto read_result =
+      bus.transaction(0x48, register_3, read_data, hal::never_timeout());
+
+    // Verify
+    expect(bool{ write_result });
+    expect(bool{ read_result });
+    expect(that % 0xA0 == registers[0]);
+    expect(that % 0xA2 == registers[2]);
+    expect(that % 0xA3 == registers[3]);
+    expect(that % 0xA3 == read_data[0]);
+    expect(that % 0xA0 == read_data[1]);
+    expect(that % 1U == model.pointer());
+  };
+
+  "simulated_i2c NACKs unknown addresses"_test = []() {
+    // Setup
+    simulated_i2c bus;
+    const std::array<hal::byte, 1> data{ 0 };
+    bool caught_errc = false;
+
+    // Exercise
+    auto result = hal::attempt(
+      [&]() -> status {
+        HAL_CHECK(bus.transaction(
+          0x10, data, std::span<hal::byte>{}, hal::never_timeout()));
+        return success();
+      },
+      [&caught_errc](
+        hal::match<std::errc, std::errc::no_such_device_or_address>) -> status {
+        caught_errc = true;
+        return success();
+      });
+
+    // Verify
+    expect(bool{ result });
+    expect(that % true == caught_errc);
+    expect(that % 1U == bus.transactions());
+  };
+
+  "simulated_i2c::mount() rejects bad and taken addresses"_test = []() {
+    // Setup
+    std::array<hal::byte, 1> registers{};
+    i2c_register_model model(registers);
+    simulated_i2c bus;
+
+    // Exercise
+    auto first = bus.mount(0x20, model);
+    auto taken = bus.mount(0x20, model);
+    auto invalid = bus.mount(0x80, model);
+    bus.unmount(0x20);
+    auto remount = bus.mount(0x20, model);
+
+    // Verify
+    expect(bool{ first });
+    expect(!bool{ taken });
+    expect(!bool{ invalid });
+    expect(bool{ remount });
+  };
+
+  "simulated_i2c advances virtual time"_test = []() {
+    // Setup
+    std::array<hal::byte, 4> registers{};
+    i2c_register_model model(registers);
+    simulated_i2c bus;
+    (void)bus.mount(0x48, model);
+    (void)bus.configure(hal::i2c::settings{ .clock_rate = 100.0_kHz });
+    const std::array<hal::byte, 2> data{ 0, 0x11 };
+
+    // Exercise
+    const auto start = bus.clock().uptime().ticks;
+    (void)bus.transaction(
+      0x48, data, std::span<hal::byte>{}, hal::never_timeout());
+    const auto end = bus.clock().uptime().ticks;
+
+    // Verify
+    // Start + address + 2 data bytes + stop = 29 bits at 10us each
+    expect(that % 290'000U == end - start);
+  };
+
+  "simulated_i2c empty transactions do nothing"_test = []() {
+    // Setup
+    simulated_i2c bus;
+    bus.inject_fault(std::errc::io_error);
+
+    // Exercise
+    const auto start = bus.clock().uptime().ticks;
+    auto result = bus.transaction(0x48,
+                                  std::span<const hal::byte>{},
+                                  std::span<hal::byte>{},
+                                  hal::never_timeout());
+    const auto end = bus.clock().uptime().ticks;
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 0U == bus.transactions());
+    expect(that % 0U == end - start);
+  };
+
+  "simulated_i2c clock stretching calls timeout"_test = []() {
+    // Setup
+    std::array<hal::byte, 4> registers{};
+    i2c_register_model model(registers);
+    simulated_i2c bus;
+    (void)bus.mount(0x48, model, 1ms);
+    const std::array<hal::byte, 2> data{ 0, 0x11 };
+    auto& clock = bus.clock();
+    const auto deadline = clock.uptime().ticks + 1'000'000;
+    auto virtual_timeout = [&clock, deadline]() -> status {
+      if (clock.uptime().ticks >= deadline) {
+        return hal::new_error(std::errc::timed_out);
+      }
+      return success();
+    };
+
+    // Exercise
+    auto result =
+      bus.transaction(0x48, data, std::span<hal::byte>{}, virtual_timeout);
+
+    // Verify
+    expect(!bool{ result });
+    expect(that % 0x00 == registers[0]);
+  };
+
+  "simulated_i2c injected faults"_test = []() {
+    // Setup
+    std::array<hal::byte, 4> registers{};
+    i2c_register_model model(registers);
+    simulated_i2c bus;
+    (void)bus.mount(0x48, model);
+    const std::array<hal::byte, 1> data{ 0 };
+    auto write = [&bus, &data]() {
+      return bool{ bus.transaction(
+        0x48, data, std::span<hal::byte>{}, hal::never_timeout()) };
+    };
+
+    // Exercise
+    bus.inject_fault(std::errc::io_error, 1, 2);
+    const bool first = write();
+    const bool second = write();
+    const bool third = write();
+    const bool fourth = write();
+
+    // Verify
+    expect(that % true == first);
+    expect(that % false == second);
+    expect(that % false == third);
+    expect(that % true == fourth);
+  };
+
+  "simulated_i2c register model NACKs out of range register"_test = []() {
+    // Setup
+    std::array<hal::byte, 4> registers{};
+    i2c_register_model model(registers);
+    simulated_i2c bus;
+    (void)bus.mount(0x48, model);
+    const std::array<hal::byte, 2> data{ 4, 0x11 };
+
+    // Exercise
+    auto result = bus.transaction(
+      0x48, data, std::span<hal::byte>{}, hal::never_timeout());
+
+    // Verify
+    expect(!bool{ result });
+  };
+};
+}  // namespace hal
@@ -0,0 +1,202 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/soft_dac_stream.hpp>
+
+#include <array>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+/// Dac writing fixed point samples, recording each one and when it was written
+class test_dac : public hal::dac
+{
+public:
+  explicit test_dac(simulated_timer& p_timer)
+    : m_timer(&p_timer)
+  {
+  }
+
+  std::vector<std::uint32_t> m_writes{};
+  std::vector<std::int64_t> m_times{};
+  int m_float_writes = 0;
+  bool m_return_error_status = false;
+
+private:
+  result<write_t> driver_write(float) override
+  {
+    m_float_writes++;
+    return write_t{};
+  }
+  result<write_t> driver_write_fraction(q16 p_proportion) override
+  {
+    if (m_return_error_status) {
+      return hal::new_error();
+    }
+    m_writes.push_back(p_proportion.raw());
+    m_times.push_back(m_timer->m_now);
+    return write_t{};
+  }
+
+  simulated_timer* m_timer;
+};
+
+/// Dac, timer and clock for one stream
+struct stream_fixture
+{
+  simulated_timer timer;
+  simulated_clock clock{ timer };
+  test_dac dac{ timer };
+  soft_dac_stream stream{ dac, timer, clock };
+};
+
+constexpr q16 raw(std::uint32_t p_raw)
+{
+  return q16::from_raw(p_raw);
+}
+}  // namespace
+
+void soft_dac_stream_test()
+{
+  using namespace boost::ut;
+
+  "soft_dac_stream plays queued buffers in order"_test = []() {
+    // Setup
+    stream_fixture fixture;
+    auto& stream = fixture.stream;
+    const std::array<q16, 2> first{ raw(1), raw(2) };
+    const std::array<q16, 1> second{ raw(3) };
+    std::vector<std::size_t> completed{};
+    stream.on_complete([&completed](std::span<const q16> p_samples) {
+      completed.push_back(p_samples.size());
+    });
+
+    // Exercise
+    const bool first_queued = stream.submit(first);
+    const bool second_queued = stream.submit(second);
+    const bool third_queued = stream.submit(second);
+    auto start_result = stream.start(1.0_kHz);
+    const auto first_delay = fixture.timer.m_delay.count();
+    fixture.timer.fire(3);
+
+    // Verify
+    expect(that % true == first_queued);
+    expect(that % true == second_queued);
+    expect(that % false == third_queued);
+    expect(bool{ start_result });
+    expect(that % 1'000'000 == first_delay);
+    expect(fixture.dac.m_writes == std::vector<std::uint32_t>{ 1, 2, 3 });
+    expect(that % 0 == fixture.dac.m_float_writes);
+    expect(completed == std::vector<std::size_t>{ 2, 1 });
+    expect(that % 0U == stream.queued());
+    expect(that % 0U == stream.underruns());
+  };
+
+  "soft_dac_stream counts underruns and write errors"_test = []() {
+    // Setup
+    stream_fixture fixture;
+    auto& stream = fixture.stream;
+    const std::array<q16, 2> samples{ raw(1), raw(2) };
+
+    // Exercise
+    (void)stream.submit(samples);
+    (void)stream.start(8.0_kHz);
+    fixture.timer.fire();
+    fixture.dac.m_return_error_status = true;
+    fixture.timer.fire(4);
+
+    // Verify
+    expect(that % 1U == fixture.dac.m_writes.size());
+    expect(that % 1U == stream.write_errors());
+    expect(that % 3U == stream.underruns());
+  };
+
+  "soft_dac_stream loops a buffer resubmitted on completion"_test = []() {
+    // Setup
+    stream_fixture fixture;
+    auto& stream = fixture.stream;
+    const std::array<q16, 2> samples{ raw(0), raw(q16::raw_one) };
+    stream.on_complete([&stream](std::span<const q16> p_samples) {
+      (void)stream.submit(p_samples);
+    });
+
+    // Exercise
+    (void)stream.submit(samples);
+    (void)stream.start(1.0_kHz);
+    fixture.timer.fire(5);
+    auto stop_result = stream.stop();
+    fixture.timer.fire(5);
+
+    // Verify
+    expect(bool{ stop_result });
+    expect(fixture.dac.m_writes ==
+           std::vector<std::uint32_t>{ 0, 65536, 0, 65536, 0 });
+    expect(that % 0U == stream.underruns());
+  };
+
+  "soft_dac_stream keeps samples on their deadlines despite latency"_test =
+    []() {
+      // Setup
+      stream_fixture fixture;
+      const std::array<q16, 4> samples{};
+      fixture.timer.m_latency = 300'000;
+
+      // Exercise
+      (void)fixture.stream.submit(samples);
+      (void)fixture.stream.start(1.0_kHz);
+      fixture.timer.fire(4);
+
+      // Verify
+      expect(fixture.dac.m_times == std::vector<std::int64_t>{
+                                      1'300'000,
+                                      2'300'000,
+                                      3'300'000,
+                                      4'300'000,
+                                    });
+    };
+
+  "soft_dac_stream spreads fractional periods"_test = []() {
+    // Setup
+    stream_fixture fixture;
+    std::vector<std::int64_t> deadlines{};
+
+    // Exercise
+    (void)fixture.stream.start(3.0_kHz);
+    for (int i = 0; i < 3; i++) {
+      deadlines.push_back(fixture.timer.m_due);
+      fixture.timer.fire();
+    }
+
+    // Verify
+    expect(deadlines ==
+           std::vector<std::int64_t>{ 333'333, 666'666, 1'000'000 });
+  };
+
+  "soft_dac_stream::start() rejects unreachable sample rates"_test = []() {
+    // Setup
+    stream_fixture fixture;
+
+    // Exercise
+    auto result = fixture.stream.start(2.0_GHz);
+
+    // Verify
+    expect(!bool{ result });
+    expect(that % false == fixture.timer.m_is_running);
+  };
+};
+}  // namespace hal
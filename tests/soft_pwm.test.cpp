@@ -0,0 +1,249 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/soft_pwm.hpp>
+
+#include <array>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+/// Output pin that records the virtual time of each level change
+class recording_pin : public hal::output_pin
+{
+public:
+  explicit recording_pin(simulated_timer& p_timer)
+    : m_timer(&p_timer)
+  {
+  }
+
+  struct edge
+  {
+    std::int64_t time;
+    bool level;
+    bool operator==(const edge&) const = default;
+  };
+
+  std::vector<edge> m_edges{};
+  bool m_level = false;
+  bool m_return_error_status = false;
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+  result<set_level_t> driver_level(bool p_high) override
+  {
+    if (m_return_error_status) {
+      return hal::new_error();
+    }
+    if (p_high != m_level || m_edges.empty()) {
+      m_edges.push_back(edge{ .time = m_timer->m_now, .level = p_high });
+    }
+    m_level = p_high;
+    return set_level_t{};
+  }
+  result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_level };
+  }
+
+  simulated_timer* m_timer;
+};
+
+using edge = recording_pin::edge;
+}  // namespace
+
+void soft_pwm_test()
+{
+  using namespace boost::ut;
+
+  "soft_pwm generates one callback per distinct edge"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    std::array<recording_pin, 3> pins{ recording_pin(timer),
+                                       recording_pin(timer),
+                                       recording_pin(timer) };
+    const std::array<hal::output_pin*, 3> outputs{ &pins[0],
+                                                   &pins[1],
+                                                   &pins[2] };
+    soft_pwm<3> engine(outputs, timer, clock, 1.0_kHz);
+    (void)engine[0].duty_cycle(0.5f);
+    (void)engine[1].duty_cycle(0.25f);
+    (void)engine[2].duty_cycle(0.5f);
+
+    // Exercise
+    auto result = engine.start();
+    timer.run_until(1'999'999);
+
+    // Verify
+    expect(bool{ result });
+    // 2 distinct LOW times in the first period, then the second period start
+    // and its 2 LOW times
+    expect(that % 5 == timer.m_callbacks);
+    expect(pins[1].m_edges == std::vector<edge>{ { 0, true },
+                                                 { 250'000, false },
+                                                 { 1'000'000, true },
+                                                 { 1'250'000, false } });
+    expect(pins[0].m_edges == pins[2].m_edges);
+    expect(that % 500'000 == pins[0].m_edges[1].time);
+  };
+
+  "soft_pwm holds 0% LOW and 100% HIGH without edges"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    std::array<recording_pin, 2> pins{ recording_pin(timer),
+                                       recording_pin(timer) };
+    const std::array<hal::output_pin*, 2> outputs{ &pins[0], &pins[1] };
+    soft_pwm<2> engine(outputs, timer, clock);
+    (void)engine[1].duty_cycle(q16::from_raw(q16::raw_one));
+
+    // Exercise
+    (void)engine.start();
+    timer.run_until(2'999'999);
+
+    // Verify
+    // Only the starts of the second and third periods
+    expect(that % 2 == timer.m_callbacks);
+    expect(pins[0].m_edges == std::vector<edge>{ { 0, false } });
+    expect(pins[1].m_edges == std::vector<edge>{ { 0, true } });
+  };
+
+  "soft_pwm applies changes at the next period"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    std::array<recording_pin, 2> pins{ recording_pin(timer),
+                                       recording_pin(timer) };
+    const std::array<hal::output_pin*, 2> outputs{ &pins[0], &pins[1] };
+    soft_pwm<2> engine(outputs, timer, clock, 1.0_kHz);
+    (void)engine[0].duty_cycle(0.25f);
+    (void)engine[1].duty_cycle(0.5f);
+    (void)engine.start();
+
+    // Exercise
+    timer.run_until(100'000);
+    // Swap the order of the LOW times in the middle of the period
+    (void)engine[0].duty_cycle(0.75f);
+    (void)engine[1].frequency(500.0_Hz);
+    timer.run_until(3'999'999);
+
+    // Verify
+    expect(pins[0].m_edges == std::vector<edge>{ { 0, true },
+                                                 { 250'000, false },
+                                                 { 1'000'000, true },
+                                                 { 2'500'000, false },
+                                                 { 3'000'000, true } });
+    expect(pins[1].m_edges == std::vector<edge>{ { 0, true },
+                                                 { 500'000, false },
+                                                 { 1'000'000, true },
+                                                 { 2'000'000, false },
+                                                 { 3'000'000, true } });
+  };
+
+  "soft_pwm applies a frequency change on its own"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    std::array<recording_pin, 1> pins{ recording_pin(timer) };
+    const std::array<hal::output_pin*, 1> outputs{ &pins[0] };
+    soft_pwm<1> engine(outputs, timer, clock, 1.0_kHz);
+    (void)engine[0].duty_cycle(0.5f);
+    (void)engine.start();
+
+    // Exercise
+    timer.run_until(1'500'000);
+    (void)engine[0].frequency(250.0_Hz);
+    timer.run_until(5'999'999);
+
+    // Verify
+    expect(pins[0].m_edges == std::vector<edge>{ { 0, true },
+                                                 { 500'000, false },
+                                                 { 1'000'000, true },
+                                                 { 1'500'000, false },
+                                                 { 2'000'000, true },
+                                                 { 4'000'000, false } });
+  };
+
+  "soft_pwm keeps edges on their deadlines despite latency"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    std::array<recording_pin, 1> pins{ recording_pin(timer) };
+    const std::array<hal::output_pin*, 1> outputs{ &pins[0] };
+    soft_pwm<1> engine(outputs, timer, clock, 1.0_kHz);
+    (void)engine[0].duty_cycle(0.25f);
+    timer.m_latency = 20'000;
+
+    // Exercise
+    (void)engine.start();
+    timer.fire(4);
+
+    // Verify
+    expect(pins[0].m_edges == std::vector<edge>{ { 0, true },
+                                                 { 270'000, false },
+                                                 { 1'020'000, true },
+                                                 { 1'270'000, false },
+                                                 { 2'020'000, true } });
+  };
+
+  "soft_pwm counts failed pin writes"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    std::array<recording_pin, 2> pins{ recording_pin(timer),
+                                       recording_pin(timer) };
+    const std::array<hal::output_pin*, 2> outputs{ &pins[0], &pins[1] };
+    soft_pwm<2> engine(outputs, timer, clock, 1.0_kHz);
+    (void)engine[0].duty_cycle(0.5f);
+    (void)engine[1].duty_cycle(0.5f);
+    pins[1].m_return_error_status = true;
+
+    // Exercise
+    (void)engine.start();
+    timer.run_until(1'999'999);
+
+    // Verify
+    // Pin 1 fails at both period starts and both LOW edges
+    expect(that % 4U == engine.pin_errors());
+    expect(that % 4U == pins[0].m_edges.size());
+    expect(that % true == timer.m_is_running);
+  };
+
+  "soft_pwm::stop() cancels the timer"_test = []() {
+    // Setup
+    simulated_timer timer;
+    simulated_clock clock(timer);
+    std::array<recording_pin, 1> pins{ recording_pin(timer) };
+    const std::array<hal::output_pin*, 1> outputs{ &pins[0] };
+    soft_pwm<1> engine(outputs, timer, clock);
+    (void)engine[0].duty_cycle(0.5f);
+    (void)engine.start();
+
+    // Exercise
+    auto result = engine.stop();
+
+    // Verify
+    expect(bool{ result });
+    expect(that % false == timer.m_is_running);
+  };
+};
+}  // namespace hal
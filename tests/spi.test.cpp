@@ -14,6 +14,8 @@
 
 #include <libhal/spi.hpp>
 
+#include <numeric>
+
 #include <boost/ut.hpp>
 
 namespace hal {
@@ -56,6 +58,59 @@ private:
     return transfer_t{};
   };
 };
+
+/// Loopback that receives the inverse of each byte sent
+class loopback_spi : public hal::spi
+{
+public:
+  int m_transfer_count = 0;
+  bool m_saw_overlap = false;
+  int m_fail_on_transfer = -1;
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  };
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte> p_data_out,
+                                     std::span<hal::byte> p_data_in,
+                                     hal::byte) override
+  {
+    if (++m_transfer_count == m_fail_on_transfer) {
+      return hal::new_error(std::errc::io_error);
+    }
+    const auto* out_begin = p_data_out.data();
+    const auto* out_end = out_begin + p_data_out.size();
+    const auto* in_begin = p_data_in.data();
+    const auto* in_end = in_begin + p_data_in.size();
+    if (out_begin < in_end && in_begin < out_end) {
+      m_saw_overlap = true;
+    }
+    for (std::size_t i = 0; i < p_data_in.size(); i++) {
+      p_data_in[i] = static_cast<hal::byte>(~p_data_out[i]);
+    }
+    return transfer_t{};
+  };
+};
+
+/// Loopback that supports transferring directly from and into one buffer
+class in_place_loopback_spi : public loopback_spi
+{
+public:
+  int m_in_place_count = 0;
+
+private:
+  result<transfer_t> driver_transfer_in_place(
+    std::span<hal::byte> p_data) override
+  {
+    m_in_place_count++;
+    for (auto& byte : p_data) {
+      byte = static_cast<hal::byte>(~byte);
+    }
+    return transfer_t{};
+  }
+};
 }  // namespace
 
 void spi_test()
@@ -96,5 +151,119 @@ void spi_test()
     expect(!bool{ result1 });
     expect(!bool{ result2 });
   };
+
+  "spi scatter-gather transfer() default loops over segments"_test = []() {
+    // Setup
+    loopback_spi test;
+    const std::array<hal::byte, 1> command{ 0x2C };
+    const std::array<hal::byte, 3> address{ 0x00, 0x10, 0x20 };
+    std::array<hal::byte, 2> response{};
+    const std::array<hal::spi::transfer_segment, 3> segments{
+      hal::spi::transfer_segment{ .data_out = command },
+      hal::spi::transfer_segment{ .data_out = address },
+      hal::spi::transfer_segment{ .data_out = address, .data_in = response },
+    };
+
+    // Exercise
+    auto result = test.transfer(segments);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 3 == test.m_transfer_count);
+    expect(that % 0xFF == response[0]);
+    expect(that % 0xEF == response[1]);
+  };
+
+  "spi scatter-gather transfer() stops at the first error"_test = []() {
+    // Setup
+    loopback_spi test;
+    const std::array<hal::byte, 1> data{ 0 };
+    const std::array<hal::spi::transfer_segment, 3> segments{
+      hal::spi::transfer_segment{ .data_out = data },
+      hal::spi::transfer_segment{ .data_out = data },
+      hal::spi::transfer_segment{ .data_out = data },
+    };
+    test.m_fail_on_transfer = 2;
+
+    // Exercise
+    auto result = test.transfer(segments);
+
+    // Verify
+    expect(!bool{ result });
+    expect(that % 2 == test.m_transfer_count);
+  };
+
+  "spi::transfer_in_place() default copies through chunks"_test = []() {
+    // Setup
+    loopback_spi test;
+    std::array<hal::byte, 100> data{};
+    std::iota(data.begin(), data.end(), hal::byte{ 0 });
+
+    // Exercise
+    auto result = test.transfer_in_place(data);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % false == test.m_saw_overlap);
+    expect(that % 4 == test.m_transfer_count);
+    expect(that % 0xFF == data[0]);
+    expect(that % 0xFE == data[1]);
+    expect(that % static_cast<hal::byte>(~99) == data[99]);
+  };
+
+  "spi::transfer_in_place() only touches the given span"_test = []() {
+    // Setup
+    loopback_spi test;
+    std::array<hal::byte, 8> buffer{ 1, 2, 3, 4, 5, 6, 7, 8 };
+
+    // Exercise
+    auto result = test.transfer_in_place(std::span(buffer).subspan(2, 4));
+
+    // Verify
+    expect(bool{ result });
+    expect(buffer == std::array<hal::byte, 8>{
+                       1, 2, 0xFC, 0xFB, 0xFA, 0xF9, 7, 8 });
+  };
+
+  "spi::transfer_in_place() with empty span"_test = []() {
+    // Setup
+    loopback_spi test;
+
+    // Exercise
+    auto result = test.transfer_in_place(std::span<hal::byte>{});
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 0 == test.m_transfer_count);
+  };
+
+  "spi::transfer_in_place() stops at the first error"_test = []() {
+    // Setup
+    loopback_spi test;
+    std::array<hal::byte, 100> data{};
+    test.m_fail_on_transfer = 2;
+
+    // Exercise
+    auto result = test.transfer_in_place(data);
+
+    // Verify
+    expect(!bool{ result });
+    expect(that % 2 == test.m_transfer_count);
+  };
+
+  "spi::transfer_in_place() uses driver override"_test = []() {
+    // Setup
+    in_place_loopback_spi test;
+    std::array<hal::byte, 100> data{};
+
+    // Exercise
+    auto result = test.transfer_in_place(data);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 1 == test.m_in_place_count);
+    expect(that % 0 == test.m_transfer_count);
+    expect(that % 0xFF == data[50]);
+  };
 };
 }  // namespace hal
@@ -0,0 +1,254 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/spi_device.hpp>
+
+#include <string>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+namespace {
+/// Records bus activity as a string of events for easy comparison
+std::string g_events;
+
+class test_spi : public hal::spi
+{
+public:
+  int m_configure_count = 0;
+  bool m_return_error_status = false;
+
+private:
+  status driver_configure(const settings&) override
+  {
+    m_configure_count++;
+    g_events += "C";
+    return success();
+  }
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte> p_data_out,
+                                     std::span<hal::byte> p_data_in,
+                                     hal::byte p_filler) override
+  {
+    if (m_return_error_status) {
+      return hal::new_error(std::errc::io_error);
+    }
+    g_events += "T";
+    g_events += std::to_string(p_data_out.size());
+    std::fill(p_data_in.begin(), p_data_in.end(), p_filler);
+    return transfer_t{};
+  }
+};
+
+class test_chip_select : public hal::output_pin
+{
+public:
+  explicit test_chip_select(char p_name)
+    : m_name(p_name)
+  {
+  }
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+  result<set_level_t> driver_level(bool p_high) override
+  {
+    m_high = p_high;
+    g_events += p_high ? '+' : '-';
+    g_events += m_name;
+    return set_level_t{};
+  }
+  result<level_t> driver_level() override
+  {
+    return level_t{ .state = m_high };
+  }
+  char m_name;
+  bool m_high = false;
+};
+}  // namespace
+
+void spi_device_test()
+{
+  using namespace boost::ut;
+
+  "spi_device frames each transfer with chip select"_test = []() {
+    // Setup
+    test_spi spi;
+    spi_bus bus(spi);
+    test_chip_select chip_select('a');
+    auto device = spi_device::create(bus, chip_select).value();
+    const std::array<hal::byte, 2> data_out{ 1, 2 };
+    std::array<hal::byte, 2> data_in{};
+
+    // Exercise
+    auto result = device.transfer(data_out, data_in, 0xAA);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 0xAA == data_in[0]);
+    expect(that % std::string("+aC-aT2+a") == g_events);
+    g_events.clear();
+  };
+
+  "spi_bus only reconfigures when settings differ"_test = []() {
+    // Setup
+    test_spi spi;
+    spi_bus bus(spi);
+    test_chip_select cs_a('a');
+    test_chip_select cs_b('b');
+    test_chip_select cs_c('c');
+    const spi::settings fast{ .clock_rate = 10.0_MHz };
+    const spi::settings slow{ .clock_rate = 1.0_MHz };
+    auto device_a = spi_device::create(bus, cs_a, fast).value();
+    auto device_b = spi_device::create(bus, cs_b, fast).value();
+    auto device_c = spi_device::create(bus, cs_c, slow).value();
+    const std::array<hal::byte, 1> data{ 0 };
+
+    // Exercise
+    (void)device_a.transfer(data, std::span<hal::byte>{});
+    (void)device_b.transfer(data, std::span<hal::byte>{});
+    (void)device_a.transfer(data, std::span<hal::byte>{});
+    (void)device_c.transfer(data, std::span<hal::byte>{});
+    (void)device_c.configure(fast);
+    (void)device_c.transfer(data, std::span<hal::byte>{});
+
+    // Verify
+    expect(that % 3 == spi.m_configure_count);
+    g_events.clear();
+  };
+
+  "spi_bus::execute() runs a queue back to back"_test = []() {
+    // Setup
+    test_spi spi;
+    spi_bus bus(spi);
+    test_chip_select cs_a('a');
+    test_chip_select cs_b('b');
+    auto device_a = spi_device::create(bus, cs_a).value();
+    auto device_b = spi_device::create(bus, cs_b).value();
+    const std::array<hal::byte, 1> command{ 0x03 };
+    const std::array<hal::byte, 3> payload{ 1, 2, 3 };
+    std::array<hal::byte, 4> response{};
+    const std::array<spi_transfer_descriptor, 3> queue{
+      spi_transfer_descriptor{
+        .device = &device_a, .data_out = command, .keep_selected = true },
+      spi_transfer_descriptor{ .device = &device_a, .data_in = response },
+      spi_transfer_descriptor{ .device = &device_b, .data_out = payload },
+    };
+    g_events.clear();
+
+    // Exercise
+    auto result = bus.execute(queue);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % std::string("C-aT1T0+a-bT3+b") == g_events);
+    g_events.clear();
+  };
+
+  "spi_bus::execute() breaks a kept frame when settings change"_test = []() {
+    // Setup
+    test_spi spi;
+    spi_bus bus(spi);
+    test_chip_select chip_select('a');
+    const spi::settings fast{ .clock_rate = 10.0_MHz };
+    const spi::settings slow{ .clock_rate = 1.0_MHz };
+    auto command = spi_device::create(bus, chip_select, slow).value();
+    auto same = spi_device::create(bus, chip_select, slow).value();
+    auto fast_read = spi_device::create(bus, chip_select, fast).value();
+    const std::array<hal::byte, 1> data{ 0 };
+    const std::array<spi_transfer_descriptor, 3> queue{
+      spi_transfer_descriptor{
+        .device = &command, .data_out = data, .keep_selected = true },
+      spi_transfer_descriptor{
+        .device = &same, .data_out = data, .keep_selected = true },
+      spi_transfer_descriptor{ .device = &fast_read, .data_out = data },
+    };
+    g_events.clear();
+
+    // Exercise
+    auto result = bus.execute(queue);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % std::string("C-aT1T1+aC-aT1+a") == g_events);
+    g_events.clear();
+  };
+
+  "spi_device::transfer_in_place() uses one chip select frame"_test = []() {
+    // Setup
+    test_spi spi;
+    spi_bus bus(spi);
+    test_chip_select chip_select('a');
+    auto device = spi_device::create(bus, chip_select).value();
+    std::array<hal::byte, 100> data{};
+    g_events.clear();
+
+    // Exercise
+    auto result = device.transfer_in_place(data);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % std::string("C-aT32T32T32T4+a") == g_events);
+    g_events.clear();
+  };
+
+  "spi_device segments use one chip select frame"_test = []() {
+    // Setup
+    test_spi spi;
+    spi_bus bus(spi);
+    test_chip_select chip_select('a');
+    auto device = spi_device::create(bus, chip_select).value();
+    const std::array<hal::byte, 1> command{ 0x2C };
+    const std::array<hal::byte, 4> payload{};
+    const std::array<hal::spi::transfer_segment, 2> segments{
+      hal::spi::transfer_segment{ .data_out = command },
+      hal::spi::transfer_segment{ .data_out = payload },
+    };
+    g_events.clear();
+
+    // Exercise
+    auto result = device.transfer(segments);
+
+    // Verify
+    expect(bool{ result });
+    expect(that % std::string("C-aT1T4+a") == g_events);
+    g_events.clear();
+  };
+
+  "spi_bus::execute() releases chip select on failure"_test = []() {
+    // Setup
+    test_spi spi;
+    spi_bus bus(spi);
+    test_chip_select cs_a('a');
+    auto device_a = spi_device::create(bus, cs_a).value();
+    const std::array<hal::byte, 1> data{ 0 };
+    const std::array<spi_transfer_descriptor, 2> queue{
+      spi_transfer_descriptor{ .device = &device_a, .data_out = data },
+      spi_transfer_descriptor{ .device = &device_a, .data_out = data },
+    };
+    spi.m_return_error_status = true;
+    g_events.clear();
+
+    // Exercise
+    auto result = bus.execute(queue);
+
+    // Verify
+    expect(!bool{ result });
+    expect(that % std::string("C-a+a") == g_events);
+    g_events.clear();
+  };
+};
+}  // namespace hal
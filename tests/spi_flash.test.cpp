@@ -0,0 +1,276 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/simulated_spi_flash.hpp>
+#include <libhal/spi_device.hpp>
+#include <libhal/spi_flash.hpp>
+
+#include <numeric>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+constexpr std::size_t flash_size = 128 * 1024;
+
+std::vector<hal::byte> erased_storage()
+{
+  return std::vector<hal::byte>(flash_size, 0xFF);
+}
+
+/// spi with nothing connected, MISO is pulled HIGH
+class empty_spi : public hal::spi
+{
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte>,
+                                     std::span<hal::byte> p_data_in,
+                                     hal::byte) override
+  {
+    std::fill(p_data_in.begin(), p_data_in.end(), hal::byte{ 0xFF });
+    return transfer_t{};
+  }
+};
+
+/// Simulated flash on its own bus, ready to hand to spi_flash::create()
+struct flash_on_bus
+{
+  explicit flash_on_bus(std::span<hal::byte> p_storage)
+    : device(p_storage)
+    , bus(device)
+    , spi(spi_device::create(bus, device.chip_select()).value())
+  {
+  }
+
+  simulated_spi_flash device;
+  spi_bus bus;
+  spi_device spi;
+};
+}  // namespace
+
+void spi_flash_test()
+{
+  using namespace boost::ut;
+
+  "spi_flash::create() reads the JEDEC id"_test = []() {
+    // Setup
+    auto storage = erased_storage();
+    flash_on_bus on_bus(storage);
+
+    // Exercise
+    auto flash = spi_flash::create(on_bus.spi);
+
+    // Verify
+    expect(bool{ flash });
+    expect(that % simulated_spi_flash::manufacturer_id ==
+           flash.value().id().manufacturer);
+    expect(that % flash_size == flash.value().capacity());
+  };
+
+  "spi_flash::create() fails without a device"_test = []() {
+    // Setup
+    empty_spi spi;
+    spi_bus bus(spi);
+    test_output_pin chip_select;
+    auto device = spi_device::create(bus, chip_select).value();
+
+    // Exercise
+    auto flash = spi_flash::create(device);
+
+    // Verify
+    expect(!bool{ flash });
+  };
+
+  "spi_flash::create() rejects a page size of 0"_test = []() {
+    // Setup
+    auto storage = erased_storage();
+    flash_on_bus on_bus(storage);
+    bool caught_errc = false;
+
+    // Exercise
+    auto result = hal::attempt(
+      [&]() -> status {
+        HAL_CHECK(spi_flash::create(on_bus.spi, { .page_size = 0 }));
+        return success();
+      },
+      [&caught_errc](
+        hal::match<std::errc, std::errc::invalid_argument>) -> status {
+        caught_errc = true;
+        return success();
+      });
+
+    // Verify
+    expect(bool{ result });
+    expect(that % true == caught_errc);
+  };
+
+  "spi_flash::write() splits at page boundaries"_test = []() {
+    // Setup
+    auto storage = erased_storage();
+    flash_on_bus on_bus(storage);
+    auto& device = on_bus.device;
+    auto flash = spi_flash::create(on_bus.spi).value();
+    std::vector<hal::byte> data(600);
+    std::iota(data.begin(), data.end(), hal::byte{ 0 });
+    std::vector<hal::byte> read_back(600);
+
+    // Exercise
+    auto write_result = flash.write(200, data, hal::never_timeout());
+    auto read_result = flash.read(200, read_back, hal::never_timeout());
+
+    // Verify
+    expect(bool{ write_result });
+    expect(bool{ read_result });
+    // 56 bytes to the end of the first page, 2 full pages and the rest
+    expect(that % 4U == device.programs());
+    expect(read_back == data);
+    expect(that % 0xFF == storage[199]);
+    expect(that % 0xFF == storage[800]);
+  };
+
+  "spi_flash::write() returns before the program finishes"_test = []() {
+    // Setup
+    auto storage = erased_storage();
+    flash_on_bus on_bus(storage);
+    auto& device = on_bus.device;
+    auto flash = spi_flash::create(on_bus.spi).value();
+    const std::array<hal::byte, 4> data{ 1, 2, 3, 4 };
+
+    // Exercise
+    auto write_result = flash.write(0, data, hal::never_timeout());
+    const bool busy_after_write = device.busy();
+    const bool pending_after_write = flash.pending();
+    auto wait_result = flash.wait(hal::never_timeout());
+
+    // Verify
+    expect(bool{ write_result });
+    expect(bool{ wait_result });
+    expect(that % true == busy_after_write);
+    expect(that % true == pending_after_write);
+    expect(that % false == device.busy());
+    expect(that % false == flash.pending());
+    expect(that % 4 == storage[3]);
+  };
+
+  "spi_flash::wait() respects timeout"_test = []() {
+    // Setup
+    auto storage = erased_storage();
+    flash_on_bus on_bus(storage);
+    auto& device = on_bus.device;
+    auto flash = spi_flash::create(on_bus.spi).value();
+    int timeout_calls = 0;
+    auto limited_timeout = [&timeout_calls]() -> status {
+      if (++timeout_calls > 3) {
+        return hal::new_error(std::errc::timed_out);
+      }
+      return success();
+    };
+
+    // Exercise
+    auto erase_result = flash.erase_block(0, hal::never_timeout());
+    auto wait_result = flash.wait(limited_timeout);
+
+    // Verify
+    expect(bool{ erase_result });
+    expect(!bool{ wait_result });
+    expect(that % true == flash.pending());
+    expect(that % true == device.busy());
+  };
+
+  "spi_flash erase takes realistic time"_test = []() {
+    // Setup
+    auto storage = erased_storage();
+    flash_on_bus on_bus(storage);
+    auto& device = on_bus.device;
+    auto flash = spi_flash::create(on_bus.spi).value();
+    std::fill(storage.begin(), storage.begin() + 8192, hal::byte{ 0x00 });
+
+    // Exercise
+    const auto start = device.clock().uptime().ticks;
+    auto erase_result = flash.erase_sector(4100, hal::never_timeout());
+    auto wait_result = flash.wait(hal::never_timeout());
+    const auto elapsed = device.clock().uptime().ticks - start;
+
+    // Verify
+    expect(bool{ erase_result });
+    expect(bool{ wait_result });
+    expect(that % 1U == device.erases());
+    expect(that % 0x00 == storage[4095]);
+    expect(that % 0xFF == storage[4096]);
+    expect(that % 0xFF == storage[8191]);
+    expect(that % 45'000'000U <= elapsed);
+  };
+
+  "spi_flash rejects out of range access"_test = []() {
+    // Setup
+    auto storage = erased_storage();
+    flash_on_bus on_bus(storage);
+    auto& device = on_bus.device;
+    auto flash = spi_flash::create(on_bus.spi).value();
+    std::array<hal::byte, 2> data{};
+
+    // Exercise
+    auto read_result = flash.read(flash_size - 1, data, hal::never_timeout());
+    auto write_result = flash.write(flash_size, data, hal::never_timeout());
+    auto erase_result = flash.erase_sector(flash_size, hal::never_timeout());
+
+    // Verify
+    expect(!bool{ read_result });
+    expect(!bool{ write_result });
+    expect(!bool{ erase_result });
+    expect(that % 0U == device.programs());
+  };
+
+  "simulated_spi_flash ignores program without write enable"_test = []() {
+    // Setup
+    auto storage = erased_storage();
+    simulated_spi_flash device(storage);
+    auto& chip_select = device.chip_select();
+    const std::array<hal::byte, 5> program{ 0x02, 0, 0, 0, 0x00 };
+
+    // Exercise
+    (void)chip_select.level(false);
+    (void)device.transfer(program, std::span<hal::byte>{});
+    (void)chip_select.level(true);
+
+    // Verify
+    expect(that % 0xFF == storage[0]);
+    expect(that % 0U == device.programs());
+  };
+
+  "simulated_spi_flash programming only clears bits"_test = []() {
+    // Setup
+    auto storage = erased_storage();
+    flash_on_bus on_bus(storage);
+    auto flash = spi_flash::create(on_bus.spi).value();
+    const std::array<hal::byte, 1> first{ 0xF0 };
+    const std::array<hal::byte, 1> second{ 0x3C };
+
+    // Exercise
+    (void)flash.write(10, first, hal::never_timeout());
+    (void)flash.write(10, second, hal::never_timeout());
+    (void)flash.wait(hal::never_timeout());
+
+    // Verify
+    expect(that % 0x30 == storage[10]);
+  };
+};
+}  // namespace hal
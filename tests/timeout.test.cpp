@@ -59,5 +59,53 @@ void timeout_test()
     // Verify
     expect(!bool{ result });
   };
+
+  "hal::try_until(worker, timeout) returns terminal state"_test = []() {
+    // Setup
+    int work_calls = 0;
+    int timeout_calls = 0;
+    auto worker = [&work_calls]() -> result<work_state> {
+      work_calls++;
+      if (work_calls >= 3) {
+        return work_state::finished;
+      }
+      return work_state::in_progress;
+    };
+    auto test_timeout = [&timeout_calls]() -> status {
+      timeout_calls++;
+      return {};
+    };
+
+    // Exercise
+    auto result = hal::try_until(worker, test_timeout);
+
+    // Verify
+    expect(bool{ result });
+    expect(work_state::finished == result.value());
+    expect(that % 3 == work_calls);
+    expect(that % 2 == timeout_calls);
+  };
+
+  "hal::try_until(worker, timeout) times out"_test = []() {
+    // Setup
+    int work_calls = 0;
+    auto worker = [&work_calls]() -> result<work_state> {
+      work_calls++;
+      return work_state::in_progress;
+    };
+    auto test_timeout = [&work_calls]() -> status {
+      if (work_calls >= 5) {
+        return hal::new_error(std::errc::timed_out);
+      }
+      return {};
+    };
+
+    // Exercise
+    auto result = hal::try_until(worker, test_timeout);
+
+    // Verify
+    expect(!bool{ result });
+    expect(that % 5 == work_calls);
+  };
 };
 }  // namespace hal
@@ -0,0 +1,335 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/trace.hpp>
+
+#include <array>
+#include <string>
+
+#include <boost/ut.hpp>
+
+#include "helpers.hpp"
+
+namespace hal {
+namespace {
+constexpr hal::byte sensor_address = 0x48;
+
+/// Non-blocking transactions finish on the second state poll
+class test_i2c : public hal::i2c
+{
+public:
+  int m_transactions = 0;
+  int m_polls = 0;
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+
+  result<transaction_t> driver_transaction(
+    hal::byte p_address,
+    std::span<const hal::byte>,
+    std::span<hal::byte>,
+    hal::function_ref<hal::timeout_function>) override
+  {
+    m_transactions++;
+    if (p_address != sensor_address) {
+      return hal::new_error(std::errc::no_such_device_or_address);
+    }
+    return transaction_t{};
+  }
+
+  status driver_start_transaction(hal::byte,
+                                  std::span<const hal::byte>,
+                                  std::span<hal::byte>) override
+  {
+    m_polls = 0;
+    return success();
+  }
+
+  result<work_state> driver_transaction_state() override
+  {
+    return ++m_polls < 2 ? work_state::in_progress : work_state::finished;
+  }
+};
+
+class test_spi : public hal::spi
+{
+public:
+  int m_transfers = 0;
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+
+  result<transfer_t> driver_transfer(std::span<const hal::byte>,
+                                     std::span<hal::byte>,
+                                     hal::byte) override
+  {
+    m_transfers++;
+    return transfer_t{};
+  }
+};
+
+/// Serial port with 3 bytes waiting to be read
+class test_serial : public hal::serial
+{
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+
+  result<write_t> driver_write(std::span<const hal::byte> p_data) override
+  {
+    return write_t{ .data = p_data };
+  }
+
+  result<read_t> driver_read(std::span<hal::byte> p_data) override
+  {
+    const auto filled = p_data.first(std::min(p_data.size(), std::size_t{ 3 }));
+    return read_t{ .data = filled, .available = 0, .capacity = 16 };
+  }
+
+  result<flush_t> driver_flush() override
+  {
+    return flush_t{};
+  }
+};
+
+class test_can : public hal::can
+{
+public:
+  hal::callback<handler> m_handler = [](const message_t&) {};
+
+private:
+  status driver_configure(const settings&) override
+  {
+    return success();
+  }
+  status driver_bus_on() override
+  {
+    return success();
+  }
+  result<send_t> driver_send(const message_t&) override
+  {
+    return send_t{};
+  }
+  void driver_on_receive(hal::callback<handler> p_handler) override
+  {
+    m_handler = p_handler;
+  }
+};
+
+}  // namespace
+
+void trace_test()
+{
+  using namespace boost::ut;
+
+  "traced_i2c records transactions and errors"_test = []() {
+    // Setup
+    test_steady_clock clock(1000);
+    std::array<trace_event, 4> events{};
+    trace_buffer buffer(events, clock);
+    test_i2c i2c;
+    traced_i2c traced(i2c, buffer, 2);
+    const std::array<hal::byte, 1> data_out{ 0x00 };
+    std::array<hal::byte, 2> data_in{};
+
+    // Exercise
+    auto good = traced.get().transaction(
+      sensor_address, data_out, data_in, hal::never_timeout());
+    auto bad = traced.get().transaction(
+      0x10, data_out, data_in, hal::never_timeout());
+
+    // Verify
+    expect(bool{ good });
+    expect(!bool{ bad });
+    expect(that % 2U == buffer.size());
+    expect(that % 1000U == buffer[0].start);
+    expect(that % 2000U == buffer[0].end);
+    expect(that % 3U == buffer[0].bytes);
+    expect(that % 2 == buffer[0].channel);
+    expect(that % 0 == buffer[0].error);
+    expect(trace_operation::i2c_transaction == buffer[0].operation);
+    expect(that % 0U == buffer[1].bytes);
+    constexpr auto nack = std::errc::no_such_device_or_address;
+    expect(that % static_cast<hal::byte>(nack) == buffer[1].error);
+  };
+
+  "traced_i2c records transaction lists as one event"_test = []() {
+    // Setup
+    test_steady_clock clock(1000);
+    std::array<trace_event, 4> events{};
+    trace_buffer buffer(events, clock);
+    test_i2c i2c;
+    traced_i2c traced(i2c, buffer);
+    const std::array<hal::byte, 1> data_out{ 0x00 };
+    std::array<hal::byte, 2> data_in{};
+    const std::array<hal::i2c::transaction_descriptor, 2> list{
+      hal::i2c::transaction_descriptor{ .address = sensor_address,
+                                        .data_out = data_out },
+      hal::i2c::transaction_descriptor{ .address = sensor_address,
+                                        .data_in = data_in },
+    };
+
+    // Exercise
+    auto result = traced.get().transactions(list, hal::never_timeout());
+
+    // Verify
+    expect(bool{ result });
+    expect(that % 2 == i2c.m_transactions);
+    expect(that % 1U == buffer.size());
+    expect(that % 3U == buffer[0].bytes);
+  };
+
+  "traced_i2c records non-blocking transactions when they end"_test = []() {
+    // Setup
+    test_steady_clock clock(1000);
+    std::array<trace_event, 4> events{};
+    trace_buffer buffer(events, clock);
+    test_i2c i2c;
+    traced_i2c traced(i2c, buffer);
+    const std::array<hal::byte, 1> data_out{ 0x00 };
+    std::array<hal::byte, 2> data_in{};
+
+    // Exercise
+    auto started =
+      traced.get().start_transaction(sensor_address, data_out, data_in);
+    auto first = traced.get().transaction_state();
+    const auto size_in_progress = buffer.size();
+    auto second = traced.get().transaction_state();
+
+    // Verify
+    expect(bool{ started });
+    expect(work_state::in_progress == first.value());
+    expect(work_state::finished == second.value());
+    expect(that % 0U == size_in_progress);
+    expect(that % 1U == buffer.size());
+    expect(that % 1000U == buffer[0].start);
+    expect(that % 2000U == buffer[0].end);
+    expect(that % 3U == buffer[0].bytes);
+    expect(that % 0 == buffer[0].error);
+  };
+
+  "traced_i2c<false> is bypassed"_test = []() {
+    // Setup
+    test_i2c i2c;
+    traced_i2c<false> traced(i2c);
+
+    // Exercise
+    auto& bus = traced.get();
+    auto result = bus.transaction(sensor_address,
+                                  std::span<const hal::byte>{},
+                                  std::span<hal::byte>{},
+                                  hal::never_timeout());
+
+    // Verify
+    static_assert(sizeof(traced_i2c<false>) == sizeof(hal::i2c*));
+    expect(bool{ result });
+    expect(&bus == &i2c);
+    expect(that % 1 == i2c.m_transactions);
+  };
+
+  "trace_buffer overwrites the oldest events"_test = []() {
+    // Setup
+    test_steady_clock clock(1000);
+    std::array<trace_event, 2> events{};
+    trace_buffer buffer(events, clock);
+    std::array<trace_event, 4> copy{};
+
+    // Exercise
+    for (std::uint32_t i = 0; i < 5; i++) {
+      buffer.record(trace_event{ .bytes = i });
+    }
+    const auto dumped = buffer.dump(copy);
+
+    // Verify
+    expect(that % 2U == buffer.size());
+    expect(that % 3U == buffer.dropped());
+    expect(that % 2U == dumped.size());
+    expect(that % 3U == dumped[0].bytes);
+    expect(that % 4U == dumped[1].bytes);
+  };
+
+  "traced_spi, traced_serial and traced_can record bytes moved"_test = []() {
+    // Setup
+    test_steady_clock clock(1000);
+    std::array<trace_event, 8> events{};
+    trace_buffer buffer(events, clock);
+    test_spi spi;
+    test_serial serial;
+    test_can can;
+    traced_spi traced_spi_bus(spi, buffer, 0);
+    traced_serial traced_serial_port(serial, buffer, 1);
+    traced_can traced_can_bus(can, buffer, 2);
+    std::array<hal::byte, 6> data{};
+    const std::array<hal::spi::transfer_segment, 2> segments{
+      hal::spi::transfer_segment{ .data_out = std::span(data).first(2) },
+      hal::spi::transfer_segment{ .data_in = std::span(data).first(4) },
+    };
+    const hal::can::message_t message{ .id = 1, .length = 8 };
+    int received = 0;
+
+    // Exercise
+    (void)traced_spi_bus.get().transfer(segments);
+    (void)traced_serial_port.get().write(data);
+    (void)traced_serial_port.get().read(data);
+    (void)traced_can_bus.get().send(message);
+    traced_can_bus.get().on_receive(
+      [&received](const hal::can::message_t&) { received++; });
+    can.m_handler(hal::can::message_t{ .id = 2, .length = 5 });
+
+    // Verify
+    expect(that % 5U == buffer.size());
+    expect(that % 6U == buffer[0].bytes);
+    expect(that % 2 == spi.m_transfers);
+    expect(that % 6U == buffer[1].bytes);
+    expect(that % 3U == buffer[2].bytes);
+    expect(trace_operation::serial_read == buffer[2].operation);
+    expect(that % 8U == buffer[3].bytes);
+    expect(that % 5U == buffer[4].bytes);
+    expect(trace_operation::can_receive == buffer[4].operation);
+    expect(that % 1 == received);
+  };
+
+  "write_chrome_trace() produces trace event JSON"_test = []() {
+    // Setup
+    const std::array<trace_event, 1> events{ trace_event{
+      .start = 1500,
+      .end = 2000,
+      .bytes = 3,
+      .operation = trace_operation::spi_transfer,
+      .channel = 1,
+    } };
+    std::string json;
+
+    // Exercise
+    write_chrome_trace(events, 1.0_MHz, [&json](std::string_view p_text) {
+      json.append(p_text);
+    });
+
+    // Verify
+    expect(that % std::string(R"({"traceEvents":[{"name":"spi_transfer",)"
+                              R"("cat":"hal","ph":"X","pid":0,"tid":1,)"
+                              R"("ts":1500.000,"dur":500.000,)"
+                              R"("args":{"bytes":3,"error":0}}],)"
+                              R"("displayTimeUnit":"ns"})") == json);
+  };
+};
+}  // namespace hal
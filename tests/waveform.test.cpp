@@ -0,0 +1,76 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal/waveform.hpp>
+
+#include <cmath>
+
+#include <boost/ut.hpp>
+
+namespace hal {
+void waveform_test()
+{
+  using namespace boost::ut;
+
+  "sine_table() is generated at compile time"_test = []() {
+    // Setup + Exercise
+    static constexpr auto sine = sine_table<8>();
+
+    // Verify
+    static_assert(sine[0] == q16::from_raw(32768));
+    static_assert(sine[2] == q16::from_raw(q16::raw_one));
+    expect(that % 0U == sine[6].raw());
+    // 0.5 + 0.5 * sqrt(0.5) rounded to the nearest 1/65536
+    expect(that % 55938U == sine[1].raw());
+  };
+
+  "constexpr_sin() matches std::sin"_test = []() {
+    // Exercise + Verify
+    for (double angle = -20.0; angle < 20.0; angle += 0.37) {
+      expect(std::abs(constexpr_sin(angle) - std::sin(angle)) < 1e-9);
+    }
+  };
+
+  "triangle_table() rises and falls"_test = []() {
+    // Setup + Exercise
+    static constexpr auto triangle = triangle_table<4>(0.25, 0.75);
+
+    // Verify
+    expect(that % 16384U == triangle[0].raw());
+    expect(that % 32768U == triangle[1].raw());
+    expect(that % 49152U == triangle[2].raw());
+    expect(that % 32768U == triangle[3].raw());
+  };
+
+  "waveform_table() samples a function over one period"_test = []() {
+    // Setup + Exercise
+    static constexpr auto sawtooth =
+      waveform_table<4>([](double p_phase) { return p_phase; });
+
+    // Verify
+    expect(that % 0U == sawtooth[0].raw());
+    expect(that % 49152U == sawtooth[3].raw());
+  };
+
+  "waveform_table() saturates values outside of 0 to 1"_test = []() {
+    // Setup + Exercise
+    static constexpr auto table =
+      waveform_table<2>([](double p_phase) { return p_phase * 4.0 - 1.0; });
+
+    // Verify
+    expect(that % 0U == table[0].raw());
+    expect(that % q16::raw_one == table[1].raw());
+  };
+};
+}  // namespace hal